@@ -5,6 +5,7 @@
 #include <vector>
 #include <cctype>
 #include <memory>
+#include <iomanip>
 
 // Constants
 const size_t DEFAULT_MEMTABLE_SIZE = 5; // default size if no size has been specified by user
@@ -130,6 +131,36 @@ int main()
                 std::cout << "Key " << key << " not found." << std::endl;
             }
         }
+        else if (command == "mget")
+        {
+            if (tokens.size() < 2)
+            {
+                std::cout << "Usage: mget <key> [<key> ...]" << std::endl;
+                continue;
+            }
+            if (!isOpen)
+            {
+                std::cout << "No database is open. Use 'open <db_name> [memtable_size]' to open a database." << std::endl;
+                continue;
+            }
+            std::vector<int64_t> keys;
+            for (size_t i = 1; i < tokens.size(); ++i)
+            {
+                keys.push_back(std::stoll(tokens[i]));
+            }
+            std::vector<int64_t> values = kvStore->MultiGet(keys);
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                if (values[i] != -1)
+                {
+                    std::cout << "Value for key " << keys[i] << ": " << values[i] << std::endl;
+                }
+                else
+                {
+                    std::cout << "Key " << keys[i] << " not found." << std::endl;
+                }
+            }
+        }
         else if (command == "del")
         {
             if (tokens.size() != 2)
@@ -181,6 +212,71 @@ int main()
             }
             delete[] results;
         }
+        else if (command == "compact")
+        {
+            if (tokens.size() != 1 && tokens.size() != 3)
+            {
+                std::cout << "Usage: compact [<start_key> <end_key>]" << std::endl;
+                continue;
+            }
+            if (!isOpen)
+            {
+                std::cout << "No database is open. Use 'open <db_name> [memtable_size]' to open a database." << std::endl;
+                continue;
+            }
+            int64_t startKey = tokens.size() == 3 ? std::stoll(tokens[1]) : INT64_MIN;
+            int64_t endKey = tokens.size() == 3 ? std::stoll(tokens[2]) : INT64_MAX;
+            if (startKey > endKey)
+            {
+                std::cout << "Error: start_key must be less than or equal to end_key." << std::endl;
+                continue;
+            }
+            CompactRangeStats stats = kvStore->CompactRange(startKey, endKey);
+            std::cout << "Compacted " << stats.inputFiles << " SST(s) into " << stats.outputFiles << " SST(s) at level "
+                      << stats.outputLevel << ": read " << stats.bytesRead << " bytes, wrote " << stats.bytesWritten
+                      << " bytes, dropped " << stats.droppedTombstones << " tombstone(s)." << std::endl;
+            for (size_t level = 0; level < stats.levelFiles.size(); ++level)
+            {
+                std::cout << "  Level " << level << ": " << stats.levelFiles[level] << " SST(s), "
+                          << stats.levelBytes[level] << " bytes" << std::endl;
+            }
+        }
+        else if (command == "stats")
+        {
+            if (!isOpen)
+            {
+                std::cout << "No database is open. Use 'open <db_name> [memtable_size]' to open a database." << std::endl;
+                continue;
+            }
+            KVStoreStats stats = kvStore->GetStats();
+            auto seconds = [](int64_t micros)
+            { return micros / 1e6; };
+
+            std::cout << std::fixed << std::setprecision(3);
+            std::cout << "Level  Files        Bytes  Compactions  Moved  FilesIn  FilesOut      Read(B)   Written(B)  Overwritten  Tombstones   Time(s)    CPU(s)" << std::endl;
+            for (size_t level = 0; level < stats.levelFiles.size(); ++level)
+            {
+                LevelCompactionStats compaction = level < stats.compactions.size() ? stats.compactions[level] : LevelCompactionStats();
+                std::cout << std::setw(5) << level << std::setw(7) << stats.levelFiles[level] << std::setw(13) << stats.levelBytes[level]
+                          << std::setw(13) << compaction.compactions << std::setw(7) << compaction.filesMoved
+                          << std::setw(9) << compaction.filesIn << std::setw(10) << compaction.filesOut
+                          << std::setw(13) << compaction.bytesRead << std::setw(13) << compaction.bytesWritten
+                          << std::setw(13) << compaction.entriesOverwritten << std::setw(12) << compaction.tombstonesDropped
+                          << std::setw(10) << seconds(compaction.micros) << std::setw(10) << seconds(compaction.cpuMicros) << std::endl;
+            }
+            std::cout << "User bytes written: " << stats.userBytesWritten << std::endl;
+            std::cout << "Flushes: " << stats.flushes << ", " << stats.flushBytesWritten << " bytes in "
+                      << seconds(stats.flushMicros) << " s" << std::endl;
+            std::cout << "Write amplification: " << stats.writeAmplification
+                      << ", space amplification: " << stats.spaceAmplification << std::endl;
+            std::cout << "Rate limiter: flushes " << stats.flushIO.bytes << " bytes (" << seconds(stats.flushIO.throttledMicros)
+                      << " s throttled), compactions " << stats.compactionIO.bytes << " bytes ("
+                      << seconds(stats.compactionIO.throttledMicros) << " s throttled)" << std::endl;
+            std::cout << "Write stalls: " << stats.writeStalls.delayedWrites << " delayed (" << seconds(stats.writeStalls.delayMicros)
+                      << " s), " << stats.writeStalls.stoppedWrites << " stopped (" << seconds(stats.writeStalls.stopMicros) << " s)" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+            std::cout << std::setprecision(6);
+        }
         else if (command == "usebtree")
         {
             if (!isOpen)
@@ -223,8 +319,11 @@ int main()
             std::cout << "  close                                     Close the current database" << std::endl;
             std::cout << "  put <key> <value>                         Insert or update a key-value pair" << std::endl;
             std::cout << "  get <key>                                 Retrieve the value for a key" << std::endl;
+            std::cout << "  mget <key> [<key> ...]                    Retrieve the values for several keys at once" << std::endl;
             std::cout << "  del <key>                                 Delete a key-value pair" << std::endl;
             std::cout << "  scan <start_key> <end_key>                Retrieve key-value pairs in a key range" << std::endl;
+            std::cout << "  compact [<start_key> <end_key>]           Compact a key range, or the whole tree, into the bottom level" << std::endl;
+            std::cout << "  stats                                     Show flush and compaction statistics" << std::endl;
             std::cout << "  usebtree <flag>                           Use Btree search or not" << std::endl;
             std::cout << "  exit, quit                                Exit the program" << std::endl;
         }
@@ -70,7 +70,7 @@ void BTree::insert(int64_t key, int64_t offset) {
         return;
     }
 
-    if (root->keys.size() == 2 * degree - 1) {
+    if (root->keys.size() == static_cast<size_t>(2 * degree - 1)) {
         // If root is full, split it and create a new root
         Node* newRoot = new Node(false);
         newRoot->children.push_back(root);
@@ -115,7 +115,7 @@ void BTree::insertNonFull(Node* node, int64_t key, int64_t offset) {
         i++;
 
         // Check if the found child is full
-        if (node->children[i]->keys.size() == 2 * degree - 1) {
+        if (node->children[i]->keys.size() == static_cast<size_t>(2 * degree - 1)) {
             // Split the child
             splitChild(node, i, node->children[i]);
 
@@ -306,7 +306,7 @@ void BTree::Node::updateData() {
     std::memcpy(&data[metadataOffset], &offCount, sizeof(offCount));
     metadataOffset += sizeof(offCount);
     // Store the keys and offsets
-    for (size_t i = 0; i < keyCount; ++i) {
+    for (int32_t i = 0; i < keyCount; ++i) {
         std::memcpy(&data[metadataOffset], &offsets[i], sizeof(offsets[i]));
         metadataOffset += sizeof(offsets[i]);
         std::memcpy(&data[metadataOffset], &keys[i], sizeof(keys[i]));
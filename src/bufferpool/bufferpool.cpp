@@ -1,8 +1,9 @@
 #include "bufferpool.h"
+#include <cstring>
 
 // Constructor: Initializes the BufferPool with the specified capacity.
 // Sets the current size to 0, initializes the page map, and prepares for the clock eviction policy.
-BufferPool::BufferPool(size_t capacity) : capacity(capacity), currentSize(0), clockHand(nullptr), head(nullptr)
+BufferPool::BufferPool(size_t capacity) : clockHand(nullptr), head(nullptr), capacity(capacity), currentSize(0)
 {
     // Initialize the pageMap with the specified capacity.
     pageMap = HashMap<std::string, std::pair<Page, ClockNode *>>(capacity);
@@ -12,6 +13,7 @@ BufferPool::BufferPool(size_t capacity) : capacity(capacity), currentSize(0), cl
 // If the page exists, updates its reference bit for the clock replacement policy.
 Page *BufferPool::getPage(const std::string &pageID)
 {
+    std::lock_guard<std::mutex> lock(mutex);
     // Attempt to find the page in the map.
     auto *nodePair = pageMap.get(pageID);
     if (!nodePair)
@@ -25,8 +27,22 @@ Page *BufferPool::getPage(const std::string &pageID)
 
 // Insert method: Adds a page to the buffer pool.
 // If the buffer pool is full, evicts a page using the clock replacement policy.
+bool BufferPool::copyPage(const std::string &pageID, char *buffer)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto *nodePair = pageMap.get(pageID);
+    if (!nodePair)
+    {
+        return false;
+    }
+    nodePair->second->referenceBit = 1;
+    std::memcpy(buffer, nodePair->first.data.data(), nodePair->first.data.size());
+    return true;
+}
+
 void BufferPool::insertPage(const std::string &pageID, const Page &page)
 {
+    std::lock_guard<std::mutex> lock(mutex);
     // Check if the page is already in the buffer pool.
     if (pageMap.get(pageID))
     {
@@ -3,6 +3,7 @@
 
 #include "HashMap.h" // Custom hash map implementation for page storage
 #include <string>    // For using std::string
+#include <mutex>     // For std::mutex
 #include "globals.h" // Global configurations/constants (if any)
 #include "page.h"    // Page structure definition
 
@@ -20,6 +21,7 @@ struct ClockNode
 
 // BufferPool class manages a fixed-size pool of pages in memory.
 // Implements the clock replacement policy to handle evictions when the pool is full.
+// Every method takes the pool mutex, so threads may share a pool through copyPage and insertPage.
 class BufferPool
 {
 private:
@@ -28,6 +30,7 @@ private:
     ClockNode *head;      // Pointer to the head of the circular doubly linked list.
     size_t capacity;      // Maximum number of pages the buffer pool can hold.
     size_t currentSize;   // Current number of pages in the buffer pool.
+    std::mutex mutex;     // Guards the map and the clock.
 
     // Private helper method to evict a page using the clock replacement policy.
     void evictPage();
@@ -38,8 +41,13 @@ public:
 
     // Retrieves a page from the buffer pool based on its ID.
     // Returns a pointer to the page if it exists, otherwise nullptr.
+    // The page stays valid until it is evicted, so threads sharing the pool use copyPage instead.
     Page *getPage(const std::string &pageID);
 
+    // Copies the data of a page into a buffer of at least its size.
+    // Returns false if the page is not in the buffer pool.
+    bool copyPage(const std::string &pageID, char *buffer);
+
     // Inserts a page into the buffer pool.
     // If the page already exists, updates its reference bit.
     // If the buffer pool is full, evicts a page before inserting.
@@ -2,6 +2,9 @@
 #define BUFFER_POOL_MANAGER_H
 
 #include "bufferpool.h"
+#include <functional>
+#include <memory>
+#include <vector>
 
 // The BufferPoolManager class provides a singleton interface to manage
 // a single instance of a BufferPool. This ensures that only one instance
@@ -16,6 +19,22 @@ public:
         return instance;
     }
 
+    // Static method to access the shard of the buffer pool that caches a page.
+    // Pages are spread over NUM_SHARDS pools with a lock each, so concurrent
+    // readers rarely wait on one another; together they hold 1024 pages.
+    static BufferPool& getShard(const std::string &pageID) {
+        static const std::vector<std::unique_ptr<BufferPool>> shards = [] {
+            std::vector<std::unique_ptr<BufferPool>> pools;
+            for (size_t i = 0; i < NUM_SHARDS; ++i) {
+                pools.push_back(std::make_unique<BufferPool>(1024 / NUM_SHARDS));
+            }
+            return pools;
+        }();
+        return *shards[std::hash<std::string>()(pageID) % NUM_SHARDS];
+    }
+
+    static constexpr size_t NUM_SHARDS = 16;
+
     // Deleted copy constructor to prevent copying of the BufferPoolManager instance.
     BufferPoolManager(const BufferPoolManager&) = delete;
 
@@ -0,0 +1,181 @@
+#include "compression.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // LZ4 block format parameters
+    constexpr size_t MIN_MATCH = 4;     // Shortest match that can be encoded
+    constexpr size_t LAST_LITERALS = 5; // The last bytes of a block are always literals
+    constexpr size_t MF_LIMIT = 12;     // No match may start within this many bytes of the end
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr int HASH_LOG = 12;
+
+    uint32_t read32(const char *p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761U) >> (32 - HASH_LOG);
+    }
+
+    // Appends a length that did not fit in its 4-bit token field
+    void writeLength(std::vector<char> &dst, size_t length)
+    {
+        while (length >= 255)
+        {
+            dst.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        dst.push_back(static_cast<char>(length));
+    }
+
+    // Appends one sequence: literals followed by an optional match
+    void writeSequence(std::vector<char> &dst, const char *literals, size_t literalLength, size_t offset, size_t matchLength)
+    {
+        size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+        char token = static_cast<char>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+        dst.push_back(token);
+        if (literalLength >= 15)
+        {
+            writeLength(dst, literalLength - 15);
+        }
+        dst.insert(dst.end(), literals, literals + literalLength);
+
+        if (matchLength == 0)
+        {
+            return; // The last sequence carries literals only
+        }
+        dst.push_back(static_cast<char>(offset & 0xFF));
+        dst.push_back(static_cast<char>(offset >> 8));
+        if (matchCode >= 15)
+        {
+            writeLength(dst, matchCode - 15);
+        }
+    }
+
+    size_t readLength(const unsigned char *&ip, const unsigned char *end)
+    {
+        size_t length = 0;
+        unsigned char byte;
+        do
+        {
+            if (ip >= end)
+            {
+                throw std::runtime_error("Truncated length in compressed block.");
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+}
+
+void compressBlock(const char *src, size_t srcSize, std::vector<char> &dst)
+{
+    dst.clear();
+    dst.reserve(srcSize + srcSize / 255 + 16);
+
+    size_t anchor = 0; // Start of the pending literals
+    size_t ip = 0;
+
+    if (srcSize > MF_LIMIT)
+    {
+        // Most recent position of every hashed 4-byte sequence
+        std::vector<int32_t> table(1 << HASH_LOG, -1);
+        size_t matchLimit = srcSize - LAST_LITERALS;
+
+        while (ip < srcSize - MF_LIMIT)
+        {
+            uint32_t sequence = read32(src + ip);
+            uint32_t hash = hashSequence(sequence);
+            int32_t candidate = table[hash];
+            table[hash] = static_cast<int32_t>(ip);
+
+            if (candidate < 0 || ip - candidate > MAX_OFFSET || read32(src + candidate) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+
+            // Extend the match forward
+            size_t matchLength = MIN_MATCH;
+            while (ip + matchLength < matchLimit && src[candidate + matchLength] == src[ip + matchLength])
+            {
+                ++matchLength;
+            }
+
+            writeSequence(dst, src + anchor, ip - anchor, ip - candidate, matchLength);
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+
+    // Emit the remaining bytes as literals
+    writeSequence(dst, src + anchor, srcSize - anchor, 0, 0);
+}
+
+void decompressBlock(const char *src, size_t srcSize, char *dst, size_t dstSize)
+{
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(src);
+    const unsigned char *end = ip + srcSize;
+    size_t op = 0;
+
+    while (ip < end)
+    {
+        unsigned char token = *ip++;
+
+        // Copy the literals
+        size_t literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            literalLength += readLength(ip, end);
+        }
+        if (literalLength > static_cast<size_t>(end - ip) || literalLength > dstSize - op)
+        {
+            throw std::runtime_error("Literal run exceeds compressed block bounds.");
+        }
+        std::memcpy(dst + op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == end)
+        {
+            break; // The last sequence has no match
+        }
+
+        // Copy the match, which may overlap the bytes it produces
+        if (end - ip < 2)
+        {
+            throw std::runtime_error("Truncated match offset in compressed block.");
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15)
+        {
+            matchLength += readLength(ip, end);
+        }
+        matchLength += MIN_MATCH;
+
+        if (offset == 0 || offset > op || matchLength > dstSize - op)
+        {
+            throw std::runtime_error("Invalid match in compressed block.");
+        }
+        const char *match = dst + op - offset;
+        for (size_t i = 0; i < matchLength; ++i)
+        {
+            dst[op + i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    if (op != dstSize)
+    {
+        throw std::runtime_error("Compressed block has an unexpected decompressed size.");
+    }
+}
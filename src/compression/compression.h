@@ -0,0 +1,37 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Compression applied to the data blocks of an SST
+enum class CompressionType : int32_t
+{
+    None = 0,
+    LZ4 = 1 // Self-contained LZ4 block format codec
+};
+
+/**
+ * @brief Compresses a block using the LZ4 block format.
+ *
+ * @param src The bytes to compress.
+ * @param srcSize The number of bytes to compress.
+ * @param dst Receives the compressed bytes.
+ */
+void compressBlock(const char *src, size_t srcSize, std::vector<char> &dst);
+
+/**
+ * @brief Decompresses an LZ4 block produced by compressBlock.
+ *
+ * Throws std::runtime_error if the block is malformed or does not decompress
+ * to exactly dstSize bytes.
+ *
+ * @param src The compressed bytes.
+ * @param srcSize The number of compressed bytes.
+ * @param dst Receives the decompressed bytes.
+ * @param dstSize The size of the decompressed block.
+ */
+void decompressBlock(const char *src, size_t srcSize, char *dst, size_t dstSize);
+
+#endif // COMPRESSION_H
@@ -0,0 +1,100 @@
+#include "executor.h"
+#include <cerrno>
+#include <unistd.h>
+
+EventLoop::EventLoop(unsigned depth) : queue(depth)
+{
+}
+
+void EventLoop::post(std::function<void()> task)
+{
+    tasks.push_back(std::move(task));
+}
+
+void EventLoop::read(ReadRequest &request, std::function<void()> done)
+{
+    pending.emplace(&request, std::move(done));
+    backlog.push_back(&request);
+}
+
+void EventLoop::run()
+{
+    while (!tasks.empty() || !pending.empty())
+    {
+        runOnce(true);
+    }
+}
+
+size_t EventLoop::poll()
+{
+    return runOnce(false);
+}
+
+void EventLoop::submitBacklog()
+{
+    while (!backlog.empty() && queue.submit(backlog.front()))
+    {
+        backlog.pop_front();
+    }
+}
+
+size_t EventLoop::runOnce(bool wait)
+{
+    // Tasks queued while these run wait for the next round
+    size_t ran = 0;
+    for (size_t count = tasks.size(); count > 0; --count, ++ran)
+    {
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        task();
+    }
+
+    submitBacklog();
+    std::vector<ReadRequest *> completed;
+    queue.reap(completed, wait && ran == 0 && queue.getInFlight() > 0);
+    for (ReadRequest *request : completed)
+    {
+        auto it = pending.find(request);
+        std::function<void()> done = std::move(it->second);
+        pending.erase(it);
+        done();
+        ++ran;
+    }
+    return ran;
+}
+
+ThreadPoolExecutor::ThreadPoolExecutor(size_t numThreads) : pool(numThreads)
+{
+}
+
+void ThreadPoolExecutor::post(std::function<void()> task)
+{
+    pool.submit(std::move(task));
+}
+
+void ThreadPoolExecutor::read(ReadRequest &request, std::function<void()> done)
+{
+    pool.submit([&request, done = std::move(done)]()
+                {
+                    size_t bytesRead = 0;
+                    int error = 0;
+                    while (bytesRead < request.size)
+                    {
+                        ssize_t n = pread(request.fd, request.buffer + bytesRead, request.size - bytesRead, request.offset + bytesRead);
+                        if (n < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (n < 0)
+                        {
+                            error = errno;
+                        }
+                        if (n <= 0)
+                        {
+                            break; // Failed, or the end of the file
+                        }
+                        bytesRead += n;
+                    }
+                    request.result = error && bytesRead == 0 ? -error : static_cast<ssize_t>(bytesRead);
+                    done(); });
+}
@@ -0,0 +1,70 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include "sst/ioqueue.h"
+#include "lsmtree/threadpool.h"
+
+// Executor performs the reads the asynchronous KVStore operations wait on
+// and runs their continuations. KVStore::GetAsync and ScanAsync suspend on
+// every read an executor performs and resume inside its completion.
+class Executor
+{
+public:
+    virtual ~Executor() = default;
+
+    // Runs a task on a thread of the executor
+    virtual void post(std::function<void()> task) = 0;
+
+    // Starts a read; `done` runs on a thread of the executor once the request
+    // holds its result. The request must stay valid until then.
+    virtual void read(ReadRequest &request, std::function<void()> done) = 0;
+};
+
+// EventLoop runs every task and completion on the thread calling run, and
+// performs reads through its own io_uring (pread where it is unavailable),
+// so a single thread keeps up to IO_QUEUE_DEPTH reads in flight. Reads past
+// the depth wait in a backlog. It is not thread-safe: only tasks it runs may
+// post to it or start reads on it.
+class EventLoop : public Executor
+{
+public:
+    explicit EventLoop(unsigned depth = IO_QUEUE_DEPTH);
+
+    void post(std::function<void()> task) override;
+    void read(ReadRequest &request, std::function<void()> done) override;
+
+    // Runs tasks and completions until no task is queued and no read is pending
+    void run();
+
+    // Runs the queued tasks and the completions of finished reads without
+    // waiting for a read; returns the number run
+    size_t poll();
+
+private:
+    size_t runOnce(bool wait);
+    void submitBacklog();
+
+    IOQueue queue;
+    std::deque<std::function<void()>> tasks;
+    std::deque<ReadRequest *> backlog; // Reads waiting for room in the queue
+    std::unordered_map<ReadRequest *, std::function<void()>> pending;
+};
+
+// ThreadPoolExecutor performs each read with a blocking pread on a worker
+// thread and runs continuations on the workers, for callers without an event loop
+class ThreadPoolExecutor : public Executor
+{
+public:
+    explicit ThreadPoolExecutor(size_t numThreads);
+
+    void post(std::function<void()> task) override;
+    void read(ReadRequest &request, std::function<void()> done) override;
+
+private:
+    ThreadPool pool;
+};
+
+#endif // EXECUTOR_H
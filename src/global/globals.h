@@ -3,8 +3,24 @@
 
 #include <cstdint>
 
-constexpr int PAGE_SIZE = 4096;
-constexpr size_t SST_METADATA_SIZE = 24;
+constexpr int PAGE_SIZE = 4096;                    // Default data block size; size of Bloom filter and B-tree node blocks
+constexpr int MAX_BLOCK_SIZE = 64 * 1024;          // Largest data block size an SST may use
+constexpr size_t SST_METADATA_SIZE = 32;           // numEntries, numPages, startingKey, endingKey, blockSize, reserved
+constexpr size_t LEGACY_SST_METADATA_SIZE = 24;    // Header of SSTs written without a footer
+constexpr size_t SST_FOOTER_SIZE = 112;            // Block ranges, root offset, version, magic
+constexpr uint32_t SST_FOOTER_MAGIC = 0x4D444246; // "MDBF"
+constexpr uint32_t SST_FORMAT_VERSION = 1;         // Newest SST format version this build reads and writes
+constexpr size_t SST_TAIL_READ_SIZE = 16 * 1024;   // Bytes read from the end of an SST at open
+constexpr size_t COMPACTION_READAHEAD_SIZE = 256 * 1024; // Data page bytes read at once by sequential passes
+constexpr size_t SCAN_READAHEAD_SIZE = 256 * 1024;       // Largest window a sequential scan prefetches ahead of its cursor
+constexpr int64_t TARGET_FILE_SIZE = 2 * 1024 * 1024;     // Size at which leveled compaction starts a new output SST
+constexpr unsigned IO_QUEUE_DEPTH = 64;                  // Reads an I/O queue keeps in flight at once
+constexpr size_t DIRECT_IO_ALIGNMENT = 4096;             // Alignment of the offsets, sizes and buffers of O_DIRECT I/O
+constexpr size_t DIRECT_IO_WRITE_BUFFER_SIZE = 256 * 1024; // Bytes an SST writer stages before an O_DIRECT write
+constexpr size_t MANIFEST_SNAPSHOT_EDITS = 1024;          // Edits appended to the manifest before it is rewritten as one snapshot
+constexpr const char *MANIFEST_FILENAME = "MANIFEST";     // Version edit log in the database directory
+constexpr int PACKED_PAGE_TAG_V1 = -1;            // Stored in place of freeSpace by packed pages
+constexpr int PACKED_PAGE_HEADER_SIZE = 32;
 constexpr int BUFFER_POOL_SIZE = 100;
 constexpr int HASHMAP_SIZE = 2560;
 constexpr int BTREE_DEGREE = 128;
@@ -15,13 +15,15 @@
 #include <vector>
 #include <string> // For std::string
 #include <cmath>
+#include <chrono>
 #include "bloomfilter.h"
 #include "bufferpool.h"
 #include "bufferpoolmanager.h"
+#include "ioqueue.h"
 
 // Constructor
 KVStore::KVStore(int memtable_size, size_t levelSizeRatio)
-    : memtable(memtable_size), memtable_size(memtable_size), sst_counter(0)
+    : memtable(std::make_shared<AVLTree>(memtable_size)), memtable_size(memtable_size), levelSizeRatio(levelSizeRatio)
 {
 }
 
@@ -30,11 +32,261 @@ void KVStore::SetUseBTree(bool flag)
     useBTree = flag;
 }
 
+void KVStore::SetAsyncIO(bool enabled)
+{
+    asyncIO = enabled;
+}
+
+void KVStore::SetDirectIO(bool enabled)
+{
+    directIO = enabled;
+    if (lsmTree)
+    {
+        lsmTree->setDirectIO(enabled);
+    }
+}
+
+void KVStore::SetMmapReads(bool enabled)
+{
+    mmapReads = enabled;
+    if (lsmTree)
+    {
+        lsmTree->setMmapReads(enabled);
+    }
+}
+
+void KVStore::SetPageFormat(PageFormat format)
+{
+    pageFormat = format;
+    if (lsmTree)
+    {
+        lsmTree->setPageFormat(format);
+    }
+}
+
+void KVStore::SetCompression(CompressionType type, size_t minLevel)
+{
+    compression = type;
+    compressionMinLevel = minLevel;
+    if (lsmTree)
+    {
+        lsmTree->setCompression(type, minLevel);
+    }
+}
+
+void KVStore::SetCompactionStyle(CompactionStyle style, int64_t targetFileSize)
+{
+    if (lsmTree)
+    {
+        lsmTree->setCompactionStyle(style);
+        lsmTree->setTargetFileSize(targetFileSize);
+    }
+    compactionStyle = style;
+    this->targetFileSize = targetFileSize;
+}
+
+void KVStore::SetLevelOptions(size_t level, LevelOptions options)
+{
+    if (lsmTree)
+    {
+        lsmTree->setLevelOptions(level, options);
+    }
+    if (levelOptions.size() <= level)
+    {
+        levelOptions.resize(level + 1);
+    }
+    levelOptions[level] = options;
+}
+
+void KVStore::SetMaxSubcompactions(size_t count)
+{
+    maxSubcompactions = count;
+    if (lsmTree)
+    {
+        lsmTree->setMaxSubcompactions(count);
+    }
+}
+
+void KVStore::SetRateLimit(int64_t bytesPerSecond, bool autoTune, int64_t minBytesPerSecond)
+{
+    rateLimit = bytesPerSecond;
+    rateLimitAutoTune = autoTune;
+    minRateLimit = minBytesPerSecond;
+    if (lsmTree)
+    {
+        lsmTree->getRateLimiter().setBytesPerSecond(bytesPerSecond);
+        lsmTree->getRateLimiter().setAutoTune(autoTune, minBytesPerSecond);
+    }
+}
+
+RateLimiterStats KVStore::GetRateLimiterStats(IOPriority priority) const
+{
+    return lsmTree ? lsmTree->getRateLimiter().getStats(priority) : RateLimiterStats();
+}
+
+void KVStore::SetBackgroundCompaction(bool enabled)
+{
+    backgroundCompaction = enabled;
+    if (lsmTree)
+    {
+        lsmTree->setBackgroundCompaction(enabled);
+    }
+}
+
+void KVStore::SetWriteStallOptions(const WriteStallOptions &options)
+{
+    if (lsmTree)
+    {
+        lsmTree->setWriteStallOptions(options);
+    }
+    writeStallOptions = options;
+}
+
+WriteStallStats KVStore::GetWriteStallStats() const
+{
+    return lsmTree ? lsmTree->getWriteStallStats() : WriteStallStats();
+}
+
+CompactRangeStats KVStore::CompactRange(int64_t start, int64_t end)
+{
+    if (!lsmTree)
+    {
+        throw std::runtime_error("Cannot compact a database that is not open.");
+    }
+    write(nullptr, 0, true); // Flush behind the writes queued so far
+    return lsmTree->compactRange(start, end);
+}
+
+KVStoreStats KVStore::GetStats() const
+{
+    KVStoreStats stats;
+    if (!lsmTree)
+    {
+        return stats;
+    }
+    stats.userBytesWritten = userBytesWritten;
+    stats.writes = writes;
+    stats.writeGroups = writeGroups;
+    stats.flushes = flushes;
+    stats.flushBytesWritten = flushBytesWritten;
+    stats.flushMicros = flushMicros;
+    stats.compactions = lsmTree->getCompactionStats();
+    stats.flushIO = lsmTree->getRateLimiter().getStats(IOPriority::High);
+    stats.compactionIO = lsmTree->getRateLimiter().getStats(IOPriority::Low);
+    stats.writeStalls = lsmTree->getWriteStallStats();
+
+    int64_t totalBytes = 0, lastLevelBytes = 0;
+    for (size_t level = 0; level < lsmTree->getNumLevels(); ++level)
+    {
+        stats.levelFiles.push_back(lsmTree->getLevelFileCount(level));
+        stats.levelBytes.push_back(lsmTree->getLevelBytes(level));
+        totalBytes += stats.levelBytes.back();
+        if (stats.levelBytes.back() > 0)
+        {
+            lastLevelBytes = stats.levelBytes.back();
+        }
+    }
+
+    int64_t bytesWritten = flushBytesWritten;
+    for (const auto &level : stats.compactions)
+    {
+        bytesWritten += level.bytesWritten;
+    }
+    if (userBytesWritten > 0)
+    {
+        stats.writeAmplification = static_cast<double>(bytesWritten) / userBytesWritten;
+    }
+    if (lastLevelBytes > 0)
+    {
+        stats.spaceAmplification = static_cast<double>(totalBytes) / lastLevelBytes;
+    }
+    return stats;
+}
+
+void KVStore::SetBlockSize(int size)
+{
+    if (!SST::isValidBlockSize(size))
+    {
+        throw std::runtime_error("Block size must be a multiple of " + std::to_string(PAGE_SIZE) +
+                                 " bytes no larger than " + std::to_string(MAX_BLOCK_SIZE) + " bytes.");
+    }
+    blockSize = size;
+    if (lsmTree)
+    {
+        lsmTree->setBlockSize(size);
+    }
+}
+
+namespace
+{
+    // Reads the CSV metadata log that databases wrote on Close before the manifest
+    void readLegacyLog(const std::string &path, ManifestState &state)
+    {
+        std::ifstream meta_file(path);
+        if (!meta_file.is_open())
+        {
+            throw std::runtime_error("Failed to open metadata log: " + path);
+        }
+
+        std::string line;
+        while (std::getline(meta_file, line))
+        {
+            std::stringstream ss(line);
+            std::vector<std::string> fields;
+            std::string field;
+            while (std::getline(ss, field, ','))
+            {
+                fields.push_back(field);
+            }
+            if (fields.size() < 2)
+                continue;
+
+            if (fields[0] == "counter")
+            {
+                state.fileCounter = std::stoul(fields[1]);
+            }
+            else if (fields[0] == "policy")
+            {
+                CompactionStyle style;
+                if (!parseCompactionStyle(fields[1], style))
+                {
+                    throw std::runtime_error("Unknown compaction style in metadata log: " + fields[1]);
+                }
+                state.compactionStyle = style;
+            }
+            else if (fields[0] == "size_ratio")
+            {
+                state.sizeRatio = std::stoul(fields[1]);
+            }
+            else if (fields[0] == "target_file_size")
+            {
+                state.targetFileSize = std::stoll(fields[1]);
+            }
+            else if (fields[0] == "level_options" && fields.size() == 4)
+            {
+                size_t level = std::stoul(fields[1]);
+                state.levelOptions.resize(std::max(state.levelOptions.size(), level + 1));
+                state.levelOptions[level].sizeRatio = std::stoul(fields[2]);
+                state.levelOptions[level].maxRuns = std::stoul(fields[3]);
+            }
+            else
+            {
+                // Level and SST path; the manifest keeps only the file name
+                size_t level = std::stoul(fields[0]);
+                state.levels.resize(std::max(state.levels.size(), level + 1));
+                state.levels[level].push_back(std::filesystem::path(fields[1]).filename().string());
+            }
+        }
+    }
+}
+
 void KVStore::Open(const std::string &database_name)
 {
     db_name = "../" + database_name;
-    lsmTree = std::make_unique<LSMTree>(db_name, 2);
-    sst_counter = 0;
+    userBytesWritten = writes = writeGroups = flushes = flushBytesWritten = flushMicros = 0;
+    std::string manifest_path = db_name + "/" + MANIFEST_FILENAME;
+    std::string legacy_path = db_name + "/lsmtree.log";
+    ManifestState state;
 
     if (!std::filesystem::exists(db_name))
     {
@@ -44,83 +296,228 @@ void KVStore::Open(const std::string &database_name)
             throw std::runtime_error("Failed to create database directory: " + db_name);
         }
         std::cout << "Created new database directory: " << db_name << std::endl;
+    }
+    else if (!Manifest::replay(manifest_path, state))
+    {
+        // **Existing Database** without a manifest: migrate its metadata log, if any
+        if (std::filesystem::exists(legacy_path))
+        {
+            readLegacyLog(legacy_path, state);
+        }
+        else
+        {
+            std::cout << "Manifest not found. Initializing empty LSMTree." << std::endl;
+        }
+    }
 
-        // Initialize LSMTree without existing SSTs
-        lsmTree = std::make_unique<LSMTree>(db_name, 2); // Assuming '2' is the number of levels
+    // Compaction settings persisted with the tree replace the configured ones
+    if (state.compactionStyle)
+    {
+        compactionStyle = *state.compactionStyle;
     }
-    else
+    if (state.sizeRatio)
     {
-        // **Existing Database**
-        std::string metadata_path = db_name + "/lsmtree.log";
+        levelSizeRatio = *state.sizeRatio;
+    }
+    if (state.targetFileSize)
+    {
+        targetFileSize = *state.targetFileSize;
+    }
+    if (!state.levelOptions.empty())
+    {
+        levelOptions = state.levelOptions;
+    }
 
-        // Initialize LSMTree
-        lsmTree = std::make_unique<LSMTree>(db_name, 2);
+    // The policy is set before the SSTs are added, since it decides how the levels are read
+    lsmTree = std::make_unique<LSMTree>(db_name, levelSizeRatio);
+    lsmTree->setPageFormat(pageFormat);
+    lsmTree->setMmapReads(mmapReads);
+    lsmTree->setDirectIO(directIO);
+    lsmTree->setCompression(compression, compressionMinLevel);
+    lsmTree->setBlockSize(blockSize);
+    lsmTree->setCompactionStyle(compactionStyle);
+    lsmTree->setTargetFileSize(targetFileSize);
+    for (size_t level = 0; level < levelOptions.size(); ++level)
+    {
+        lsmTree->setLevelOptions(level, levelOptions[level]);
+    }
+    lsmTree->setMaxSubcompactions(maxSubcompactions);
+    lsmTree->getRateLimiter().setBytesPerSecond(rateLimit);
+    lsmTree->getRateLimiter().setAutoTune(rateLimitAutoTune, minRateLimit);
+    lsmTree->setWriteStallOptions(writeStallOptions);
+    lsmTree->setFileCounter(state.fileCounter);
+
+    std::vector<std::vector<std::string>> sst_files(state.levels.size());
+    std::unordered_set<std::string> live_files;
+    for (size_t level = 0; level < state.levels.size(); ++level)
+    {
+        for (const auto &name : state.levels[level])
+        {
+            sst_files[level].push_back(db_name + "/" + name);
+            live_files.insert(name);
+        }
+    }
+    lsmTree->restoreLevels(sst_files);
+    if (!live_files.empty())
+    {
+        std::cout << "Reconstructed LSMTree from manifest." << std::endl;
+    }
 
-        // Check if lsmtree.log exists
-        if (std::filesystem::exists(metadata_path))
+    // SSTs written by a flush or compaction whose edit never reached the
+    // manifest belong to no level; a crash left them behind
+    for (const auto &entry : std::filesystem::directory_iterator(db_name))
+    {
+        std::string name = entry.path().filename().string();
+        if (entry.path().extension() == ".sst" && live_files.count(name) == 0)
         {
-            std::ifstream meta_file(metadata_path);
-            if (!meta_file.is_open())
-            {
-                throw std::runtime_error("Failed to open metadata log: " + metadata_path);
-            }
+            std::cout << "Removing orphaned SST: " << name << std::endl;
+            std::filesystem::remove(entry.path());
+        }
+    }
 
-            std::string line;
-            bool counter_read = false;
-            while (std::getline(meta_file, line))
-            {
-                std::stringstream ss(line);
-                std::string first_field, second_field;
+    // From here on every change to the levels is logged as it happens
+    lsmTree->setManifest(std::make_unique<Manifest>(manifest_path));
+    std::filesystem::remove(legacy_path);
+    lsmTree->setBackgroundCompaction(backgroundCompaction);
+    memtable.store(std::make_shared<AVLTree>(memtable_size));
+}
 
-                if (!std::getline(ss, first_field, ','))
-                    continue;
+void KVStore::Put(int64_t key, int64_t value)
+{
+    std::pair<int64_t, int64_t> entry(key, value);
+    write(&entry, 1);
+}
 
-                if (!counter_read)
-                {
-                    // Read the counter from the first line
-                    if (first_field == "counter")
-                    {
-                        if (!std::getline(ss, second_field, ','))
-                            continue;
-                        sst_counter = std::stoul(second_field);
-                        counter_read = true;
-                        continue;
-                    }
-                }
+void WriteBatch::Put(int64_t key, int64_t value)
+{
+    entries.emplace_back(key, value);
+}
 
-                // Read level and sst_filename
-                std::string level_str = first_field;
-                if (!std::getline(ss, second_field, ','))
-                    continue;
+void WriteBatch::Del(int64_t key)
+{
+    Put(key, TOMBSTONE);
+}
 
-                size_t level = std::stoul(level_str);
-                std::string sst_filename = second_field;
+void WriteBatch::Clear()
+{
+    entries.clear();
+}
 
-                // Add SST to the specified level
-                lsmTree->addSSTToLevel(sst_filename, level);
-            }
-            meta_file.close();
-            std::cout << "Reconstructed LSMTree from metadata log." << std::endl;
+size_t WriteBatch::Count() const
+{
+    return entries.size();
+}
+
+void KVStore::Write(const WriteBatch &batch)
+{
+    if (batch.entries.empty())
+    {
+        return;
+    }
+    write(batch.entries.data(), batch.entries.size());
+}
+
+void KVStore::write(const std::pair<int64_t, int64_t> *entries, size_t count, bool flush)
+{
+    Writer writer{entries, count, flush};
+    std::unique_lock<std::mutex> lock(writeMutex);
+    writers.push_back(&writer);
+    while (!writer.done && writers.front() != &writer)
+    {
+        writer.signal.wait(lock);
+    }
+    if (writer.done)
+    {
+        // Applied by the writer ahead of this one
+        if (writer.error)
+        {
+            std::rethrow_exception(writer.error);
         }
-        else
+        return;
+    }
+
+    // This writer leads: it applies itself and every write queued behind it.
+    // Writes queued meanwhile wait for the next group.
+    std::vector<Writer *> group(writers.begin(), writers.end());
+    lock.unlock();
+
+    std::exception_ptr error;
+    try
+    {
+        applyWriteGroup(group);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    lock.lock();
+    for (Writer *member : group)
+    {
+        writers.pop_front();
+        member->done = true;
+        member->error = error;
+        if (member != &writer)
         {
-            std::cout << "Metadata log not found. Initializing empty LSMTree." << std::endl;
+            member->signal.notify_one();
         }
     }
+    if (!writers.empty())
+    {
+        writers.front()->signal.notify_one(); // The next leader
+    }
+    lock.unlock();
 
-    memtable.clear();
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
 }
 
-void KVStore::Put(int64_t key, int64_t value)
+void KVStore::applyWriteGroup(const std::vector<Writer *> &group)
 {
-    // Insert the key-value pair into the AVLTree (memtable)
-    memtable.put(key, value);
+    size_t entries = 0;
+    bool flush = false;
+    for (const Writer *member : group)
+    {
+        entries += member->count;
+        flush = flush || member->flush;
+    }
+    int64_t bytes = entries * (sizeof(int64_t) + sizeof(int64_t));
 
-    // Check if the memtable has reached its size limit
-    if (memtable.getCurrentSize() >= memtable_size)
+    // Hold the group back while compaction debt is past the stall limits
+    lsmTree->throttleWrite(bytes);
+    userBytesWritten += bytes;
+    writes += entries;
+    writeGroups++;
+
+    for (const Writer *member : group)
+    {
+        if (member->count == 0)
+        {
+            continue;
+        }
+
+        // A write is admitted whole: a memtable without room for it is flushed first
+        std::shared_ptr<AVLTree> mem = memtable.load();
+        if (mem->getCurrentSize() > 0 && mem->getCurrentSize() + member->count > static_cast<size_t>(memtable_size))
+        {
+            flushMemtableToSST();
+            mem = memtable.load();
+        }
+
+        // Insert the key-value pairs into the AVLTree (memtable)
+        mem->put(member->entries, member->count);
+
+        // Check if the memtable has reached its size limit
+        if (mem->getCurrentSize() >= memtable_size)
+        {
+            flushMemtableToSST();
+        }
+    }
+    if (flush && memtable.load()->getCurrentSize() > 0)
     {
         flushMemtableToSST();
-        memtable.clear();
     }
 }
 
@@ -131,150 +528,343 @@ void KVStore::Del(int64_t key)
 
 void KVStore::Close()
 {
+    // Let the running compaction finish; the manifest already holds the levels it leaves
+    lsmTree->setBackgroundCompaction(false);
+
     // Flush the memtable to SST if it is not empty
-    if (memtable.getCurrentSize() > 0)
-    {
-        flushMemtableToSST();
-    }
+    write(nullptr, 0, true);
+
+    // Clear the memtable and SST filenames
+    memtable.store(std::make_shared<AVLTree>(memtable_size));
+    lsmTree->clearLevels();
+}
 
-    // Gather all SST filenames from the LSM Tree
-    std::vector<std::vector<std::string>> levels;
-    size_t num_levels = lsmTree->getNumLevels();
-    for (size_t level = 0; level < num_levels; ++level)
+int64_t KVStore::Get(int64_t key)
+{
+    // Step 1: Check in the memtable first. It is loaded before the version,
+    // so keys a concurrent flush moves out of it are found in the version.
+    std::shared_ptr<AVLTree> mem = memtable.load();
+    int64_t result = mem->get(key);
+    if (result != -1) // Assuming -1 indicates "not found" in memtable
     {
-        levels.emplace_back(lsmTree->getSSTFilesByLevel(level));
+        return result == TOMBSTONE ? -1 : result;
     }
 
-    // Write metadata to a temporary log file
-    std::string metadata_path = db_name + "/lsmtree.log";
-    std::string temp_metadata_path = metadata_path + ".tmp";
-    std::ofstream meta_file(temp_metadata_path, std::ios::out | std::ios::trunc);
-    if (!meta_file.is_open())
+    // Step 2: Search the LSM Tree level by level. The version keeps its SSTs
+    // on disk until the lookup ends, even if a compaction replaces them.
+    std::shared_ptr<const Version> version = lsmTree->getCurrentVersion();
+    for (size_t level = 0; level < version->getNumLevels(); ++level)
     {
-        throw std::runtime_error("Failed to open temporary metadata log for writing.");
+        // Only the SSTs whose key range holds the key, newest first
+        auto sstFiles = version->getFilesForKey(level, key);
+
+        for (const auto &file : sstFiles)
+        {
+            const std::shared_ptr<SSTReader> &reader = file->reader;
+
+            BloomFilter bloom = BloomFilter(NUM_ENTRIES, BITS_PER_ENTRY);
+            std::vector<char> bloom_buffer;
+            bool found = true;
+
+            // Read the bitVector located by the SST footer
+            const char *bits = readFilter(*reader, bloom_buffer);
+            for (int hash : bloom.getHashValues(key))
+            {
+                if (!bits[hash])
+                {
+                    found = false;
+                    break; // Abort on first zero
+                }
+            }
+            if (!found)
+            {
+                continue;
+            }
+
+            // Perform a binary search or B-Tree search on this SST file
+            if (useBTree)
+            {
+                result = btreeSearchSST(*reader, key);
+            }
+            else
+            {
+                result = binarySearchSST(*reader, key);
+            }
+
+            if (result != -1) // Check if the key was found
+            {
+                // Return the found value if key is found in this SST
+                return result == TOMBSTONE ? -1 : result;
+            }
+        }
     }
 
-    meta_file << "counter," << sst_counter << "\n";
+    return -1; // Return -1 if the key was not found in memtable or any SST file
+}
 
-    for (size_t level = 0; level < levels.size(); ++level)
+std::vector<int64_t> KVStore::MultiGet(const std::vector<int64_t> &keys)
+{
+    // Sorted, distinct keys; values[i] belongs to sorted[i]
+    std::vector<int64_t> sorted(keys);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    std::vector<int64_t> values(sorted.size(), -1);
+    std::vector<bool> resolved(sorted.size(), false);
+    size_t pending = sorted.size();
+
+    // Step 1: The memtable, loaded before the version as in Get
+    std::shared_ptr<AVLTree> mem = memtable.load();
+    for (size_t i = 0; i < sorted.size(); ++i)
     {
-        for (const auto &sst_filename : levels[level])
+        int64_t result = mem->get(sorted[i]);
+        if (result != -1)
         {
-            meta_file << level << "," << sst_filename << "\n";
+            values[i] = result;
+            resolved[i] = true;
+            --pending;
         }
     }
-    meta_file.close();
 
-    // Atomically replace the old metadata log with the new one
-    std::filesystem::rename(temp_metadata_path, metadata_path);
-    std::cout << "Metadata log updated at: " << metadata_path << std::endl;
+    // Step 2: Every level from the newest SST to the oldest; each SST looks up
+    // the keys in its range that no newer SST resolved
+    std::shared_ptr<const Version> version = lsmTree->getCurrentVersion();
+    for (size_t level = 0; level < version->getNumLevels() && pending > 0; ++level)
+    {
+        const Version::Level &files = version->getFiles(level);
+        bool sortedLevel = version->isSortedLevel(level);
+        for (size_t n = 0; n < files.size() && pending > 0; ++n)
+        {
+            // Overlapping levels are searched newest first
+            const SSTReader &reader = *files[sortedLevel ? n : files.size() - 1 - n]->reader;
+            size_t first = std::lower_bound(sorted.begin(), sorted.end(), reader.startingKey) - sorted.begin();
+            size_t last = std::upper_bound(sorted.begin(), sorted.end(), reader.endingKey) - sorted.begin();
+            if (first < last)
+            {
+                size_t before = std::count(resolved.begin() + first, resolved.begin() + last, true);
+                multiGetSST(reader, sorted, first, last, values, resolved);
+                pending -= std::count(resolved.begin() + first, resolved.begin() + last, true) - before;
+            }
+        }
+    }
 
-    // Clear the memtable and SST filenames
-    memtable.clear();
-    lsmTree->clearLevels();
+    // Deleted keys are not found
+    std::vector<int64_t> results;
+    results.reserve(keys.size());
+    for (int64_t key : keys)
+    {
+        int64_t value = values[std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin()];
+        results.push_back(value == TOMBSTONE ? -1 : value);
+    }
+    return results;
 }
 
-int64_t KVStore::Get(int64_t key)
+void KVStore::multiGetSST(const SSTReader &reader, const std::vector<int64_t> &keys, size_t first, size_t last,
+                          std::vector<int64_t> &values, std::vector<bool> &resolved)
 {
-    // Step 1: Check in the memtable first
-    int64_t result = memtable.get(key);
-    if (result != -1) // Assuming -1 indicates "not found" in memtable
+    // One read of the Bloom filter serves every key
+    std::vector<char> bloom_buffer;
+    const char *bits = nullptr;
+    BloomFilter bloom(NUM_ENTRIES, BITS_PER_ENTRY);
+    std::vector<std::pair<size_t, int>> candidates; // Key index and its candidate page
+    for (size_t i = first; i < last; ++i)
     {
-        if (result == TOMBSTONE)
+        if (resolved[i])
         {
-            std::cout << "DEBUG: Key " << key << " is a tombstone." << std::endl;
-            return -1;
+            continue;
         }
-        else
+        if (!bits)
+        {
+            bits = readFilter(reader, bloom_buffer);
+        }
+        std::vector<int> hashes = bloom.getHashValues(keys[i]);
+        if (std::any_of(hashes.begin(), hashes.end(), [bits](int hash)
+                        { return !bits[hash]; }))
+        {
+            continue;
+        }
+        int page = reader.findPage(keys[i]);
+        if (page != -1)
         {
-            std::cout << "DEBUG: Found key " << key << " in memtable with value: " << result << std::endl;
-            return result;
+            candidates.emplace_back(i, page);
         }
     }
 
-    std::cout << "DEBUG: Key " << key << " not found in memtable. Searching SST files in LSM Tree..." << std::endl;
-
-    // Step 2: Search the LSM Tree level by level
-    for (size_t level = 0; level < lsmTree->getNumLevels(); ++level)
+    // The keys are sorted, so keys sharing a page come one after another; every
+    // distinct page is read once, all of them together
+    std::vector<off_t> offsets;
+    for (const auto &[i, page] : candidates)
     {
-        auto sstFiles = lsmTree->getSSTFilesByLevel(level);
-        std::cout << "DEBUG: Searching in Level " << level << " with " << sstFiles.size() << " SST files..." << std::endl;
-
-        for (const auto &sst_filename : sstFiles)
+        if (offsets.empty() || offsets.back() != reader.getPageOffset(page))
         {
-            std::cout << "DEBUG: Searching key " << key << " in SST file: " << sst_filename << std::endl;
+            offsets.push_back(reader.getPageOffset(page));
+        }
+    }
 
-            int sst_fd = open(sst_filename.c_str(), O_RDONLY);
-            if (sst_fd == -1)
-            {
-                std::cerr << "ERROR: Failed to open SST file for reading: " << sst_filename << std::endl;
-                continue; // Skip this SST file
-            }
+    // Mapped pages are searched in place; the rest are read together
+    std::vector<const char *> blocks(offsets.size());
+    std::vector<off_t> unmapped;
+    for (size_t j = 0; j < offsets.size(); ++j)
+    {
+        blocks[j] = reader.getMappedBlock(offsets[j]);
+        if (!blocks[j])
+        {
+            unmapped.push_back(offsets[j]);
+        }
+    }
+    AlignedBuffer pages(unmapped.size() * reader.blockSize);
+    readBlocks(reader, unmapped, pages.data());
+    for (size_t j = 0, slot = 0; j < offsets.size(); ++j)
+    {
+        if (!blocks[j])
+        {
+            blocks[j] = pages.data() + slot++ * reader.blockSize;
+        }
+    }
 
-            BloomFilter bloom = BloomFilter(NUM_ENTRIES, BITS_PER_ENTRY);
-            char bloom_buffer[PAGE_SIZE];
+    size_t loaded = 0;
+    for (const auto &[i, page] : candidates)
+    {
+        while (offsets[loaded] != reader.getPageOffset(page))
+        {
+            ++loaded;
+        }
+        int64_t value = searchInPage(blocks[loaded], keys[i]);
+        if (value != -1)
+        {
+            values[i] = value;
+            resolved[i] = true;
+        }
+    }
+}
 
-            off_t bloom_offset = SST_METADATA_SIZE;
-            bool found = true;
+Task<int64_t> KVStore::GetAsync(int64_t key, Executor &executor)
+{
+    // The memtable is read before the version, as in Get
+    std::shared_ptr<AVLTree> mem = memtable.load();
+    int64_t result = mem->get(key);
+    if (result != -1)
+    {
+        co_return result == TOMBSTONE ? -1 : result;
+    }
 
-            // Read the bitVector
-            ssize_t bytes_read = pread(sst_fd, bloom_buffer, PAGE_SIZE, bloom_offset);
-            if (bytes_read == -1 || bytes_read != PAGE_SIZE)
-            {
-                close(sst_fd);
-                throw std::runtime_error("Failed to read bitVector.");
-            }
-            for (int hash : bloom.getHashValues(key))
+    // The version keeps its SSTs open until the lookup ends
+    std::shared_ptr<const Version> version = lsmTree->getCurrentVersion();
+    BloomFilter bloom(NUM_ENTRIES, BITS_PER_ENTRY);
+    for (size_t level = 0; level < version->getNumLevels(); ++level)
+    {
+        for (const auto &file : version->getFilesForKey(level, key))
+        {
+            const SSTReader &reader = *file->reader;
+            std::vector<char> bloom_buffer;
+            const char *bits = reader.getMappedRange(reader.filterOffset, reader.filterSize);
+            if (!bits)
             {
-                if (!bloom_buffer[hash])
+                bloom_buffer.resize(reader.filterSize);
+                std::vector<ReadRequest> filterRead(1);
+                filterRead[0] = {reader.fd, bloom_buffer.data(), bloom_buffer.size(), reader.filterOffset};
+                co_await ReadAwaiter(executor, filterRead);
+                if (filterRead[0].result != (ssize_t)bloom_buffer.size())
                 {
-                    std::cout << "DEBUG: Key " << key << " not found in using Bloom Filter." << std::endl;
-                    found = false;
-                    break; // Abort on first zero
+                    throw std::runtime_error("Failed to read bitVector.");
                 }
+                bits = bloom_buffer.data();
             }
-            if (!found)
+            std::vector<int> hashes = bloom.getHashValues(key);
+            if (std::any_of(hashes.begin(), hashes.end(), [bits](int hash)
+                            { return !bits[hash]; }))
             {
-                close(sst_fd);
                 continue;
             }
 
-            // Perform a binary search or B-Tree search on this SST file
-            if (useBTree)
+            int page = reader.findPage(key);
+            if (page == -1)
             {
-                result = btreeSearchSST(sst_fd, key, sst_filename);
+                continue;
             }
-            else
+            AlignedBuffer page_buffer(reader.blockSize);
+            const char *block = reader.getMappedBlock(reader.getPageOffset(page));
+            if (!block)
+            {
+                std::vector<off_t> offsets(1, reader.getPageOffset(page));
+                co_await readBlocksAsync(reader, offsets, page_buffer.data(), executor);
+                block = page_buffer.data();
+            }
+            result = searchInPage(block, key);
+            if (result != -1)
             {
-                result = binarySearchSST(sst_fd, sst_filename, key);
+                co_return result == TOMBSTONE ? -1 : result;
             }
+        }
+    }
+    co_return -1;
+}
 
-            close(sst_fd);
+Task<std::vector<std::pair<int64_t, int64_t>>> KVStore::ScanAsync(int64_t start, int64_t end, Executor &executor)
+{
+    std::vector<std::pair<int64_t, int64_t>> results;
+    std::unordered_set<int64_t> seen_keys;
+    std::shared_ptr<AVLTree> mem = memtable.load();
+    addScanResults(mem->scan(start, end), seen_keys, results);
 
-            if (result != -1) // Check if the key was found
+    // Newer SSTs first, all of one version, as in mergedScan
+    std::shared_ptr<const Version> version = lsmTree->getCurrentVersion();
+    for (size_t level = 0; level < version->getNumLevels(); ++level)
+    {
+        for (const auto &file : version->getFilesForRange(level, start, end))
+        {
+            const SSTReader &reader = *file->reader;
+            int firstPage = reader.findPage(std::max(start, reader.startingKey));
+            int lastPage = reader.findPage(std::min(end, reader.endingKey));
+            if (firstPage == -1 || lastPage == -1)
             {
+                continue;
+            }
 
-                if (result == TOMBSTONE)
+            // The pages in range are read IO_QUEUE_DEPTH at a time, with the kernel
+            // prefetching ahead of each batch
+            ReadAhead readAhead(reader.fd, reader.getDataEndOffset(), reader.directFd == -1 ? SCAN_READAHEAD_SIZE : 0, reader.mapping);
+            std::vector<std::pair<int64_t, int64_t>> entries;
+            for (int page = firstPage; page <= lastPage; page += IO_QUEUE_DEPTH)
+            {
+                int count = std::min<int>(IO_QUEUE_DEPTH, lastPage - page + 1);
+                std::vector<off_t> offsets;
+                for (int i = 0; i < count; ++i)
                 {
-                    std::cout << "DEBUG: Key " << key << " is a tombstone." << std::endl;
-                    return -1;
+                    offsets.push_back(reader.getPageOffset(page + i));
                 }
-                else
+                readAhead.onRead(offsets.front(), reader.getPageOffset(page + count) - offsets.front());
+                AlignedBuffer pages(offsets.size() * reader.blockSize);
+                co_await readBlocksAsync(reader, offsets, pages.data(), executor);
+                for (int i = 0; i < count; ++i)
                 {
-                    std::cout << "DEBUG: Found key " << key << " in SST file: " << sst_filename
-                              << " with value: " << result << std::endl;
-                    return result; // Return the found value if key is found in this SST
+                    scanPage(pages.data() + static_cast<size_t>(i) * reader.blockSize, start, end, entries);
                 }
             }
-            else
-            {
-                std::cout << "DEBUG: Key " << key << " not found in SST file: " << sst_filename << std::endl;
-            }
+            addScanResults(entries, seen_keys, results);
         }
     }
 
-    std::cout << "DEBUG: Key " << key << " not found in any SST file in LSM Tree. Returning -1." << std::endl;
-    return -1; // Return -1 if the key was not found in memtable or any SST file
+    std::sort(results.begin(), results.end());
+    co_return results;
+}
+
+void KVStore::GetAsync(int64_t key, Executor &executor, std::function<void(int64_t, std::exception_ptr)> done)
+{
+    GetAsync(key, executor).start(std::move(done));
+}
+
+void KVStore::ScanAsync(int64_t start, int64_t end, Executor &executor,
+                        std::function<void(std::vector<std::pair<int64_t, int64_t>>, std::exception_ptr)> done)
+{
+    ScanAsync(start, end, executor).start(std::move(done));
+}
+
+Task<size_t> KVStore::readBlocksAsync(const SSTReader &reader, std::vector<off_t> offsets, char *buffer, Executor &executor)
+{
+    BlockReads reads = startBlockReads(reader, offsets, buffer);
+    co_await ReadAwaiter(executor, reads.requests);
+    finishBlockReads(reader, reads, buffer);
+    co_return reads.requests.size();
 }
 
 std::pair<int64_t, int64_t> *KVStore::Scan(int64_t start, int64_t end, int &result_count)
@@ -300,14 +890,14 @@ std::pair<int64_t, int64_t> *KVStore::Scan(int64_t start, int64_t end, int &resu
 
 void KVStore::flushMemtableToSST()
 {
-    SST sst;
-    auto kv_pairs = memtable.scan(INT_MIN, INT_MAX);
+    SST sst(lsmTree->getCompression(0), blockSize);
+    auto kv_pairs = memtable.load()->scan(INT_MIN, INT_MAX);
 
     // Set SST starting and ending keys
     sst.startingKey = kv_pairs.front().first;
     sst.endingKey = kv_pairs.back().first;
 
-    Page currentPage;
+    Page currentPage(pageFormat, blockSize);
     for (const auto &kv : kv_pairs)
     {
         int64_t key = kv.first;
@@ -318,7 +908,7 @@ void KVStore::flushMemtableToSST()
         {
             // If the page is full, add it to the SST and start a new page
             sst.addPage(currentPage);
-            currentPage = Page();             // Create a new page
+            currentPage = Page(pageFormat, blockSize); // Create a new page
             currentPage.addEntry(key, value); // Add the entry to the new page
         }
     }
@@ -330,331 +920,228 @@ void KVStore::flushMemtableToSST()
     }
 
     // Define file path and write to file
-    std::string sst_filename = db_name + "/sst_" + std::to_string(++sst_counter) + ".sst";
-    sst.writeToFile(sst_filename);
+    std::string sst_filename = lsmTree->newSSTFilename();
+    auto started = std::chrono::steady_clock::now();
+    sst.writeToFile(sst_filename, &lsmTree->getRateLimiter(), directIO);
+    flushMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+    flushBytesWritten += std::filesystem::file_size(sst_filename);
+    flushes++;
 
     // Update LSMTree with the new SST filename and trigger compaction if needed
     lsmTree->addSST(sst_filename);
 
-    // Clear the memtable
-    memtable.clear();
+    // Then replace the memtable; readers still holding the full one keep it
+    memtable.store(std::make_shared<AVLTree>(memtable_size));
 }
 
-int64_t KVStore::binarySearchSST(int sst_fd, const std::string &sst_filename, int64_t target_key)
+void KVStore::readPage(const SSTReader &reader, off_t offset, char *buffer)
 {
-
-    // Read SST metadata
-    int num_pages;
-    off_t offset = sizeof(int); // Skip `numEntries` in SST metadata
-    pread(sst_fd, &num_pages, sizeof(num_pages), offset);
-
-    if (num_pages <= 0)
+    // Mapped SSTs are cached by the page cache alone
+    if (reader.isMapped())
     {
-        throw std::runtime_error("SST file has no pages.");
+        reader.readBlock(offset, buffer);
+        return;
     }
 
-    // Binary search the pages
-    int left = 0, right = num_pages - 1;
-    char page_buffer[PAGE_SIZE];
-    while (left <= right)
+    std::string pageID = reader.cacheKey + ":" + std::to_string(offset);
+
+    // Check if the page is in the buffer pool
+    BufferPool &bufferPool = BufferPoolManager::getShard(pageID);
+    if (bufferPool.copyPage(pageID, buffer))
     {
-        int mid = left + (right - left) / 2;
-        off_t page_offset = SST_METADATA_SIZE + PAGE_SIZE + (mid * PAGE_SIZE);
+        return;
+    }
 
-        std::string pageID = sst_filename + ":" + std::to_string(page_offset);
+    // Read (and decompress) the page, then cache the decompressed page in the buffer pool.
+    // The latency of foreground reads from disk drives the auto-tuned rate limit.
+    auto start = std::chrono::steady_clock::now();
+    size_t size = reader.readBlock(offset, buffer);
+    lsmTree->getRateLimiter().recordForegroundLatency(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
 
-        // Check if the page is in the buffer pool
-        BufferPool &bufferPool = BufferPoolManager::getInstance();
-        Page *cachedPage = bufferPool.getPage(pageID);
-        char page_buffer[PAGE_SIZE];
+    Page page;
+    page.data.assign(buffer, buffer + size); // Populate page data
+    bufferPool.insertPage(pageID, page);          // Insert into buffer pool
+}
 
-        if (cachedPage)
+void KVStore::readBlocks(const SSTReader &reader, const std::vector<off_t> &offsets, char *buffer)
+{
+    if (!asyncIO || offsets.size() < 2)
+    {
+        for (size_t i = 0; i < offsets.size(); ++i)
         {
-            std::cout << "Buffer pool accessed" << std::endl;
-            // Load data from the buffer pool
-            std::memcpy(page_buffer, cachedPage->data.data(), PAGE_SIZE);
+            readPage(reader, offsets[i], buffer + i * reader.blockSize);
         }
-        else
-        {
-            // Read the page
-            ssize_t bytes_read = pread(sst_fd, page_buffer, PAGE_SIZE, page_offset);
-            if (bytes_read == -1 || bytes_read != PAGE_SIZE)
-            {
-                throw std::runtime_error("Failed to read page.");
-            }
+        return;
+    }
 
-            Page page;
-            page.data.assign(page_buffer, page_buffer + PAGE_SIZE); // Populate page data
-            bufferPool.insertPage(pageID, page);                    // Insert into buffer pool
-        }
+    BlockReads reads = startBlockReads(reader, offsets, buffer);
+    if (reads.requests.empty())
+    {
+        return;
+    }
 
-        // Deserialize page metadata
-        int page_num_entries;
-        int64_t page_starting_key;
-        std::memcpy(&page_num_entries, page_buffer, sizeof(int));
-        std::memcpy(&page_starting_key, page_buffer + sizeof(int), sizeof(int64_t));
+    auto start = std::chrono::steady_clock::now();
+    IOQueue::forThread().readAll(reads.requests);
+    lsmTree->getRateLimiter().recordForegroundLatency(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
 
-        int64_t next_page_starting_key = INT64_MAX;
-        if (mid < num_pages - 1)
-        {
-            off_t next_page_offset = SST_METADATA_SIZE + PAGE_SIZE + ((mid + 1) * PAGE_SIZE);
-            pread(sst_fd, &next_page_starting_key, sizeof(int64_t), next_page_offset + sizeof(int));
-        }
+    finishBlockReads(reader, reads, buffer);
+}
 
-        if (target_key < page_starting_key)
+KVStore::BlockReads KVStore::startBlockReads(const SSTReader &reader, const std::vector<off_t> &offsets, char *buffer)
+{
+    // Blocks in the buffer pool are copied; the rest are left to read
+    BlockReads reads;
+    reads.aside.reserve(offsets.size());
+    for (size_t i = 0; i < offsets.size(); ++i)
+    {
+        std::string pageID = reader.cacheKey + ":" + std::to_string(offsets[i]);
+        char *target = buffer + i * reader.blockSize;
+        if (reader.isMapped())
         {
-            right = mid - 1;
+            reader.readBlock(offsets[i], target);
+            continue;
         }
-        else if (target_key < next_page_starting_key)
+        if (BufferPoolManager::getShard(pageID).copyPage(pageID, target))
         {
-            // Process keys in this page
-            size_t offset_in_page = sizeof(int) + sizeof(int64_t) + sizeof(int); // Skip metadata
-
-            // Binary search within the key-offset vector
-            int low = 0, high = page_num_entries; // `page_num_entries` includes all entries in the page
-            while (low <= high)
-            {
-                int mid = low + (high - low) / 2;
-                size_t key_offset_position = offset_in_page + mid * (sizeof(int64_t) + sizeof(int));
-
-                // Read the key and value offset at the `mid` position
-                KeyOffset key_offset;
-                std::memcpy(&key_offset.key, page_buffer + key_offset_position, sizeof(int64_t));
-                std::memcpy(&key_offset.valueOffset, page_buffer + key_offset_position + sizeof(int64_t), sizeof(int));
-
-                // Debugging the key being checked
-                std::cout << "DEBUG: Checking key=" << key_offset.key << " at mid=" << mid << std::endl;
+            continue;
+        }
 
-                if (key_offset.key == target_key)
-                {
-                    // Extract value using offset
-                    int64_t value;
-                    if (key_offset.valueOffset >= 0 && key_offset.valueOffset + sizeof(int64_t) <= PAGE_SIZE)
-                    {
-                        std::memcpy(&value, page_buffer + key_offset.valueOffset, sizeof(value));
-                        return value;
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Invalid value offset in page.");
-                    }
-                }
-                else if (key_offset.key < target_key)
-                {
-                    low = mid + 1; // Move to the right
-                }
-                else
-                {
-                    high = mid - 1; // Move to the left
-                }
-            }
-            return -1; // Key not found in this page
+        // Compressed blocks are read aside and decompressed into place. Direct
+        // reads land in place only for uncompressed blocks on aligned offsets;
+        // others cover the whole aligned blocks around them, read aside.
+        off_t start = offsets[i];
+        size_t storedSize = reader.getStoredSize(offsets[i]);
+        size_t size = storedSize;
+        bool compressed = storedSize < reader.getBlockSize(offsets[i]);
+        bool inPlace = !compressed && (reader.directFd == -1 || isDirectAligned(target, start, size));
+        if (!inPlace && reader.directFd != -1)
+        {
+            start = alignDown(offsets[i]);
+            size = alignUp(offsets[i] + static_cast<off_t>(storedSize)) - start;
         }
-        else
+        if (!inPlace)
         {
-            left = mid + 1;
+            reads.aside.emplace_back(size);
+            target = reads.aside.back().data();
         }
+        reads.requests.push_back({reader.directFd != -1 ? reader.directFd : reader.fd, target, size, start});
+        reads.skips.push_back(offsets[i] - start);
+        reads.slots.push_back(i);
     }
-
-    return -1; // Key not found
+    return reads;
 }
 
-std::vector<std::pair<int64_t, int64_t>> KVStore::scanSST(int sst_fd, const std::string &sst_filename, int64_t start, int64_t end)
+void KVStore::finishBlockReads(const SSTReader &reader, const BlockReads &reads, char *buffer)
 {
-    // Vector to hold the results
-    std::vector<std::pair<int64_t, int64_t>> results;
-
-    // Read SST metadata to get the number of pages
-    int num_pages;
-    off_t offset = sizeof(int); // Skip numEntries in SST metadata
-    pread(sst_fd, &num_pages, sizeof(num_pages), offset);
-
-    if (num_pages <= 0)
-    {
-        throw std::runtime_error("SST file has no pages.");
-    }
-
-    // Perform binary search at the page level to find the starting page
-    int left = 0, right = num_pages - 1;
-    int starting_page = -1;
-    char page_buffer[PAGE_SIZE];
-
-    while (left <= right)
+    for (size_t j = 0; j < reads.requests.size(); ++j)
     {
-        int mid = left + (right - left) / 2;
-        off_t page_offset = SST_METADATA_SIZE + PAGE_SIZE + (mid * PAGE_SIZE);
-
-        std::string pageID = sst_filename + ":" + std::to_string(page_offset);
-
-        // Check if the page is in the buffer pool
-        BufferPool &bufferPool = BufferPoolManager::getInstance();
-        Page *cachedPage = bufferPool.getPage(pageID);
-        char page_buffer[PAGE_SIZE];
+        const ReadRequest &request = reads.requests[j];
+        off_t offset = request.offset + reads.skips[j];
+        size_t storedSize = reader.getStoredSize(offset);
 
-        if (cachedPage)
+        // Only a direct read's padding past the end of the file may be missing
+        if (request.result < static_cast<ssize_t>(reads.skips[j] + storedSize))
         {
-            std::cout << "Buffer pool accessed" << std::endl;
-            // Load data from the buffer pool
-            std::memcpy(page_buffer, cachedPage->data.data(), PAGE_SIZE);
+            throw std::runtime_error("Failed to read SST file or incomplete page read.");
         }
-        else
-        {
-            ssize_t bytes_read = pread(sst_fd, page_buffer, PAGE_SIZE, page_offset);
-            if (bytes_read == -1 || bytes_read != PAGE_SIZE)
-            {
-                throw std::runtime_error("Failed to read SST file or incomplete page read.");
-            }
-
-            Page page;
-            page.data.assign(page_buffer, page_buffer + PAGE_SIZE); // Populate page data
-            bufferPool.insertPage(pageID, page);                    // Insert into buffer pool
-        }
-
-        // Deserialize the page metadata
-        int page_num_entries;
-        int64_t page_starting_key;
-        std::memcpy(&page_num_entries, page_buffer, sizeof(int));
-        std::memcpy(&page_starting_key, page_buffer + sizeof(int), sizeof(int64_t));
-
-        // Check if this page overlaps with the range [start, end]
-        if (end < page_starting_key)
+        char *block = buffer + reads.slots[j] * reader.blockSize;
+        const char *stored = request.buffer + reads.skips[j];
+        size_t size = reader.getBlockSize(offset);
+        if (storedSize < size)
         {
-            // The range ends before this page, so move left.
-            right = mid - 1;
+            decompressBlock(stored, storedSize, block, size);
         }
-        else
+        else if (stored != block)
         {
-            // This page is a potential match or overlaps with the range.
-            starting_page = mid;
-            left = mid + 1;
+            std::memcpy(block, stored, size);
         }
+
+        Page page;
+        page.data.assign(block, block + size);
+        std::string pageID = reader.cacheKey + ":" + std::to_string(offset);
+        BufferPoolManager::getShard(pageID).insertPage(pageID, page);
     }
+}
 
-    // If no starting page is found, return an empty result
-    if (starting_page == -1)
+const char *KVStore::readFilter(const SSTReader &reader, std::vector<char> &buffer)
+{
+    if (const char *bits = reader.getMappedRange(reader.filterOffset, reader.filterSize))
+    {
+        return bits;
+    }
+    buffer.resize(reader.filterSize);
+    if (pread(reader.fd, buffer.data(), buffer.size(), reader.filterOffset) != (ssize_t)buffer.size())
     {
-        return results;
+        throw std::runtime_error("Failed to read bitVector.");
     }
+    return buffer.data();
+}
 
-    // Sequentially scan from the starting page onward
-    for (int page = starting_page; page < num_pages; ++page)
+int64_t KVStore::binarySearchSST(const SSTReader &reader, int64_t target_key)
+{
+    // Binary search the in-memory fence pointers for the only candidate page
+    int page = reader.findPage(target_key);
+    if (page == -1)
     {
-        off_t page_offset = SST_METADATA_SIZE + PAGE_SIZE + (page * PAGE_SIZE);
+        return -1; // Key is outside the key range of this SST
+    }
 
-        std::string pageID = sst_filename + ":" + std::to_string(page_offset);
+    // Search a mapped page in place
+    if (const char *block = reader.getMappedBlock(reader.getPageOffset(page)))
+    {
+        return searchInPage(block, target_key);
+    }
 
-        // Check if the page is in the buffer pool
-        BufferPool &bufferPool = BufferPoolManager::getInstance();
-        Page *cachedPage = bufferPool.getPage(pageID);
-        char page_buffer[PAGE_SIZE];
+    // Read exactly one data page and search it
+    AlignedBuffer page_buffer(reader.blockSize);
+    readPage(reader, reader.getPageOffset(page), page_buffer.data());
 
-        if (cachedPage)
-        {
-            std::cout << "Buffer pool accessed" << std::endl;
-            // Load data from the buffer pool
-            std::memcpy(page_buffer, cachedPage->data.data(), PAGE_SIZE);
-        }
-        else
-        {
-            ssize_t bytes_read = pread(sst_fd, page_buffer, PAGE_SIZE, page_offset);
-            if (bytes_read == -1 || bytes_read != PAGE_SIZE)
-            {
-                throw std::runtime_error("Failed to read SST file or incomplete page read.");
-            }
+    return searchInPage(page_buffer.data(), target_key);
+}
 
-            Page page;
-            page.data.assign(page_buffer, page_buffer + PAGE_SIZE); // Populate page data
-            bufferPool.insertPage(pageID, page);                    // Insert into buffer pool
-        }
+std::vector<std::pair<int64_t, int64_t>> KVStore::scanSST(const SSTReader &reader, int64_t start, int64_t end)
+{
+    // Vector to hold the results
+    std::vector<std::pair<int64_t, int64_t>> results;
 
-        // Deserialize the page metadata
-        int page_num_entries;
-        int64_t page_starting_key, page_free_space;
-        std::memcpy(&page_num_entries, page_buffer, sizeof(int));
-        std::memcpy(&page_starting_key, page_buffer + sizeof(int), sizeof(int64_t));
-        std::memcpy(&page_free_space, page_buffer + sizeof(int) + sizeof(int64_t), sizeof(int));
+    if (end < reader.startingKey || start > reader.endingKey)
+    {
+        return results; // The range does not overlap this SST
+    }
 
+    // Use the fence pointers to find the first page that may hold the range
+    int starting_page = std::max(reader.findPage(start), 0);
+
+    // Sequentially scan from the starting page onward
+    AlignedBuffer page_buffer(reader.blockSize);
+    for (int page = starting_page; page < reader.numPages; ++page)
+    {
         // If the page starts beyond the end of the range, stop scanning
-        if (page_starting_key > end)
+        if (reader.fencePointers[page] > end)
         {
             break;
         }
 
-        // Iterate through the keys in the page and collect results in range [start, end]
-        size_t offset_in_page = sizeof(int) + sizeof(int64_t) + sizeof(int); // Skip metadata
-        for (int i = 0; i <= page_num_entries; ++i)
-        {
-            KeyOffset key_offset;
-            std::memcpy(&key_offset.key, page_buffer + offset_in_page, sizeof(int64_t));
-            std::memcpy(&key_offset.valueOffset, page_buffer + offset_in_page + sizeof(int64_t), sizeof(int));
-
-            if (key_offset.key >= start && key_offset.key <= end)
-            {
-                int64_t value;
-                std::memcpy(&value, page_buffer + key_offset.valueOffset, sizeof(value));
-                results.emplace_back(key_offset.key, value);
-            }
-            else if (key_offset.key > end)
-            {
-                // Stop scanning further keys as they exceed the range
-                return results;
-            }
-
-            offset_in_page += sizeof(int64_t) + sizeof(int); // Move to next key-offset
-        }
+        readPage(reader, reader.getPageOffset(page), page_buffer.data());
+        scanPage(page_buffer.data(), start, end, results);
     }
 
     return results;
 }
 
-int64_t KVStore::btreeSearchSST(int sst_fd, int64_t target_key, const std::string &sst_filename)
+int64_t KVStore::btreeSearchSST(const SSTReader &reader, int64_t target_key)
 {
-    BufferPool &bufferPool = BufferPoolManager::getInstance();
-    // Step 1: Read SST-level metadata to get the number of pages
-    int numPages = 0;
-    off_t offset = sizeof(int); // Skip `numEntries` (4 bytes) in SST metadata
-    pread(sst_fd, &numPages, sizeof(numPages), offset);
-
-    if (numPages <= 0)
-    {
-        throw std::runtime_error("SST file has no pages.");
-    }
-
-    // Calculate the range for pages in the SST file
-    off_t pageStartOffset = SST_METADATA_SIZE + PAGE_SIZE;
-    off_t pageEndOffset = pageStartOffset + (numPages * PAGE_SIZE);
+    // Step 1: Calculate the range for pages in the SST file
+    off_t pageStartOffset = reader.getPageOffset(0);
+    off_t pageEndOffset = reader.getDataEndOffset();
 
     /////////////////////////////////////////////////////////////////////////////////////////////////////////
-    // Step 2: Seek to the last 4KB of the file to load the root node
+    // Step 2: Load the root node located by the SST footer
     /////////////////////////////////////////////////////////////////////////////////////////////////////////
-    off_t rootOffset = lseek(sst_fd, -PAGE_SIZE, SEEK_END);
-    if (rootOffset == -1)
-    {
-        throw std::runtime_error("Failed to seek to the last 4KB of the file");
-    }
-    std::string pageID = sst_filename + ":" + std::to_string(rootOffset);
-
-    Page *cachedPage = bufferPool.getPage(pageID);
     char buffer[PAGE_SIZE];
-    if (cachedPage)
-    {
-        std::cout << "Buffer pool accessed" << std::endl;
-        // Load data from the buffer pool
-        std::memcpy(buffer, cachedPage->data.data(), PAGE_SIZE);
-    }
-    else
-    {
-        // Read the root page from the SST file and insert it into the buffer pool
-        ssize_t bytesRead = read(sst_fd, buffer, PAGE_SIZE);
-        if (bytesRead == -1)
-        {
-            throw std::runtime_error("Failed to read the last 4KB of the file");
-        }
-
-        Page rootPage;
-        rootPage.data.assign(buffer, buffer + PAGE_SIZE); // Populate page data
-        bufferPool.insertPage(pageID, rootPage);          // Insert into buffer pool
-    }
+    readPage(reader, reader.rootOffset, buffer);
 
     /////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Step 3: Parse the buffer to search the root node
@@ -692,81 +1179,51 @@ int64_t KVStore::btreeSearchSST(int sst_fd, int64_t target_key, const std::strin
         // Read the offset (next 8 bytes)
         std::memcpy(&currentOffset, buffer + metadataOffset, sizeof(currentOffset));
         metadataOffset += sizeof(currentOffset);
-        std::cout << "Current Offset: " << currentOffset << std::endl;
 
         // Read the key (next 8 bytes)
         std::memcpy(&currentKey, buffer + metadataOffset, sizeof(currentKey));
         metadataOffset += sizeof(currentKey);
-        std::cout << "Current Key: " << currentKey << std::endl;
 
-        std::cout << "Target Key: " << target_key << std::endl;
         // Compare with the target key
         if (target_key <= currentKey)
         {
             // If target_key is smaller or equal to the current key, follow the current offset
-            std::cout << "Found offset, trying to follow" << std::endl;
-            return followOffset(sst_fd, currentOffset, target_key, sst_filename, pageStartOffset, pageEndOffset);
+            return followOffset(reader, currentOffset, target_key, pageStartOffset, pageEndOffset);
         }
     }
 
     // If the key is greater than all keys in the current node, follow the last offset if available
     if (keyCount < offCount)
     {
-        std::cout << "Should not be here" << std::endl;
         // Read the last offset
         std::memcpy(&currentOffset, buffer + metadataOffset, sizeof(currentOffset));
         metadataOffset += sizeof(currentOffset);
-        return followOffset(sst_fd, currentOffset, target_key, sst_filename, pageStartOffset, pageEndOffset);
+        return followOffset(reader, currentOffset, target_key, pageStartOffset, pageEndOffset);
     }
 
     // If the key was not found, return -1 to indicate not found
     return -1;
 }
 
-int64_t KVStore::followOffset(int sst_fd, int64_t offset, int64_t target_key, const std::string &sst_filename, off_t pageStartOffset, off_t pageEndOffset)
+int64_t KVStore::followOffset(const SSTReader &reader, int64_t offset, int64_t target_key, off_t pageStartOffset, off_t pageEndOffset)
 {
-    std::cout << "pageStartOffset: " << pageStartOffset << std::endl;
-    std::cout << "pageEndOffset: " << pageEndOffset << std::endl;
-    std::string pageID = sst_filename + ":" + std::to_string(offset);
-
-    // Check if the page is in the buffer pool
-    BufferPool &bufferPool = BufferPoolManager::getInstance();
-    Page *cachedPage = bufferPool.getPage(pageID);
-    char buffer[PAGE_SIZE];
-
-    if (cachedPage)
-    {
-        std::cout << "Buffer pool accessed" << std::endl;
-        // Load data from the buffer pool
-        std::memcpy(buffer, cachedPage->data.data(), PAGE_SIZE);
-    }
-    else
-    {
-        // Read the page/node and insert it into the buffer pool
-        ssize_t bytesRead = pread(sst_fd, buffer, PAGE_SIZE, offset);
-        if (bytesRead == -1)
-        {
-            throw std::runtime_error("Failed to read the SST page or B-tree node");
-        }
-
-        Page page;
-        page.data.assign(buffer, buffer + PAGE_SIZE); // Populate page data
-        bufferPool.insertPage(pageID, page);          // Insert into buffer pool
-    }
+    // Read the page/node through the buffer pool
+    AlignedBuffer buffer(reader.blockSize);
+    readPage(reader, offset, buffer.data());
 
     if (offset >= pageStartOffset && offset < pageEndOffset)
     {
         // The offset points to an SST page; search in the page
-        return searchInPage(buffer, target_key);
+        return searchInPage(buffer.data(), target_key);
     }
     else
     {
         // The offset points to another B-tree node; search in the node
-        return searchInNode(buffer, target_key, sst_fd, sst_filename, pageStartOffset, pageEndOffset);
+        return searchInNode(buffer.data(), target_key, reader, pageStartOffset, pageEndOffset);
     }
 }
 
-int64_t KVStore::searchInNode(char *nodeBuffer, int64_t target_key, int sst_fd, const std::string &sst_filename, off_t pageStartOffset, off_t pageEndOffset)
+int64_t KVStore::searchInNode(char *nodeBuffer, int64_t target_key, const SSTReader &reader, off_t pageStartOffset, off_t pageEndOffset)
 {
     int32_t keyCount = 0;
     int32_t offCount = 0;
@@ -807,7 +1264,7 @@ int64_t KVStore::searchInNode(char *nodeBuffer, int64_t target_key, int sst_fd,
         // Compare with the target key
         if (target_key <= currentKey)
         {
-            return followOffset(sst_fd, currentOffset, target_key, sst_filename, pageStartOffset, pageEndOffset);
+            return followOffset(reader, currentOffset, target_key, pageStartOffset, pageEndOffset);
         }
     }
 
@@ -816,7 +1273,7 @@ int64_t KVStore::searchInNode(char *nodeBuffer, int64_t target_key, int sst_fd,
     {
         std::memcpy(&currentOffset, nodeBuffer + metadataOffset, sizeof(currentOffset));
         metadataOffset += sizeof(currentOffset);
-        return followOffset(sst_fd, currentOffset, target_key, sst_filename, pageStartOffset, pageEndOffset);
+        return followOffset(reader, currentOffset, target_key, pageStartOffset, pageEndOffset);
     }
 
     // Key not found
@@ -826,114 +1283,51 @@ int64_t KVStore::searchInNode(char *nodeBuffer, int64_t target_key, int sst_fd,
 int64_t KVStore::searchInPage(const char *pageBuffer, int64_t target_key)
 {
     // Step 1: Process metadata to get the number of entries in the page
-    size_t offset_in_page = sizeof(int) + sizeof(int64_t) + sizeof(int); // Skip metadata (numEntries, startingKey, freeSpace)
-    int page_num_entries = 0;
-    std::memcpy(&page_num_entries, pageBuffer, sizeof(page_num_entries));
+    int page_num_entries = Page::readNumEntries(pageBuffer);
 
     if (page_num_entries <= 0)
     {
         throw std::runtime_error("Invalid number of entries in the page.");
     }
 
-    // Step 2: Perform binary search on the key-offset pairs
-    int low = 0, high = page_num_entries - 1; // Set the bounds for binary search
-
-    while (low <= high)
+    // Step 2: Search the page in whichever format it was written
+    int64_t value;
+    if (Page::search(pageBuffer, target_key, value))
     {
-        int mid = low + (high - low) / 2;
-        size_t key_offset_position = offset_in_page + mid * (sizeof(int64_t) + sizeof(int));
-
-        // Read the key and value offset at the `mid` position
-        KeyOffset key_offset;
-        std::memcpy(&key_offset.key, pageBuffer + key_offset_position, sizeof(int64_t));
-        std::memcpy(&key_offset.valueOffset, pageBuffer + key_offset_position + sizeof(int64_t), sizeof(int));
-
-        // Debugging the key being checked
-        std::cout << "DEBUG: Checking key=" << key_offset.key << " at mid=" << mid << std::endl;
-
-        if (key_offset.key == target_key)
-        {
-            // Extract the value using the offset
-            int64_t value;
-            if (key_offset.valueOffset >= 0 && key_offset.valueOffset + sizeof(int64_t) <= PAGE_SIZE)
-            {
-                std::memcpy(&value, pageBuffer + key_offset.valueOffset, sizeof(value));
-                return value; // Found the key and return the value associated with it
-            }
-            else
-            {
-                throw std::runtime_error("Invalid value offset in page.");
-            }
-        }
-        else if (key_offset.key < target_key)
-        {
-            low = mid + 1; // Move to the right
-        }
-        else
-        {
-            high = mid - 1; // Move to the left
-        }
+        return value; // Found the key and return the value associated with it
     }
 
     // Step 3: If the key is not found, return -1
     return -1; // Key not found in this page
 }
 
-std::vector<std::pair<int64_t, int64_t>> KVStore::scanBtree(int sst_fd, const std::string &sst_filename, int64_t start, int64_t end)
+std::vector<std::pair<int64_t, int64_t>> KVStore::scanBtree(const SSTReader &reader, int64_t start, int64_t end)
 {
     std::vector<std::pair<int64_t, int64_t>> result;
 
-    // Step 1: Read SST metadata to get the number of pages
-    int numPages = 0;
-    off_t offset = sizeof(int); // Skip `numEntries` in SST metadata
-    pread(sst_fd, &numPages, sizeof(numPages), offset);
-
-    if (numPages <= 0)
+    if (end < reader.startingKey || start > reader.endingKey)
     {
-        throw std::runtime_error("SST file has no pages.");
+        return result; // The range does not overlap this SST
     }
 
-    // Calculate the range for pages in the SST file
-    off_t pageStartOffset = SST_METADATA_SIZE + PAGE_SIZE;
-    off_t pageEndOffset = pageStartOffset + (numPages * PAGE_SIZE);
-
-    // Step 2: Seek to the last 4KB of the file to load the root node
-    off_t rootOffset = lseek(sst_fd, -PAGE_SIZE, SEEK_END);
-    if (rootOffset == -1)
-    {
-        throw std::runtime_error("Failed to seek to the last 4KB of the file");
-    }
+    // Step 1: Calculate the range for pages in the SST file
+    off_t pageStartOffset = reader.getPageOffset(0);
+    off_t pageEndOffset = reader.getDataEndOffset();
 
-    // Step 3: Start scanning from the root node
-    scanNode(sst_fd, sst_filename, rootOffset, start, end, pageStartOffset, pageEndOffset, result);
+    // Step 2: Start scanning from the root node located by the SST footer. The
+    // pages under consecutive nodes are consecutive, so long scans prefetch ahead.
+    // Direct reads bypass the page cache, so they get no read-ahead.
+    ReadAhead readAhead(reader.fd, pageEndOffset, reader.directFd == -1 ? SCAN_READAHEAD_SIZE : 0, reader.mapping);
+    scanNode(reader, reader.rootOffset, start, end, pageStartOffset, pageEndOffset, result, readAhead);
 
     return result;
 }
 
-void KVStore::scanNode(int sst_fd, const std::string &sst_filename, off_t offset, int64_t start, int64_t end, off_t pageStartOffset, off_t pageEndOffset, std::vector<std::pair<int64_t, int64_t>> &result)
+void KVStore::scanNode(const SSTReader &reader, off_t offset, int64_t start, int64_t end, off_t pageStartOffset, off_t pageEndOffset, std::vector<std::pair<int64_t, int64_t>> &result, ReadAhead &readAhead)
 {
-    BufferPool &bufferPool = BufferPoolManager::getInstance();
-    std::string pageID = sst_filename + ":" + std::to_string(offset);
-    Page *cachedPage = bufferPool.getPage(pageID);
+    // Read the node through the buffer pool
     char buffer[PAGE_SIZE];
-    if (cachedPage)
-    {
-        std::cout << "Buffer pool accessed" << std::endl;
-        // Load data from the buffer pool
-        std::memcpy(buffer, cachedPage->data.data(), PAGE_SIZE);
-    }
-    else
-    {
-        ssize_t bytesRead = pread(sst_fd, buffer, PAGE_SIZE, offset);
-        if (bytesRead == -1)
-        {
-            throw std::runtime_error("Failed to read the node from SST");
-        }
-
-        Page page;
-        page.data.assign(buffer, buffer + PAGE_SIZE); // Populate page data
-        bufferPool.insertPage(pageID, page);          // Insert into buffer pool
-    }
+    readPage(reader, offset, buffer);
 
     // Step 1: Read metadata to get the number of keys in the node
     size_t metadataOffset = 0;
@@ -959,8 +1353,10 @@ void KVStore::scanNode(int sst_fd, const std::string &sst_filename, off_t offset
     int64_t currentOffset = 0;
     int64_t currentKey = 0;
 
-    // Step 2: Iterate over keys and offsets to perform the range scan
-    for (int i = 0; i < keyCount; ++i)
+    // Step 2: Collect the children whose keys reach into the range
+    std::vector<off_t> children;
+    bool pastEnd = false;
+    for (int i = 0; i < keyCount && !pastEnd; ++i)
     {
         // Read the offset
         std::memcpy(&currentOffset, buffer + metadataOffset, sizeof(currentOffset));
@@ -970,136 +1366,73 @@ void KVStore::scanNode(int sst_fd, const std::string &sst_filename, off_t offset
         std::memcpy(&currentKey, buffer + metadataOffset, sizeof(currentKey));
         metadataOffset += sizeof(currentKey);
 
-        // If currentKey is within the range, collect results from the subtree/page
         if (currentKey >= start)
         {
-            // Follow the current offset if necessary
-            if (currentOffset >= pageStartOffset && currentOffset < pageEndOffset)
-            {
-                std::string pageID = sst_filename + ":" + std::to_string(currentOffset);
-                Page *cachedPage = bufferPool.getPage(pageID);
-                char pageBuffer[PAGE_SIZE];
-                if (cachedPage)
-                {
-                    std::cout << "Buffer pool accessed" << std::endl;
-                    // Load data from the buffer pool
-                    std::memcpy(pageBuffer, cachedPage->data.data(), PAGE_SIZE);
-                }
-                else
-                {
-                    // If the offset points to a page, load and scan the page
-                    ssize_t bytesRead = pread(sst_fd, pageBuffer, PAGE_SIZE, currentOffset);
-                    if (bytesRead == -1)
-                    {
-                        throw std::runtime_error("Failed to read the SST page");
-                    }
-
-                    Page page;
-                    page.data.assign(pageBuffer, pageBuffer + PAGE_SIZE); // Populate page data
-                    bufferPool.insertPage(pageID, page);                  // Insert into buffer pool
-                }
-                // Scan the page to collect key-value pairs within the range
-                scanPage(pageBuffer, start, end, result);
-            }
-            else
-            {
-                // If the offset points to another B-tree node, recursively scan the node
-                scanNode(sst_fd, sst_filename, currentOffset, start, end, pageStartOffset, pageEndOffset, result);
-            }
+            children.push_back(currentOffset);
         }
 
         // If the key exceeds the end range, we can stop scanning further
-        if (currentKey > end)
-        {
-            return;
-        }
+        pastEnd = currentKey > end;
     }
 
     // Step 3: Follow the last offset if necessary and it's within the range
-    if (keyCount < offCount)
+    if (!pastEnd && keyCount < offCount)
     {
         std::memcpy(&currentOffset, buffer + metadataOffset, sizeof(currentOffset));
-        if (currentOffset >= pageStartOffset && currentOffset < pageEndOffset)
+        children.push_back(currentOffset);
+    }
+
+    // Step 4: Read the child pages together, then scan the children in key order
+    // Mapped pages are scanned in place
+    std::vector<off_t> pageOffsets;
+    off_t first = -1, last = -1;
+    for (off_t child : children)
+    {
+        if (child >= pageStartOffset && child < pageEndOffset)
         {
-            std::string pageID = sst_filename + ":" + std::to_string(currentOffset);
-            Page *cachedPage = bufferPool.getPage(pageID);
-            char pageBuffer[PAGE_SIZE];
-            if (cachedPage)
-            {
-                std::cout << "Buffer pool accessed" << std::endl;
-                // Load data from the buffer pool
-                std::memcpy(pageBuffer, cachedPage->data.data(), PAGE_SIZE);
-            }
-            else
+            first = first == -1 ? child : first;
+            last = child;
+            if (!reader.getMappedBlock(child))
             {
-                // If the offset points to a page, load and scan the page
-                ssize_t bytesRead = pread(sst_fd, pageBuffer, PAGE_SIZE, currentOffset);
-                if (bytesRead == -1)
-                {
-                    throw std::runtime_error("Failed to read the SST page");
-                }
-
-                Page page;
-                page.data.assign(pageBuffer, pageBuffer + PAGE_SIZE); // Populate page data
-                bufferPool.insertPage(pageID, page);                  // Insert into buffer pool
+                pageOffsets.push_back(child);
             }
+        }
+    }
+    if (first != -1)
+    {
+        readAhead.onRead(first, last + reader.getStoredSize(last) - first);
+    }
+    AlignedBuffer pages(pageOffsets.size() * reader.blockSize);
+    readBlocks(reader, pageOffsets, pages.data());
 
-            // Scan the page to collect key-value pairs within the range
-            scanPage(pageBuffer, start, end, result);
+    size_t nextPage = 0;
+    for (off_t child : children)
+    {
+        if (child >= pageStartOffset && child < pageEndOffset)
+        {
+            const char *block = reader.getMappedBlock(child);
+            scanPage(block ? block : pages.data() + nextPage++ * reader.blockSize, start, end, result);
         }
         else
         {
-            // Recursively scan the next B-tree node if it exists
-            scanNode(sst_fd, sst_filename, currentOffset, start, end, pageStartOffset, pageEndOffset, result);
+            // If the offset points to another B-tree node, recursively scan the node
+            scanNode(reader, child, start, end, pageStartOffset, pageEndOffset, result, readAhead);
         }
     }
 }
 
 void KVStore::scanPage(const char *pageBuffer, int64_t start, int64_t end, std::vector<std::pair<int64_t, int64_t>> &result)
 {
-    // Process keys in this page
-    size_t offset_in_page = sizeof(int) + sizeof(int64_t) + sizeof(int); // Skip metadata
-
     // Read the number of entries in the page
-    int page_num_entries = 0;
-    std::memcpy(&page_num_entries, pageBuffer, sizeof(page_num_entries));
+    int page_num_entries = Page::readNumEntries(pageBuffer);
 
     if (page_num_entries <= 0)
     {
         throw std::runtime_error("Invalid number of entries in the page.");
     }
 
-    // Perform a range scan within the key-offset vector
-    for (int i = 0; i < page_num_entries; ++i)
-    {
-        size_t key_offset_position = offset_in_page + i * (sizeof(int64_t) + sizeof(int));
-
-        // Read the key and value offset at the current position
-        KeyOffset key_offset;
-        std::memcpy(&key_offset.key, pageBuffer + key_offset_position, sizeof(int64_t));
-        std::memcpy(&key_offset.valueOffset, pageBuffer + key_offset_position + sizeof(int64_t), sizeof(int));
-
-        if (key_offset.key >= start && key_offset.key <= end)
-        {
-            // Extract value using offset
-            int64_t value;
-            if (key_offset.valueOffset >= 0 && key_offset.valueOffset + sizeof(int64_t) <= PAGE_SIZE)
-            {
-                std::memcpy(&value, pageBuffer + key_offset.valueOffset, sizeof(value));
-                result.emplace_back(key_offset.key, value);
-            }
-            else
-            {
-                throw std::runtime_error("Invalid value offset in page.");
-            }
-        }
-
-        // If the current key exceeds the end of the range, stop scanning
-        if (key_offset.key > end)
-        {
-            return;
-        }
-    }
+    // Collect the key-value pairs in range from either page format
+    Page::scan(pageBuffer, start, end, result);
 }
 
 std::vector<std::pair<int64_t, int64_t>> KVStore::mergedScan(int64_t start, int64_t end)
@@ -1108,65 +1441,27 @@ std::vector<std::pair<int64_t, int64_t>> KVStore::mergedScan(int64_t start, int6
     std::unordered_set<int64_t> seen_keys; // To track keys already processed
 
     // 1. Scan the memtable first
-    auto memtable_results = memtable.scan(start, end);
-    for (const auto &kv : memtable_results)
-    {
-        if (kv.second == TOMBSTONE)
-        {
-            // Mark the key as seen but do not include it in results
-            seen_keys.insert(kv.first);
-            continue;
-        }
-
-        // Include the key-value pair in the results
-        final_results.emplace_back(kv.first, kv.second);
-        seen_keys.insert(kv.first);
-    }
-
-    // 2. Iterate through levels from youngest (0) to oldest
-    size_t numLevels = lsmTree->getNumLevels();
+    std::shared_ptr<AVLTree> mem = memtable.load(); // Before the version, as in Get
+    addScanResults(mem->scan(start, end), seen_keys, final_results);
 
-    for (size_t level = 0; level < numLevels; ++level)
+    // 2. Iterate through levels from youngest (0) to oldest, all of one
+    // version, so a background compaction cannot move keys past the scan
+    std::shared_ptr<const Version> version = lsmTree->getCurrentVersion();
+    for (size_t level = 0; level < version->getNumLevels(); ++level)
     {
-        std::vector<std::string> sstFiles = lsmTree->getSSTFilesByLevel(level);
+        // SSTs overlapping the range, newest first so newer versions are seen first
+        Version::Level sstFiles = version->getFilesForRange(level, start, end);
 
         // Iterate through each SST file in the current level
-        for (const auto &sst_filename : sstFiles)
+        for (const auto &file : sstFiles)
         {
             try
             {
-                // Open the SST file
-                int sst_fd = open(sst_filename.c_str(), O_RDONLY);
-                if (sst_fd == -1)
-                {
-                    std::cerr << "ERROR: Failed to open SST file: " << sst_filename << std::endl;
-                    continue; // Skip this SST file
-                }
+                // The open handle of the SST file
+                const std::shared_ptr<SSTReader> &reader = file->reader;
 
                 // Use the existing scanBtree function to get key-value pairs in range
-                std::vector<std::pair<int64_t, int64_t>> sst_results = scanBtree(sst_fd, sst_filename, start, end);
-                close(sst_fd); // Close the file descriptor after scanning
-
-                // Iterate through the scan results
-                for (const auto &kv : sst_results)
-                {
-                    // If key has already been processed, skip it
-                    if (seen_keys.find(kv.first) != seen_keys.end())
-                    {
-                        continue;
-                    }
-
-                    if (kv.second == TOMBSTONE)
-                    {
-                        // Mark the key as seen but do not include it in results
-                        seen_keys.insert(kv.first);
-                        continue;
-                    }
-
-                    // Include the key-value pair in the results
-                    final_results.emplace_back(kv.first, kv.second);
-                    seen_keys.insert(kv.first);
-                }
+                addScanResults(scanBtree(*reader, start, end), seen_keys, final_results);
             }
             catch (const std::exception &e)
             {
@@ -1181,4 +1476,22 @@ std::vector<std::pair<int64_t, int64_t>> KVStore::mergedScan(int64_t start, int6
               { return a.first < b.first; });
 
     return final_results;
-}
\ No newline at end of file
+}
+void KVStore::addScanResults(const std::vector<std::pair<int64_t, int64_t>> &entries, std::unordered_set<int64_t> &seen_keys,
+                             std::vector<std::pair<int64_t, int64_t>> &results)
+{
+    for (const auto &kv : entries)
+    {
+        // If key has already been processed, skip it
+        if (!seen_keys.insert(kv.first).second)
+        {
+            continue;
+        }
+
+        // Deleted keys stay marked as seen but are not included in the results
+        if (kv.second != TOMBSTONE)
+        {
+            results.emplace_back(kv.first, kv.second);
+        }
+    }
+}
@@ -5,35 +5,153 @@
 #include <string>
 #include <deque>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <unordered_set>
 #include "memtable/memtable.h"
 #include "lsmtree/lsmtree.h"
+#include "sst/ioqueue.h"
+#include "sst/readahead.h"
+#include "executor.h"
+#include "task.h"
 
+// Counters of a database since it was opened
+struct KVStoreStats
+{
+    int64_t userBytesWritten = 0; // Keys and values passed to Put and Del
+    int64_t writes = 0;           // Puts and deletes, alone or in batches
+    int64_t writeGroups = 0;      // Groups the writer queue applied them in
+    int64_t flushes = 0;
+    int64_t flushBytesWritten = 0;
+    int64_t flushMicros = 0;
+
+    std::vector<LevelCompactionStats> compactions; // Indexed by output level
+    std::vector<size_t> levelFiles;
+    std::vector<int64_t> levelBytes;
+
+    // SST bytes written by flushes and compactions per user byte written
+    double writeAmplification = 0;
+
+    // Bytes of all SSTs per byte of the last level, which holds most of the live data
+    double spaceAmplification = 0;
+
+    RateLimiterStats flushIO;      // High priority
+    RateLimiterStats compactionIO; // Low priority
+    WriteStallStats writeStalls;
+};
+
+// WriteBatch collects puts and deletes that KVStore::Write applies together:
+// they land in one memtable, become visible to readers at once and are
+// flushed into the same SST. Later entries for a key replace earlier ones.
+class WriteBatch
+{
+public:
+    void Put(int64_t key, int64_t value);
+    void Del(int64_t key);
+    void Clear();
+    size_t Count() const;
+
+private:
+    friend class KVStore;
+    std::vector<std::pair<int64_t, int64_t>> entries; // Keys and values in the order they were added
+};
+
+// Any number of threads may call Get, Scan, Put, Del and CompactRange at
+// once. Reads take no lock: they load the current memtable and then the
+// current Version of the tree with atomic loads, and both stay valid for as
+// long as the read holds them. Writes are serialized through a queue: the
+// writer at its head applies every write queued behind it as one group,
+// flushing the memtable as it fills, and then wakes the writers it served.
+// A flush publishes the new SST before the empty memtable replacing the full
+// one, so a read never misses a key between the two. Open, Close and the
+// Set* methods must not run concurrently with other calls.
 class KVStore
 {
 private:
-    AVLTree memtable; // In-memory AVL Tree for fast access
+    // In-memory AVL Tree for fast access. Loaded by readers without a lock;
+    // only the writer at the head of the queue changes it or replaces it.
+    std::atomic<std::shared_ptr<AVLTree>> memtable;
     std::unique_ptr<LSMTree> lsmTree;
     std::string db_name; // Database name (used for file storage path)
     int memtable_size;   // Size threshold for the memtable
-    int sst_counter;     // Counter for SST files
 
     // Helper function to flush memtable to SST
     void flushMemtableToSST();
 
-    // Helper function to read SST files and perform binary search
-    int64_t binarySearchSST(int sst_fd, const std::string &sst_filename, int64_t target_key);
+    // A write waiting in the writer queue
+    struct Writer
+    {
+        const std::pair<int64_t, int64_t> *entries = nullptr; // Keys and values, applied in order
+        size_t count = 0;
+        bool flush = false; // Flush the memtable once the group is applied
+        bool done = false;
+        std::exception_ptr error{};
+        std::condition_variable signal{};
+    };
+    std::mutex writeMutex; // Guards the queue only; groups are applied without it
+    std::deque<Writer *> writers;
+
+    // Queues a write and returns once a group holding it is applied
+    void write(const std::pair<int64_t, int64_t> *entries, size_t count, bool flush = false);
+    void applyWriteGroup(const std::vector<Writer *> &group);
+
+    // Helper function to read a page or B-tree node through the buffer pool
+    void readPage(const SSTReader &reader, off_t offset, char *buffer);
+
+    // Helper function to read data pages at the given offsets into consecutive
+    // blockSize slots of a buffer; pages missing from the buffer pool are read
+    // together through the I/O queue of the thread
+    void readBlocks(const SSTReader &reader, const std::vector<off_t> &offsets, char *buffer);
+
+    // The reads of a readBlocks call for the blocks missing from the buffer pool
+    struct BlockReads
+    {
+        std::vector<size_t> slots; // Slot of the buffer each request fills
+        std::vector<ReadRequest> requests;
+        std::vector<size_t> skips;        // Bytes in front of each block in its request
+        std::vector<AlignedBuffer> aside; // Compressed or unaligned direct reads awaiting a copy into their slots
+    };
+
+    // Copies the cached blocks into their slots and prepares the reads of the rest
+    BlockReads startBlockReads(const SSTReader &reader, const std::vector<off_t> &offsets, char *buffer);
+
+    // Decompresses the completed reads into their slots and caches the blocks
+    void finishBlockReads(const SSTReader &reader, const BlockReads &reads, char *buffer);
+
+    // Coroutine form of readBlocks, reading through an executor
+    Task<size_t> readBlocksAsync(const SSTReader &reader, std::vector<off_t> offsets, char *buffer, Executor &executor);
+
+    // Adds the entries of one source to the results of a scan, skipping keys
+    // a newer source already holds and hiding deleted keys
+    void addScanResults(const std::vector<std::pair<int64_t, int64_t>> &entries, std::unordered_set<int64_t> &seen_keys,
+                        std::vector<std::pair<int64_t, int64_t>> &results);
+
+    // Helper function to get the Bloom filter bits of an SST, in place if it is
+    // mapped and otherwise read into the buffer
+    const char *readFilter(const SSTReader &reader, std::vector<char> &buffer);
+
+    // Helper function to search SST files using the in-memory fence pointers
+    int64_t binarySearchSST(const SSTReader &reader, int64_t target_key);
+
+    // Helper function to look up the sorted keys in [first, last) of a
+    // MultiGet in one SST; resolved keys are marked and get their values
+    void multiGetSST(const SSTReader &reader, const std::vector<int64_t> &keys, size_t first, size_t last,
+                     std::vector<int64_t> &values, std::vector<bool> &resolved);
 
     // Helper function to read SST files and perform btree search
-    int64_t btreeSearchSST(int sst_fd, int64_t target_key, const std::string &sst_filename);
+    int64_t btreeSearchSST(const SSTReader &reader, int64_t target_key);
     int64_t searchInPage(const char *pageBuffer, int64_t target_key);
-    int64_t searchInNode(char *nodeBuffer, int64_t target_key, int sst_fd, const std::string &sst_filename, off_t pageStartOffset, off_t pageEndOffset);
-    int64_t followOffset(int sst_fd, int64_t offset, int64_t target_key, const std::string &sst_filename, off_t pageStartOffset, off_t pageEndOffset);
+    int64_t searchInNode(char *nodeBuffer, int64_t target_key, const SSTReader &reader, off_t pageStartOffset, off_t pageEndOffset);
+    int64_t followOffset(const SSTReader &reader, int64_t offset, int64_t target_key, off_t pageStartOffset, off_t pageEndOffset);
 
     // Helper function to scan SST files and return key-value pairs in a range
-    std::vector<std::pair<int64_t, int64_t>> scanSST(int sst_fd, const std::string &sst_filename, int64_t start, int64_t end);
+    std::vector<std::pair<int64_t, int64_t>> scanSST(const SSTReader &reader, int64_t start, int64_t end);
 
-    std::vector<std::pair<int64_t, int64_t>> scanBtree(int sst_fd, const std::string &sst_filename, int64_t start, int64_t end);
-    void scanNode(int sst_fd, const std::string &sst_filename, off_t offset, int64_t start, int64_t end, off_t pageStartOffset, off_t pageEndOffset, std::vector<std::pair<int64_t, int64_t>> &result);
+    std::vector<std::pair<int64_t, int64_t>> scanBtree(const SSTReader &reader, int64_t start, int64_t end);
+    void scanNode(const SSTReader &reader, off_t offset, int64_t start, int64_t end, off_t pageStartOffset, off_t pageEndOffset, std::vector<std::pair<int64_t, int64_t>> &result, ReadAhead &readAhead);
     void scanPage(const char *pageBuffer, int64_t start, int64_t end, std::vector<std::pair<int64_t, int64_t>> &result);
 
     std::vector<std::pair<int64_t, int64_t>> mergedScan(int64_t start, int64_t end);
@@ -41,6 +159,51 @@ private:
     // **Added flag to indicate the use of B-tree search**
     bool useBTree = false;
 
+    // Independent page reads of scans and MultiGet are issued together
+    bool asyncIO = true;
+
+    // SSTs are mapped into memory and searched in place, bypassing the buffer pool
+    bool mmapReads = false;
+
+    // SSTs are read and written with O_DIRECT, leaving the buffer pool the only cache
+    bool directIO = false;
+
+    // Page format of newly written SSTs; both formats remain readable
+    PageFormat pageFormat = PageFormat::Packed;
+
+    // Data block compression of newly written SSTs, applied from compressionMinLevel down
+    CompressionType compression = CompressionType::None;
+    size_t compressionMinLevel = 0;
+
+    // Data page size of newly written SSTs; every SST records its own
+    int blockSize = PAGE_SIZE;
+
+    // Compaction policy and level shape; an existing database restores them from its manifest
+    CompactionStyle compactionStyle = CompactionStyle::Tiered;
+    int64_t targetFileSize = TARGET_FILE_SIZE;
+    size_t levelSizeRatio;
+    std::vector<LevelOptions> levelOptions;
+
+    // Key ranges merged in parallel by a compaction into a sorted level
+    size_t maxSubcompactions = 1;
+
+    // Compaction runs on a background thread; writes stall as compaction debt grows
+    bool backgroundCompaction = false;
+    WriteStallOptions writeStallOptions;
+
+    // Flush and compaction I/O rate; 0 is unlimited
+    int64_t rateLimit = 0;
+    bool rateLimitAutoTune = false;
+    int64_t minRateLimit = 0;
+
+    // Write counters of the open database
+    std::atomic<int64_t> userBytesWritten{0};
+    std::atomic<int64_t> writes{0};
+    std::atomic<int64_t> flushes{0};
+    std::atomic<int64_t> flushBytesWritten{0};
+    std::atomic<int64_t> flushMicros{0};
+    std::atomic<int64_t> writeGroups{0};
+
 public:
     KVStore(int memtable_size, size_t levelSizeRatio = 2);
 
@@ -56,14 +219,102 @@ public:
     // Delete a key-value pair
     void Del(int64_t key);
 
+    // Apply every put and delete of a batch atomically. The batch is admitted
+    // to the memtable as a whole: a memtable without room for it is flushed
+    // first, and one the batch fills is flushed after it.
+    void Write(const WriteBatch &batch);
+
     // Retrieve a value by key
     int64_t Get(int64_t key);
 
+    // Retrieve the values of many keys, in the order of the keys; -1 for keys
+    // not found. The keys are sorted and deduplicated, and every SST is probed
+    // once for all keys in its range: its Bloom filter is read once, and each
+    // data page is read once for all keys it may hold.
+    std::vector<int64_t> MultiGet(const std::vector<int64_t> &keys);
+
     // Scan for key-value pairs in a range [start, end]
     std::pair<int64_t, int64_t> *Scan(int64_t start, int64_t end, int &result_count);
 
+    // Coroutine forms of Get and Scan. They suspend on every Bloom filter and
+    // page read that misses the buffer pool and resume once the executor
+    // completes it, so one event loop thread keeps many lookups in flight.
+    // Lookups follow the fence pointers whether or not the B-tree is enabled.
+    // The store must stay open until the returned tasks finish.
+    Task<int64_t> GetAsync(int64_t key, Executor &executor);
+    Task<std::vector<std::pair<int64_t, int64_t>>> ScanAsync(int64_t start, int64_t end, Executor &executor);
+
+    // Callback forms of GetAsync and ScanAsync; `done` receives the result, or
+    // the exception of a failed lookup, on a thread of the executor
+    void GetAsync(int64_t key, Executor &executor, std::function<void(int64_t, std::exception_ptr)> done);
+    void ScanAsync(int64_t start, int64_t end, Executor &executor,
+                   std::function<void(std::vector<std::pair<int64_t, int64_t>>, std::exception_ptr)> done);
+
     // **Method to set the search method (B-tree or binary search)**
     void SetUseBTree(bool flag);
+
+    // Method to issue the page reads of a scan or MultiGet together through
+    // io_uring (pread where it is unavailable) instead of one at a time
+    void SetAsyncIO(bool enabled);
+
+    // Method to map every SST read-only when it is opened and serve lookups
+    // and scans from the mapping in place, with the page cache as the only
+    // cache. It applies to SSTs opened afterwards, so it is set before Open.
+    void SetMmapReads(bool enabled);
+
+    // Method to read data pages and B-tree nodes with O_DIRECT into aligned
+    // buffers and write SSTs with O_DIRECT from aligned staging buffers, so
+    // the buffer pool is their only cache. Bloom filters and SST metadata
+    // are still read through the page cache. It takes precedence over mmap
+    // reads and applies to SSTs opened afterwards, so it is set before Open.
+    void SetDirectIO(bool enabled);
+
+    // Method to set the page format of newly written SSTs
+    void SetPageFormat(PageFormat format);
+
+    // Method to compress the data blocks of SSTs written to levels at or below minLevel
+    void SetCompression(CompressionType type, size_t minLevel = 0);
+
+    // Method to set the data page size of newly written SSTs (4 KB to 64 KB)
+    void SetBlockSize(int size);
+
+    // Method to choose tiered, leveled or lazy leveled compaction; compactions
+    // into sorted levels split their output into SSTs of about targetFileSize
+    // bytes. The style of an open database with SSTs below level 0 cannot change.
+    void SetCompactionStyle(CompactionStyle style, int64_t targetFileSize = TARGET_FILE_SIZE);
+
+    // Method to set the size ratio and run limit of one level
+    void SetLevelOptions(size_t level, LevelOptions options);
+
+    // Method to split compactions into sorted levels into up to `count` key
+    // ranges merged on parallel threads
+    void SetMaxSubcompactions(size_t count);
+
+    // Method to limit flush and compaction I/O to bytesPerSecond (0 is
+    // unlimited). Flushes take precedence over compactions. With autoTune the
+    // limit drops toward minBytesPerSecond while foreground reads slow down.
+    void SetRateLimit(int64_t bytesPerSecond, bool autoTune = false, int64_t minBytesPerSecond = 0);
+
+    // Method to read the bytes and throttle time of flush (High) or compaction (Low) I/O
+    RateLimiterStats GetRateLimiterStats(IOPriority priority) const;
+
+    // Method to run compactions on a background thread instead of inside Put
+    void SetBackgroundCompaction(bool enabled);
+
+    // Method to set the level 0 file and pending compaction byte limits past
+    // which Put is delayed (soft limits) or stopped (hard limits)
+    void SetWriteStallOptions(const WriteStallOptions &options);
+
+    // Method to read how often and how long Put was delayed or stopped
+    WriteStallStats GetWriteStallStats() const;
+
+    // Flushes the memtable and rewrites every SST overlapping [start, end]
+    // into the bottom level of the tree; the whole tree by default
+    CompactRangeStats CompactRange(int64_t start = INT64_MIN, int64_t end = INT64_MAX);
+
+    // Method to read the flush and per-level compaction counters, the write and
+    // space amplification they add up to, and the rate limiter and stall counters
+    KVStoreStats GetStats() const;
 };
 
 #endif
\ No newline at end of file
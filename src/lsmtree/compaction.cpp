@@ -0,0 +1,265 @@
+#include "compaction.h"
+#include "sst/sstwriter.h"
+#include <algorithm>
+#include <iterator>
+#include <cstdio>
+#include <ctime>
+
+namespace
+{
+    // A subcompaction covers at least this many input pages, so small jobs stay on one thread
+    constexpr size_t MIN_SUBCOMPACTION_PAGES = 16;
+
+    // CPU time consumed by the calling thread
+    int64_t threadCpuMicros()
+    {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return static_cast<int64_t>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+    }
+}
+
+MergingIterator::MergingIterator(std::vector<std::unique_ptr<SSTIterator>> inputs)
+    : inputs(std::move(inputs))
+{
+    for (size_t i = 0; i < this->inputs.size(); ++i)
+    {
+        push(i);
+    }
+}
+
+void MergingIterator::push(size_t input)
+{
+    if (inputs[input]->valid())
+    {
+        heap.push({inputs[input]->key(), input});
+    }
+}
+
+bool MergingIterator::valid() const
+{
+    return !heap.empty();
+}
+
+int64_t MergingIterator::key() const
+{
+    return heap.top().key;
+}
+
+int64_t MergingIterator::value() const
+{
+    return inputs[heap.top().input]->value();
+}
+
+void MergingIterator::next()
+{
+    int64_t current = heap.top().key;
+
+    // Advance every input positioned on the current key, discarding older versions
+    while (!heap.empty() && heap.top().key == current)
+    {
+        size_t input = heap.top().input;
+        heap.pop();
+        inputs[input]->next();
+        push(input);
+    }
+}
+
+int64_t MergingIterator::getBytesRead() const
+{
+    int64_t total = 0;
+    for (const auto &input : inputs)
+    {
+        total += input->getBytesRead();
+    }
+    return total;
+}
+
+CompactionJob::CompactionJob(std::vector<std::shared_ptr<SSTReader>> inputs,
+                             std::function<std::string()> newOutputFilename, CompactionOptions options)
+    : inputs(std::move(inputs)), newOutputFilename(std::move(newOutputFilename)), options(options)
+{
+    // Coalesce the ranges of older SSTs, so each tombstone is checked with one binary search
+    std::vector<std::pair<int64_t, int64_t>> ranges = options.olderKeyRanges;
+    std::sort(ranges.begin(), ranges.end());
+    for (const auto &range : ranges)
+    {
+        if (!olderKeyRanges.empty() && range.first <= olderKeyRanges.back().second)
+        {
+            olderKeyRanges.back().second = std::max(olderKeyRanges.back().second, range.second);
+        }
+        else
+        {
+            olderKeyRanges.push_back(range);
+        }
+    }
+}
+
+bool CompactionJob::mayHaveOlderVersion(int64_t key) const
+{
+    // The last range starting at or before the key is the only one that can cover it
+    auto it = std::upper_bound(olderKeyRanges.begin(), olderKeyRanges.end(), key,
+                               [](int64_t value, const std::pair<int64_t, int64_t> &range)
+                               { return value < range.first; });
+    return it != olderKeyRanges.begin() && key <= std::prev(it)->second;
+}
+
+std::string CompactionJob::nextOutputFilename()
+{
+    std::lock_guard<std::mutex> lock(filenameMutex);
+    return newOutputFilename();
+}
+
+std::vector<CompactionJob::Subcompaction> CompactionJob::splitKeyRange() const
+{
+    // Every fence key starts one input page, so evenly spaced fence keys
+    // split the input bytes roughly evenly
+    std::vector<int64_t> fences;
+    for (const auto &input : inputs)
+    {
+        fences.insert(fences.end(), input->fencePointers.begin(), input->fencePointers.end());
+    }
+    std::sort(fences.begin(), fences.end());
+
+    size_t ranges = std::min(options.maxSubcompactions, fences.size() / MIN_SUBCOMPACTION_PAGES);
+    if (!options.threadPool)
+    {
+        ranges = 1;
+    }
+
+    std::vector<Subcompaction> result;
+    int64_t start = INT64_MIN;
+    for (size_t i = 1; i < ranges; ++i)
+    {
+        int64_t boundary = fences[fences.size() * i / ranges];
+        if (boundary > start)
+        {
+            result.push_back({start, boundary - 1, {}});
+            start = boundary;
+        }
+    }
+    result.push_back({start, INT64_MAX, {}});
+    return result;
+}
+
+void CompactionJob::runSubcompaction(Subcompaction &subcompaction)
+{
+    int64_t cpuStart = threadCpuMicros();
+    std::vector<std::unique_ptr<SSTIterator>> iterators;
+    for (const auto &input : inputs)
+    {
+        iterators.push_back(std::make_unique<SSTIterator>(input, subcompaction.start, subcompaction.end,
+                                                          COMPACTION_READAHEAD_SIZE, options.rateLimiter));
+    }
+    MergingIterator merged(std::move(iterators));
+
+    std::unique_ptr<SSTWriter> writer;
+    auto finishOutput = [&]()
+    {
+        writer->finish();
+        subcompaction.bytesWritten += writer->getFileSize();
+        writer.reset();
+    };
+
+    for (; merged.valid(); merged.next())
+    {
+        if (options.dropTombstones && merged.value() == TOMBSTONE && !mayHaveOlderVersion(merged.key()))
+        {
+            ++subcompaction.droppedTombstones; // Nothing older remains for the tombstone to hide
+            continue;
+        }
+
+        if (!writer)
+        {
+            writer = std::make_unique<SSTWriter>(nextOutputFilename(), options.compression, options.blockSize, options.pageFormat);
+            writer->setRateLimiter(options.rateLimiter, IOPriority::Low);
+            writer->setDirectIO(options.directIO);
+            subcompaction.outputs.push_back(writer->filename);
+        }
+        writer->add(merged.key(), merged.value());
+        ++subcompaction.outputEntries;
+
+        // Keys are unique in the merged stream, so outputs never share a key.
+        // Only data pages count: the fixed header and filter would otherwise
+        // end every output after its first page under a small target.
+        if (options.targetFileSize > 0 && writer->getDataSize() >= options.targetFileSize)
+        {
+            finishOutput();
+        }
+    }
+    subcompaction.bytesRead = merged.getBytesRead();
+
+    if (writer)
+    {
+        finishOutput();
+    }
+    subcompaction.cpuMicros = threadCpuMicros() - cpuStart;
+}
+
+std::vector<std::string> CompactionJob::run()
+{
+    for (const auto &input : inputs)
+    {
+        inputEntries += input->numEntries;
+    }
+
+    std::vector<Subcompaction> ranges = splitKeyRange();
+    subcompactions = ranges.size();
+
+    // Every range is merged, even after another one failed, so that no task
+    // still writes an output when the outputs are removed
+    std::exception_ptr error;
+    if (ranges.size() == 1)
+    {
+        try
+        {
+            runSubcompaction(ranges[0]);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+    else
+    {
+        std::vector<std::future<void>> results;
+        for (auto &range : ranges)
+        {
+            results.push_back(options.threadPool->submit([this, &range]()
+                                                         { runSubcompaction(range); }));
+        }
+        for (auto &result : results)
+        {
+            try
+            {
+                result.get();
+            }
+            catch (...)
+            {
+                error = error ? error : std::current_exception();
+            }
+        }
+    }
+
+    std::vector<std::string> outputs;
+    for (const auto &range : ranges)
+    {
+        outputs.insert(outputs.end(), range.outputs.begin(), range.outputs.end());
+        outputEntries += range.outputEntries;
+        droppedTombstones += range.droppedTombstones;
+        bytesRead += range.bytesRead;
+        bytesWritten += range.bytesWritten;
+        cpuMicros += range.cpuMicros;
+    }
+
+    if (error)
+    {
+        // Outputs are installed all together or not at all
+        for (const auto &output : outputs)
+        {
+            std::remove(output.c_str());
+        }
+        std::rethrow_exception(error);
+    }
+    return outputs;
+}
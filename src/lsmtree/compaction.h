@@ -0,0 +1,127 @@
+#ifndef COMPACTION_H
+#define COMPACTION_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+#include "sst/sstiterator.h"
+#include "page/page.h"
+#include "compression/compression.h"
+#include "threadpool.h"
+
+// MergingIterator merges any number of sorted SST iterators into one sorted
+// stream using a min-heap keyed on (key, input). Inputs are ordered from
+// oldest to newest; when several inputs hold the same key only the newest
+// version is returned.
+class MergingIterator
+{
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<SSTIterator>> inputs);
+
+    bool valid() const;
+    int64_t key() const;
+    int64_t value() const;
+    void next();
+
+    // Bytes of data pages read from all inputs so far
+    int64_t getBytesRead() const;
+
+private:
+    struct HeapEntry
+    {
+        int64_t key;
+        size_t input;
+
+        // Smallest key first; for equal keys the newest input first
+        bool operator>(const HeapEntry &other) const
+        {
+            return key != other.key ? key > other.key : input < other.input;
+        }
+    };
+
+    void push(size_t input); // Adds the current entry of an input to the heap
+
+    std::vector<std::unique_ptr<SSTIterator>> inputs;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+};
+
+// Settings of the SST written by a compaction
+struct CompactionOptions
+{
+    PageFormat pageFormat = PageFormat::Packed;
+    CompressionType compression = CompressionType::None;
+    int blockSize = PAGE_SIZE;
+    // Drops tombstones whose key lies outside every range of olderKeyRanges, the
+    // key ranges of the SSTs that may hold older versions of the output's keys
+    bool dropTombstones = false;
+    std::vector<std::pair<int64_t, int64_t>> olderKeyRanges;
+    int64_t targetFileSize = 0;  // Start a new output SST past this many data bytes; 0 writes a single output
+
+    // Upper bound on the key ranges merged in parallel on threadPool. Every
+    // range covers a minimum number of input pages, so small jobs use fewer.
+    size_t maxSubcompactions = 1;
+    ThreadPool *threadPool = nullptr;
+
+    RateLimiter *rateLimiter = nullptr; // Throttles input reads and output writes at low priority
+    bool directIO = false;              // Writes the outputs with O_DIRECT
+};
+
+// CompactionJob merges a set of input SSTs into one or more output SSTs with
+// disjoint key ranges, streaming entries from a MergingIterator into an
+// SSTWriter, so memory use does not depend on the size of the inputs. Large
+// jobs may be split into subcompactions over disjoint key ranges that run in
+// parallel; their outputs are only returned once every range succeeded.
+class CompactionJob
+{
+public:
+    // Inputs are ordered from oldest to newest; newOutputFilename names each output SST
+    CompactionJob(std::vector<std::shared_ptr<SSTReader>> inputs,
+                  std::function<std::string()> newOutputFilename, CompactionOptions options);
+
+    // Runs the merge and returns the output SSTs in key order; empty if every
+    // entry was dropped. If any range fails, every output is removed and the
+    // error is rethrown.
+    std::vector<std::string> run();
+
+    // Statistics of the finished job
+    int64_t inputEntries = 0;
+    int64_t outputEntries = 0;
+    int64_t droppedTombstones = 0;
+    int64_t bytesRead = 0;
+    int64_t bytesWritten = 0;
+    int64_t cpuMicros = 0; // CPU time of every thread that merged a range
+    size_t subcompactions = 0;
+
+private:
+    // Outputs and statistics of the merge of one key range
+    struct Subcompaction
+    {
+        int64_t start;
+        int64_t end;
+        std::vector<std::string> outputs;
+        int64_t outputEntries = 0;
+        int64_t droppedTombstones = 0;
+        int64_t bytesRead = 0;
+        int64_t bytesWritten = 0;
+        int64_t cpuMicros = 0;
+    };
+
+    // Splits the key space at fence keys into ranges holding similar numbers of input pages
+    std::vector<Subcompaction> splitKeyRange() const;
+    void runSubcompaction(Subcompaction &subcompaction);
+    bool mayHaveOlderVersion(int64_t key) const; // True if an older SST may hold the key
+
+    std::string nextOutputFilename(); // Serializes calls to newOutputFilename
+
+    std::vector<std::shared_ptr<SSTReader>> inputs;
+    std::function<std::string()> newOutputFilename;
+    CompactionOptions options;
+    std::vector<std::pair<int64_t, int64_t>> olderKeyRanges; // Disjoint and sorted
+    std::mutex filenameMutex;
+};
+
+#endif // COMPACTION_H
@@ -0,0 +1,239 @@
+#include "compactionpolicy.h"
+#include "lsmtree.h"
+#include <stdexcept>
+
+namespace
+{
+    // SSTs at least this fraction tombstones are compacted first, and even
+    // when their level is within its limit
+    constexpr double TOMBSTONE_COMPACTION_RATIO = 0.5;
+
+    bool isTombstoneDense(const SSTReader &reader)
+    {
+        return reader.numTombstones > 0 && reader.numTombstones >= TOMBSTONE_COMPACTION_RATIO * reader.numEntries;
+    }
+}
+
+std::string compactionStyleName(CompactionStyle style)
+{
+    switch (style)
+    {
+    case CompactionStyle::Tiered:
+        return "tiered";
+    case CompactionStyle::Leveled:
+        return "leveled";
+    case CompactionStyle::LazyLeveled:
+        return "lazy_leveled";
+    }
+    throw std::runtime_error("Unknown compaction style.");
+}
+
+bool parseCompactionStyle(const std::string &name, CompactionStyle &style)
+{
+    for (CompactionStyle candidate : {CompactionStyle::Tiered, CompactionStyle::Leveled, CompactionStyle::LazyLeveled})
+    {
+        if (compactionStyleName(candidate) == name)
+        {
+            style = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<CompactionPolicy> makeCompactionPolicy(CompactionStyle style)
+{
+    switch (style)
+    {
+    case CompactionStyle::Tiered:
+        return std::make_unique<TieredCompactionPolicy>();
+    case CompactionStyle::Leveled:
+        return std::make_unique<LeveledCompactionPolicy>();
+    case CompactionStyle::LazyLeveled:
+        return std::make_unique<LazyLeveledCompactionPolicy>();
+    }
+    throw std::runtime_error("Unknown compaction style.");
+}
+
+// Tiered compaction
+
+CompactionStyle TieredCompactionPolicy::getStyle() const
+{
+    return CompactionStyle::Tiered;
+}
+
+bool TieredCompactionPolicy::isSortedLevel(const LSMTree &, size_t) const
+{
+    return false;
+}
+
+bool TieredCompactionPolicy::pickCompaction(LSMTree &tree, CompactionTask &task)
+{
+    // Every SST of a tiered level is one run; merge the first level that is full
+    for (size_t level = 0; level < tree.getNumLevels(); ++level)
+    {
+        if (tree.getLevelFileCount(level) >= tree.getMaxRuns(level))
+        {
+            task.kind = CompactionTask::Kind::Merge;
+            task.level = level;
+            task.files = tree.getSSTFilesByLevel(level);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Leveled compaction
+
+CompactionStyle LeveledCompactionPolicy::getStyle() const
+{
+    return CompactionStyle::Leveled;
+}
+
+bool LeveledCompactionPolicy::isSortedLevel(const LSMTree &, size_t level) const
+{
+    return level > 0;
+}
+
+bool LeveledCompactionPolicy::pickCompaction(LSMTree &tree, CompactionTask &task)
+{
+    task.kind = CompactionTask::Kind::MergeInto;
+
+    // Level 0 is merged as a whole once it collects maxRuns SSTs
+    if (tree.getLevelFileCount(0) >= tree.getMaxRuns(0))
+    {
+        task.level = 0;
+        task.files = tree.getSSTFilesByLevel(0);
+        return true;
+    }
+
+    // Otherwise push one SST down from the first level over its size limit
+    for (size_t level = 1; level < tree.getNumLevels(); ++level)
+    {
+        if (tree.getLevelBytes(level) > tree.getMaxLevelBytes(level))
+        {
+            task.level = level;
+            task.files = {tree.getSSTFilesByLevel(level)[pickFile(tree, level)]};
+            return true;
+        }
+    }
+
+    // Then push down SSTs dense with tombstones, so deleted keys and the older
+    // versions they hide are reclaimed without waiting for the level to fill
+    for (size_t level = 1; level < tree.getNumLevels(); ++level)
+    {
+        if (!tree.hasOlderData(level))
+        {
+            break; // Tombstones of the last level have nothing left to hide
+        }
+        int densest = pickTombstoneDenseFile(tree, level);
+        if (densest >= 0)
+        {
+            task.level = level;
+            task.files = {tree.getSSTFilesByLevel(level)[densest]};
+            return true;
+        }
+    }
+    return false;
+}
+
+int LeveledCompactionPolicy::pickTombstoneDenseFile(LSMTree &tree, size_t level)
+{
+    std::vector<std::string> files = tree.getSSTFilesByLevel(level);
+    int densest = -1;
+    double maxDensity = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        std::shared_ptr<SSTReader> reader = tree.openSSTReader(files[i]);
+        double density = static_cast<double>(reader->numTombstones) / reader->numEntries;
+        if (isTombstoneDense(*reader) && density > maxDensity)
+        {
+            densest = static_cast<int>(i);
+            maxDensity = density;
+        }
+    }
+    return densest;
+}
+
+size_t LeveledCompactionPolicy::pickFile(LSMTree &tree, size_t level)
+{
+    if (compactPointers.size() <= level)
+    {
+        compactPointers.resize(level + 1, INT64_MIN);
+    }
+
+    // SSTs dense with tombstones go first: pushing them down shrinks the level the most
+    int densest = pickTombstoneDenseFile(tree, level);
+    if (densest >= 0)
+    {
+        return densest;
+    }
+
+    // The first SST past the end of the previously compacted one, wrapping around
+    std::vector<std::string> files = tree.getSSTFilesByLevel(level);
+    size_t picked = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (tree.openSSTReader(files[i])->startingKey > compactPointers[level])
+        {
+            picked = i;
+            break;
+        }
+    }
+    compactPointers[level] = tree.openSSTReader(files[picked])->endingKey;
+    return picked;
+}
+
+// Lazy leveled compaction
+
+CompactionStyle LazyLeveledCompactionPolicy::getStyle() const
+{
+    return CompactionStyle::LazyLeveled;
+}
+
+size_t LazyLeveledCompactionPolicy::getLargestLevel(const LSMTree &tree) const
+{
+    size_t largest = 1;
+    for (size_t level = 1; level < tree.getNumLevels(); ++level)
+    {
+        if (tree.getLevelFileCount(level) > 0)
+        {
+            largest = level;
+        }
+    }
+    return largest;
+}
+
+bool LazyLeveledCompactionPolicy::isSortedLevel(const LSMTree &tree, size_t level) const
+{
+    return level == getLargestLevel(tree);
+}
+
+bool LazyLeveledCompactionPolicy::pickCompaction(LSMTree &tree, CompactionTask &task)
+{
+    size_t largest = getLargestLevel(tree);
+
+    // A full tiered level is merged into a new run of the next level, or into
+    // the sorted run of the largest level
+    for (size_t level = 0; level < largest; ++level)
+    {
+        if (tree.getLevelFileCount(level) >= tree.getMaxRuns(level))
+        {
+            task.kind = level + 1 == largest ? CompactionTask::Kind::MergeInto : CompactionTask::Kind::Merge;
+            task.level = level;
+            task.files = tree.getSSTFilesByLevel(level);
+            return true;
+        }
+    }
+
+    // Once the largest level outgrows its capacity, its run moves down and
+    // becomes the new largest level, leaving a tiered level above it
+    if (tree.getLevelBytes(largest) > tree.getMaxLevelBytes(largest))
+    {
+        task.kind = CompactionTask::Kind::Move;
+        task.level = largest;
+        task.files = tree.getSSTFilesByLevel(largest);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#ifndef COMPACTIONPOLICY_H
+#define COMPACTIONPOLICY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class LSMTree;
+
+// How the levels of the tree are organized
+enum class CompactionStyle
+{
+    Tiered,     // Every level collects overlapping runs and is merged into one run of the next level
+    Leveled,    // Levels 1+ are sorted runs of non-overlapping SSTs capped at the target file size
+    LazyLeveled // Tiered levels above a single leveled largest level (Dostoevsky)
+};
+
+// Returns the name of a style as stored in the manifest ("tiered", "leveled", "lazy_leveled")
+std::string compactionStyleName(CompactionStyle style);
+
+// Parses a style name; returns false if the name is unknown
+bool parseCompactionStyle(const std::string &name, CompactionStyle &style);
+
+// Shape of one level. Zero fields fall back to the size ratio of the tree.
+struct LevelOptions
+{
+    size_t sizeRatio = 0; // Capacity of a sorted level relative to the level above
+    size_t maxRuns = 0;   // Runs a tiered level (or level 0) collects before it is compacted
+};
+
+// A compaction chosen by a policy
+struct CompactionTask
+{
+    enum class Kind
+    {
+        Merge,     // Merge the files into one new run appended to the next level
+        MergeInto, // Merge the files with the overlapping SSTs of the sorted next level
+        Move       // Move the files to the next level without rewriting them
+    };
+
+    Kind kind = Kind::Merge;
+    size_t level = 0;               // Level of the input files
+    std::vector<std::string> files; // Input files, oldest first
+};
+
+// CompactionPolicy decides the shape of the tree: which levels hold one
+// sorted run of SSTs with disjoint key ranges, and which compaction runs
+// next. The LSMTree executes the tasks a policy picks until it picks none.
+class CompactionPolicy
+{
+public:
+    virtual ~CompactionPolicy() = default;
+
+    virtual CompactionStyle getStyle() const = 0;
+
+    // True if the level holds SSTs with disjoint key ranges, ordered by key
+    virtual bool isSortedLevel(const LSMTree &tree, size_t level) const = 0;
+
+    // Picks the next compaction; returns false once every level is within its limits
+    virtual bool pickCompaction(LSMTree &tree, CompactionTask &task) = 0;
+};
+
+// Merges a level once it collects maxRuns runs. Cheapest writes, most runs to search.
+class TieredCompactionPolicy : public CompactionPolicy
+{
+public:
+    CompactionStyle getStyle() const override;
+    bool isSortedLevel(const LSMTree &tree, size_t level) const override;
+    bool pickCompaction(LSMTree &tree, CompactionTask &task) override;
+};
+
+// Keeps one sorted run per level below level 0 and pushes one SST at a time
+// from the first level over its byte limit. Fewest runs, most rewrites. SSTs
+// dense with tombstones are pushed down first, and also once every level is
+// within its limit, until their tombstones reach the last level and are dropped.
+class LeveledCompactionPolicy : public CompactionPolicy
+{
+public:
+    CompactionStyle getStyle() const override;
+    bool isSortedLevel(const LSMTree &tree, size_t level) const override;
+    bool pickCompaction(LSMTree &tree, CompactionTask &task) override;
+
+private:
+    // Index of the next SST of a level to push down, round-robin over the key space
+    size_t pickFile(LSMTree &tree, size_t level);
+
+    // Index of the SST of a level with the largest share of tombstones among
+    // those dense with them, or -1 if there is none
+    int pickTombstoneDenseFile(LSMTree &tree, size_t level);
+
+    // Each level is compacted starting after the largest key last pushed down
+    std::vector<int64_t> compactPointers;
+};
+
+// Tiers every level except the largest, which is one sorted run. Writes cost
+// about as much as tiering, while point lookups and long scans touch about as
+// many runs as leveling, since most of the data lives in the largest level.
+class LazyLeveledCompactionPolicy : public CompactionPolicy
+{
+public:
+    CompactionStyle getStyle() const override;
+    bool isSortedLevel(const LSMTree &tree, size_t level) const override;
+    bool pickCompaction(LSMTree &tree, CompactionTask &task) override;
+
+private:
+    // Deepest non-empty level, and at least level 1
+    size_t getLargestLevel(const LSMTree &tree) const;
+};
+
+std::unique_ptr<CompactionPolicy> makeCompactionPolicy(CompactionStyle style);
+
+#endif // COMPACTIONPOLICY_H
@@ -3,25 +3,360 @@
 #include <unordered_map>
 #include <algorithm> // For std::sort and std::unique
 #include "lsmtree.h"
+#include "compaction.h"
 #include "page/page.h"
 #include "global/globals.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstdio>
+#include <chrono>
+#include <filesystem>
+
+namespace
+{
+    // The manifest names SSTs relative to the database directory
+    std::string fileName(const std::string &path)
+    {
+        return std::filesystem::path(path).filename().string();
+    }
+}
 
 LSMTree::LSMTree(const std::string &db_name, size_t levelSizeRatio)
-    : db_name(db_name), levelSizeRatio(levelSizeRatio)
+    : levelSizeRatio(levelSizeRatio), db_name(db_name), policy(makeCompactionPolicy(CompactionStyle::Tiered))
 {
+    if (levelSizeRatio < 2)
+    {
+        throw std::runtime_error("Level size ratio must be at least 2.");
+    }
     ensureLevelExists(0); // Start with the first level
+    publishVersion();
+}
+
+LSMTree::~LSMTree()
+{
+    setBackgroundCompaction(false);
 }
 
 void LSMTree::clearLevels()
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     for (auto &level : levels)
     {
         level.clear();
     }
     levels.clear();
+    tableFiles.clear();
+    manifest.reset();
+    publishVersion();
+    policy = makeCompactionPolicy(policy->getStyle()); // Drop per-level compaction state
+}
+
+void LSMTree::setManifest(std::unique_ptr<Manifest> log)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    manifest = std::move(log);
+    manifest->writeSnapshot(makeSnapshot());
+}
+
+VersionEdit LSMTree::makeSnapshot() const
+{
+    VersionEdit snapshot;
+    snapshot.fileCounter = fileCounter;
+    snapshot.compactionStyle = policy->getStyle();
+    snapshot.sizeRatio = levelSizeRatio;
+    snapshot.targetFileSize = targetFileSize;
+    for (size_t level = 0; level < levelOptions.size(); ++level)
+    {
+        if (levelOptions[level].sizeRatio != 0 || levelOptions[level].maxRuns != 0)
+        {
+            snapshot.levelOptions.emplace_back(level, levelOptions[level]);
+        }
+    }
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        for (const auto &file : levels[level])
+        {
+            snapshot.addedFiles.emplace_back(level, fileName(file));
+        }
+    }
+    return snapshot;
+}
+
+void LSMTree::logEdit(VersionEdit &edit)
+{
+    if (!manifest)
+    {
+        return;
+    }
+    edit.fileCounter = fileCounter;
+
+    // The SSTs the edit adds were synced when written; their directory entries
+    // must be durable too before the manifest names them
+    if (!edit.addedFiles.empty())
+    {
+        manifest->syncDirectory();
+    }
+    if (manifest->needsSnapshot())
+    {
+        manifest->writeSnapshot(makeSnapshot()); // The levels already include the edit
+    }
+    else
+    {
+        manifest->append(edit);
+    }
+}
+
+void LSMTree::installEdit(VersionEdit &edit)
+{
+    logEdit(edit);
+    for (const auto &deleted : edit.deletedFiles)
+    {
+        // SSTs moved to another level are deleted and added by the same edit
+        bool moved = std::any_of(edit.addedFiles.begin(), edit.addedFiles.end(), [&deleted](const auto &added)
+                                 { return added.second == deleted.second; });
+        auto it = tableFiles.find(db_name + "/" + deleted.second);
+        if (!moved && it != tableFiles.end())
+        {
+            it->second->markObsolete();
+            tableFiles.erase(it);
+        }
+    }
+    publishVersion();
+}
+
+void LSMTree::publishVersion()
+{
+    std::vector<Version::Level> files(levels.size());
+    std::vector<bool> sortedLevels(levels.size());
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        for (const auto &file : levels[level])
+        {
+            files[level].push_back(getTableFile(file));
+        }
+        sortedLevels[level] = isSortedLevel(level);
+    }
+    currentVersion.store(std::make_shared<const Version>(std::move(files), std::move(sortedLevels)));
+}
+
+std::shared_ptr<const Version> LSMTree::getCurrentVersion() const
+{
+    return currentVersion.load();
+}
+
+void LSMTree::setPageFormat(PageFormat format)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    pageFormat = format;
+}
+
+void LSMTree::setCompression(CompressionType type, size_t minLevel)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    compression = type;
+    compressionMinLevel = minLevel;
+}
+
+CompressionType LSMTree::getCompression(size_t level) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return level >= compressionMinLevel ? compression : CompressionType::None;
+}
+
+void LSMTree::setBlockSize(int size)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    blockSize = size;
+}
+
+void LSMTree::setCompactionStyle(CompactionStyle style)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (style == policy->getStyle())
+    {
+        return;
+    }
+
+    // Levels below level 0 were shaped by the current policy; another policy
+    // could take an overlapping level for a sorted one
+    for (size_t level = 1; level < levels.size(); ++level)
+    {
+        if (!levels[level].empty())
+        {
+            throw std::runtime_error("Cannot switch to " + compactionStyleName(style) + " compaction: the tree holds SSTs below level 0.");
+        }
+    }
+    policy = makeCompactionPolicy(style);
+    publishVersion(); // Level 0 is the only level; lazy leveling sorts level 1 even while empty
+
+    VersionEdit edit;
+    edit.compactionStyle = style;
+    logEdit(edit);
+}
+
+CompactionStyle LSMTree::getCompactionStyle() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return policy->getStyle();
+}
+
+void LSMTree::setTargetFileSize(int64_t size)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (size <= 0)
+    {
+        throw std::runtime_error("Target file size must be positive.");
+    }
+    targetFileSize = size;
+
+    VersionEdit edit;
+    edit.targetFileSize = size;
+    logEdit(edit);
+}
+
+int64_t LSMTree::getTargetFileSize() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return targetFileSize;
+}
+
+void LSMTree::setLevelOptions(size_t level, LevelOptions options)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    // A tiered level with a single run would be compacted forever
+    if ((options.sizeRatio != 0 && options.sizeRatio < 2) || (options.maxRuns != 0 && options.maxRuns < 2))
+    {
+        throw std::runtime_error("Size ratio and runs of level " + std::to_string(level) + " must be at least 2.");
+    }
+    if (levelOptions.size() <= level)
+    {
+        levelOptions.resize(level + 1);
+    }
+    levelOptions[level] = options;
+
+    VersionEdit edit;
+    edit.levelOptions.emplace_back(level, options);
+    logEdit(edit);
+}
+
+LevelOptions LSMTree::getLevelOptions(size_t level) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return level < levelOptions.size() ? levelOptions[level] : LevelOptions();
+}
+
+size_t LSMTree::getSizeRatio(size_t level) const
+{
+    size_t ratio = getLevelOptions(level).sizeRatio;
+    return ratio != 0 ? ratio : levelSizeRatio;
+}
+
+size_t LSMTree::getMaxRuns(size_t level) const
+{
+    // By default a level collects as many runs as its size ratio
+    size_t runs = getLevelOptions(level).maxRuns;
+    return runs != 0 ? runs : getSizeRatio(level);
+}
+
+size_t LSMTree::getLevelSizeRatio() const
+{
+    return levelSizeRatio;
+}
+
+void LSMTree::setMaxSubcompactions(size_t count)
+{
+    std::lock_guard<std::mutex> running(compactionMutex); // The pool may be in use by a compaction
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    maxSubcompactions = std::max<size_t>(1, count);
+    if (maxSubcompactions == 1)
+    {
+        compactionPool.reset();
+    }
+    else if (!compactionPool || compactionPool->getNumThreads() != maxSubcompactions)
+    {
+        compactionPool = std::make_unique<ThreadPool>(maxSubcompactions);
+    }
+}
+
+RateLimiter &LSMTree::getRateLimiter()
+{
+    return rateLimiter;
+}
+
+std::string LSMTree::newSSTFilename()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return db_name + "/sst_" + std::to_string(++fileCounter) + ".sst";
+}
+
+uint64_t LSMTree::getFileCounter() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return fileCounter;
+}
+
+void LSMTree::setFileCounter(uint64_t counter)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    fileCounter = counter;
+}
+
+void LSMTree::setMmapReads(bool enabled)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    mmapReads = enabled;
+}
+
+void LSMTree::setDirectIO(bool enabled)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    directIO = enabled;
+}
+
+std::shared_ptr<SSTReader> LSMTree::openSSTReader(const std::string &sst_filename)
+{
+    std::shared_ptr<SSTReader> reader = getSSTReader(sst_filename);
+    if (!reader)
+    {
+        throw std::runtime_error("Failed to open SST file: " + sst_filename);
+    }
+    return reader;
+}
+
+std::shared_ptr<SSTReader> LSMTree::getSSTReader(const std::string &sst_filename)
+{
+    try
+    {
+        return getTableFile(sst_filename)->reader;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+std::shared_ptr<TableFile> LSMTree::getTableFile(const std::string &sst_filename)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto it = tableFiles.find(sst_filename);
+    if (it != tableFiles.end())
+    {
+        return it->second;
+    }
+
+    auto reader = std::make_shared<SSTReader>(sst_filename);
+    if (directIO)
+    {
+        reader->openDirect();
+    }
+    else if (mmapReads)
+    {
+        reader->mapFile();
+    }
+    auto file = std::make_shared<TableFile>(sst_filename, reader);
+    tableFiles[sst_filename] = file;
+    return file;
 }
 
 void LSMTree::dumpSSTFile(const std::string &sst_filename)
@@ -61,7 +396,7 @@ void LSMTree::dumpSSTFile(const std::string &sst_filename)
 
     // Dump the SST file contents in hex
     std::cout << "SST File Dump (" << sst_filename << ", " << file_size << " bytes):\n";
-    for (size_t i = 0; i < file_size; ++i)
+    for (off_t i = 0; i < file_size; ++i)
     {
         printf("%02x ", static_cast<unsigned char>(sst_file[i]));
         if ((i + 1) % 16 == 0)
@@ -80,11 +415,13 @@ void LSMTree::ensureLevelExists(size_t level)
 
 size_t LSMTree::getNumLevels() const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     return levels.size();
 }
 
 std::vector<std::string> LSMTree::getSSTFilesByLevel(size_t level) const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     if (level < levels.size())
     {
         return levels[level];
@@ -92,8 +429,15 @@ std::vector<std::string> LSMTree::getSSTFilesByLevel(size_t level) const
     return {};
 }
 
+size_t LSMTree::getLevelFileCount(size_t level) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return level < levels.size() ? levels[level].size() : 0;
+}
+
 void LSMTree::printLevels() const
 {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
     std::cout << "DEBUG: Current state of LSM Tree levels:" << std::endl;
 
     for (size_t i = 0; i < levels.size(); ++i)
@@ -116,385 +460,712 @@ void LSMTree::printLevels() const
     }
 }
 
-void LSMTree::addSSTToLevel(const std::string &sst_filename, size_t level)
+bool LSMTree::isSortedLevel(size_t level) const
 {
-    ensureLevelExists(level);
-    levels[level].emplace_back(sst_filename);
-    std::cout << "Added SST file " << sst_filename << " to level " << level << std::endl;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return policy->isSortedLevel(*this, level);
 }
 
-void LSMTree::addSST(const std::string &sstFileName)
+std::vector<std::string> LSMTree::getSSTFilesForKey(size_t level, int64_t key) const
 {
-    // Log the SST being added
-    std::cout << "DEBUG: Adding SST file: " << sstFileName << " to Level 0." << std::endl;
-
-    // Ensure Level 0 exists in the levels structure
-    ensureLevelExists(0);
-
-    // Add the new SST filename to Level 0
-    levels[0].push_back(sstFileName);
-
-    // Log the current size of Level 0
-    std::cout << "DEBUG: Level 0 size after addition: " << levels[0].size() << std::endl;
+    return getSSTFilesForRange(level, key, key);
+}
 
-    // Compact as soon as the level reaches the size ratio
-    if (levels[0].size() == levelSizeRatio)
+std::vector<std::string> LSMTree::getSSTFilesForRange(size_t level, int64_t start, int64_t end) const
+{
+    std::vector<std::string> result;
+    for (const auto &file : getCurrentVersion()->getFilesForRange(level, start, end))
     {
-        std::cout << "DEBUG: Level 0 reached size ratio (" << levelSizeRatio << "). Triggering compaction." << std::endl;
-        compact(); // Trigger compaction if needed
+        result.push_back(file->filename);
     }
-
-    printLevels();
+    return result;
 }
 
-void LSMTree::compact()
+int64_t LSMTree::getLevelBytes(size_t level)
 {
-    mergeLevels(0); // Start compaction from Level 0
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    int64_t bytes = 0;
+    if (level < levels.size())
+    {
+        for (const auto &file : levels[level])
+        {
+            bytes += openSSTReader(file)->fileSize;
+        }
+    }
+    return bytes;
 }
 
-void LSMTree::mergeLevels(size_t level)
+int64_t LSMTree::getMaxLevelBytes(size_t level) const
 {
-    // Ensure the next level exists before merging
-    ensureLevelExists(level + 1);
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    // Level 1 holds sizeRatio target-sized SSTs; every further level is its sizeRatio times larger
+    int64_t bytes = targetFileSize;
+    for (size_t i = 1; i <= level; ++i)
+    {
+        bytes *= getSizeRatio(i);
+    }
+    return bytes;
+}
 
-    // Check if there are exactly two SSTs to merge at the current level
-    if (levels[level].size() != levelSizeRatio)
+void LSMTree::restoreLevels(const std::vector<std::vector<std::string>> &files)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    for (size_t level = 0; level < files.size(); ++level)
     {
-        return; // No merge needed
+        for (const auto &file : files[level])
+        {
+            addSSTToLevel(file, level);
+        }
     }
 
-    // Extract the filenames of the two SSTs to merge
-    std::string sst1_filename = levels[level][0];
-    std::string sst2_filename = levels[level][1];
+    // Edits append the outputs of compactions into sorted levels, so their key
+    // order is restored once every level is known
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        if (isSortedLevel(level))
+        {
+            std::sort(levels[level].begin(), levels[level].end(), [this](const std::string &a, const std::string &b)
+                      { return openSSTReader(a)->startingKey < openSSTReader(b)->startingKey; });
+        }
+    }
+    publishVersion();
+}
 
-    bool isLargestLevel = (level + 1) == (getNumLevels() - 1);
-    // Perform the merge
-    std::shared_ptr<SST> mergedSST = mergeTwoSSTs(sst1_filename, sst2_filename, isLargestLevel);
+void LSMTree::addSSTToLevel(const std::string &sst_filename, size_t level)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    ensureLevelExists(level);
+    levels[level].emplace_back(sst_filename);
+    getTableFile(sst_filename); // Load metadata and fence pointers up front
+    publishVersion();
+    updateWriteStallCondition();
+    std::cout << "Added SST file " << sst_filename << " to level " << level << std::endl;
+}
 
-    auto extractNumericSuffix = [](const std::string &filename) -> int
+void LSMTree::addSST(const std::string &sstFileName)
+{
     {
-        size_t start = filename.find_last_of('_') + 1;
-        size_t end = filename.find_last_of('.');
-        return std::stoi(filename.substr(start, end - start));
-    };
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+
+        // Log the SST being added
+        std::cout << "DEBUG: Adding SST file: " << sstFileName << " to Level 0." << std::endl;
 
-    int suffix1 = extractNumericSuffix(sst1_filename);
-    int suffix2 = extractNumericSuffix(sst2_filename);
+        // Ensure Level 0 exists in the levels structure
+        ensureLevelExists(0);
 
-    // Combine the numeric suffixes in ascending order
-    std::string merged_suffix = (suffix1 < suffix2)
-                                    ? std::to_string(suffix1) + "_" + std::to_string(suffix2)
-                                    : std::to_string(suffix2) + "_" + std::to_string(suffix1);
+        // Add the new SST filename to Level 0
+        levels[0].push_back(sstFileName);
 
-    // Construct the merged filename
-    std::string merged_filename = db_name + "/sst_" + merged_suffix + ".sst";
+        VersionEdit edit;
+        edit.addedFiles.emplace_back(0, fileName(sstFileName));
+        logEdit(edit);
+        publishVersion(); // Loads the metadata and fence pointers of the SST
 
-    // Write the merged SST to the file
-    mergedSST->writeToFile(merged_filename);
+        // Log the current size of Level 0
+        std::cout << "DEBUG: Level 0 size after addition: " << levels[0].size() << std::endl;
+        updateWriteStallCondition();
+    }
 
-    // Remove the old SSTs from the current level (both in memory and on disk)
-    if (std::remove(sst1_filename.c_str()) != 0)
+    // The policy decides whether any level is full
+    if (compactionThread.joinable())
     {
-        std::cerr << "Warning: Failed to delete file " << sst1_filename << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(backgroundMutex);
+            compactionRequested = true;
+        }
+        backgroundWork.notify_one();
     }
-    if (std::remove(sst2_filename.c_str()) != 0)
+    else
     {
-        std::cerr << "Warning: Failed to delete file " << sst2_filename << std::endl;
+        compact();
     }
 
-    // Remove the old SSTs from the current level
-    levels[level].clear();
-
-    // Add the merged SST to the next level
-    levels[level + 1].push_back(merged_filename);
+    printLevels();
+}
 
-    // If the next level exceeds the size ratio, recursively compact it
-    if (levels[level + 1].size() == levelSizeRatio)
+void LSMTree::compact()
+{
+    std::lock_guard<std::mutex> running(compactionMutex);
+    CompactionTask task;
+    while (!stopBackground)
     {
-        mergeLevels(level + 1);
+        TreeLock lock(mutex);
+        if (!policy->pickCompaction(*this, task))
+        {
+            break;
+        }
+        runCompaction(task, lock);
+        updateWriteStallCondition();
+        lock.unlock();
+        compactionProgress.notify_all();
     }
 }
 
-std::shared_ptr<SST> LSMTree::mergeTwoSSTs(const std::string &sst1_filename, const std::string &sst2_filename, bool isLargestLevel)
+CompactRangeStats LSMTree::compactRange(int64_t start, int64_t end)
 {
-    // Open SST files
-    int sst1_fd = open(sst1_filename.c_str(), O_RDONLY);
-    int sst2_fd = open(sst2_filename.c_str(), O_RDONLY);
-
-    if (sst1_fd == -1 || sst2_fd == -1)
+    if (start > end)
     {
-        throw std::runtime_error("Failed to open SST files for merging.");
+        throw std::runtime_error("Compaction range start must not exceed its end.");
     }
 
-    // Read numPages metadata
-    int numpages1, numpages2;
-    ssize_t bytesRead1 = pread(sst1_fd, &numpages1, sizeof(int), sizeof(int)); // Offset 4 (after numEntries)
-    ssize_t bytesRead2 = pread(sst2_fd, &numpages2, sizeof(int), sizeof(int));
+    std::lock_guard<std::mutex> running(compactionMutex);
+    TreeLock lock(mutex);
+    CompactRangeStats stats;
 
-    if (bytesRead1 != sizeof(int) || bytesRead2 != sizeof(int))
+    size_t bottom = 1;
+    for (size_t level = 1; level < levels.size(); ++level)
+    {
+        if (!levels[level].empty())
+        {
+            bottom = level;
+        }
+    }
+    ensureLevelExists(bottom);
+    stats.outputLevel = bottom;
+
+    // Pick the overlapping SSTs of every level, oldest first, until the range
+    // covers all of them
+    std::vector<std::vector<std::string>> selected;
+    bool widened = true;
+    while (widened)
     {
-        close(sst1_fd);
-        close(sst2_fd);
-        throw std::runtime_error("Failed to read numPages from SST files.");
+        widened = false;
+        selected.assign(bottom + 1, {});
+        for (size_t level = 0; level <= bottom; ++level)
+        {
+            for (const auto &file : levels[level])
+            {
+                std::shared_ptr<SSTReader> reader = openSSTReader(file);
+                if (reader->endingKey < start || reader->startingKey > end)
+                {
+                    continue;
+                }
+                selected[level].push_back(file);
+                if (reader->startingKey < start || reader->endingKey > end)
+                {
+                    start = std::min(start, reader->startingKey);
+                    end = std::max(end, reader->endingKey);
+                    widened = true;
+                }
+            }
+        }
     }
 
-    // Initialize offsets to the start of the first page
-    off_t offset1 = SST_METADATA_SIZE + PAGE_SIZE;
-    off_t offset2 = SST_METADATA_SIZE + PAGE_SIZE;
+    // The bottom level holds the oldest data, level 0 the newest
+    std::vector<std::shared_ptr<SSTReader>> inputs;
+    for (size_t level = bottom + 1; level-- > 0;)
+    {
+        for (const auto &file : selected[level])
+        {
+            inputs.push_back(openSSTReader(file));
+        }
+    }
+    stats.inputFiles = inputs.size();
 
-    // Initialize buffers for pages
-    char buffer1[PAGE_SIZE] = {0};
-    char buffer2[PAGE_SIZE] = {0};
+    if (!inputs.empty())
+    {
+        bool sorted = isSortedLevel(bottom);
+        CompactionOptions options;
+        options.pageFormat = pageFormat;
+        options.compression = getCompression(bottom);
+        options.blockSize = blockSize;
+        options.rateLimiter = &rateLimiter;
+        options.directIO = directIO;
+        options.dropTombstones = true; // Nothing lies below the bottom level
+        if (sorted)
+        {
+            options.targetFileSize = targetFileSize;
+            options.maxSubcompactions = maxSubcompactions;
+            options.threadPool = compactionPool.get();
+        }
 
-    int currentPage1 = 0, currentPage2 = 0;
+        CompactionJob job(inputs, [this]()
+                          { return newSSTFilename(); }, options);
+        auto started = std::chrono::steady_clock::now();
+        lock.unlock();
+        std::vector<std::string> outputs = job.run();
+        inputs.clear();
+        lock.lock();
+        recordCompaction(bottom, job, stats.inputFiles, outputs.size(), started);
+
+        VersionEdit edit;
+        for (size_t level = 0; level <= bottom; ++level)
+        {
+            removeSSTFiles(level, selected[level], edit);
+        }
+        std::vector<std::string> &outputFiles = levels[bottom];
+        outputFiles.insert(outputFiles.end(), outputs.begin(), outputs.end());
+        if (sorted)
+        {
+            std::sort(outputFiles.begin(), outputFiles.end(), [this](const std::string &a, const std::string &b)
+                      { return openSSTReader(a)->startingKey < openSSTReader(b)->startingKey; });
+        }
+        for (const auto &output : outputs)
+        {
+            edit.addedFiles.emplace_back(bottom, fileName(output));
+        }
+        installEdit(edit);
 
-    // Read the first pages into buffers
-    bytesRead1 = pread(sst1_fd, buffer1, PAGE_SIZE, offset1);
-    bytesRead2 = pread(sst2_fd, buffer2, PAGE_SIZE, offset2);
+        stats.outputFiles = outputs.size();
+        stats.bytesRead = job.bytesRead;
+        stats.bytesWritten = job.bytesWritten;
+        stats.droppedTombstones = job.droppedTombstones;
+        updateWriteStallCondition();
+    }
 
-    if (bytesRead1 != PAGE_SIZE || bytesRead2 != PAGE_SIZE)
+    for (size_t level = 0; level < levels.size(); ++level)
     {
-        close(sst1_fd);
-        close(sst2_fd);
-        throw std::runtime_error("Failed to read initial pages from SST files.");
+        stats.levelFiles.push_back(levels[level].size());
+        stats.levelBytes.push_back(getLevelBytes(level));
     }
+    lock.unlock();
+    compactionProgress.notify_all();
+    printLevels();
+    return stats;
+}
 
-    // Extract number of entries from each page
-    int numEntries1, numEntries2;
-    std::memcpy(&numEntries1, buffer1, sizeof(int)); // Extract numEntries for SST1
-    std::memcpy(&numEntries2, buffer2, sizeof(int)); // Extract numEntries for SST2
-
-    // Initialize positions to read key-offset pairs after page metadata
-    size_t keyOffsetPos1 = sizeof(int) + sizeof(int64_t) + sizeof(int); // Adjust based on actual metadata layout
-    size_t keyOffsetPos2 = sizeof(int) + sizeof(int64_t) + sizeof(int);
+void LSMTree::runCompaction(const CompactionTask &task, TreeLock &lock)
+{
+    switch (task.kind)
+    {
+    case CompactionTask::Kind::Merge:
+        mergeLevel(task.level, task.files, lock);
+        break;
+    case CompactionTask::Kind::MergeInto:
+        compactIntoLevel(task.level, task.files, lock);
+        break;
+    case CompactionTask::Kind::Move:
+        moveToLevel(task.level, task.files);
+        break;
+    }
+}
 
-    // Extract Key-Offset pairs for SST1
-    std::vector<KeyOffset> keys1;
-    for (int i = 0; i < numEntries1; ++i)
+void LSMTree::setBackgroundCompaction(bool enabled)
+{
+    if (enabled && !compactionThread.joinable())
+    {
+        compactionRequested = true; // Pay off any debt left from before
+        compactionThread = std::thread(&LSMTree::backgroundCompactionLoop, this);
+    }
+    else if (!enabled && compactionThread.joinable())
     {
-        if (keyOffsetPos1 + sizeof(int64_t) + sizeof(int) > PAGE_SIZE)
         {
-            close(sst1_fd);
-            close(sst2_fd);
-            throw std::runtime_error("KeyOffsetPos1 exceeds PAGE_SIZE.");
+            std::lock_guard<std::mutex> lock(backgroundMutex);
+            stopBackground = true;
         }
-
-        KeyOffset keyOffset;
-        std::memcpy(&keyOffset.key, buffer1 + keyOffsetPos1, sizeof(int64_t));
-        std::memcpy(&keyOffset.valueOffset, buffer1 + keyOffsetPos1 + sizeof(int64_t), sizeof(int));
-        keys1.push_back(keyOffset);
-        keyOffsetPos1 += sizeof(int64_t) + sizeof(int);
+        backgroundWork.notify_one();
+        compactionThread.join();
+        stopBackground = false;
+        compactionProgress.notify_all(); // Stopped writers now compact themselves
     }
+}
 
-    // Extract Key-Offset pairs for SST2
-    std::vector<KeyOffset> keys2;
-    for (int i = 0; i < numEntries2; ++i)
+void LSMTree::backgroundCompactionLoop()
+{
+    std::unique_lock<std::mutex> lock(backgroundMutex);
+    while (true)
     {
-        if (keyOffsetPos2 + sizeof(int64_t) + sizeof(int) > PAGE_SIZE)
+        backgroundWork.wait(lock, [this]()
+                            { return stopBackground || compactionRequested; });
+        if (stopBackground)
         {
-            close(sst1_fd);
-            close(sst2_fd);
-            throw std::runtime_error("KeyOffsetPos2 exceeds PAGE_SIZE.");
+            return;
         }
+        compactionRequested = false;
 
-        KeyOffset keyOffset;
-        std::memcpy(&keyOffset.key, buffer2 + keyOffsetPos2, sizeof(int64_t));
-        std::memcpy(&keyOffset.valueOffset, buffer2 + keyOffsetPos2 + sizeof(int64_t), sizeof(int));
-        keys2.push_back(keyOffset);
-        keyOffsetPos2 += sizeof(int64_t) + sizeof(int);
+        lock.unlock();
+        try
+        {
+            compact();
+        }
+        catch (const std::exception &e)
+        {
+            // The failed task left the tree unchanged; the next flush retries
+            std::cerr << "ERROR: Background compaction failed: " << e.what() << std::endl;
+        }
+        lock.lock();
     }
+}
 
-    // Prepare the output SST
-    auto mergedSST = std::make_shared<SST>();
-    Page outputPage;
-
-    size_t keyIndex1 = 0, keyIndex2 = 0;
-
-    // Begin merging
-    while (currentPage1 < numpages1 || currentPage2 < numpages2)
+void LSMTree::setWriteStallOptions(const WriteStallOptions &options)
+{
+    if (options.l0SlowdownFiles > options.l0StopFiles ||
+        options.softPendingCompactionBytes > options.hardPendingCompactionBytes || options.delayedWriteRate <= 0)
     {
-        // Reload page from SST1 if keys1 are exhausted and more pages are available
-        if (keyIndex1 >= keys1.size() && (currentPage1 + 1) < numpages1)
-        {
-            offset1 += PAGE_SIZE;
-            bytesRead1 = pread(sst1_fd, buffer1, PAGE_SIZE, offset1);
-
-            if (bytesRead1 != PAGE_SIZE)
-            {
-                close(sst1_fd);
-                close(sst2_fd);
-                throw std::runtime_error("Failed to read a page from SST1.");
-            }
-
-            std::memcpy(&numEntries1, buffer1, sizeof(int)); // Update numEntries for new page
-            keys1.clear();
+        throw std::runtime_error("Write stall soft limits must not exceed the hard limits, and the delayed write rate must be positive.");
+    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    writeStallOptions = options;
+    updateWriteStallCondition();
+}
 
-            keyOffsetPos1 = sizeof(int) + sizeof(int64_t) + sizeof(int);
-            for (int i = 0; i < numEntries1; ++i)
-            {
-                if (keyOffsetPos1 + sizeof(int64_t) + sizeof(int) > PAGE_SIZE)
-                {
-                    close(sst1_fd);
-                    close(sst2_fd);
-                    throw std::runtime_error("KeyOffsetPos1 exceeds PAGE_SIZE during page reload.");
-                }
+WriteStallCondition LSMTree::getWriteStallCondition() const
+{
+    return writeStallCondition;
+}
 
-                KeyOffset keyOffset;
-                std::memcpy(&keyOffset.key, buffer1 + keyOffsetPos1, sizeof(int64_t));
-                std::memcpy(&keyOffset.valueOffset, buffer1 + keyOffsetPos1 + sizeof(int64_t), sizeof(int));
-                keys1.push_back(keyOffset);
-                keyOffsetPos1 += sizeof(int64_t) + sizeof(int);
-            }
+WriteStallStats LSMTree::getWriteStallStats() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    return writeStallStats;
+}
 
-            keyIndex1 = 0;
-            currentPage1++;
+int64_t LSMTree::getPendingCompactionBytes()
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    int64_t bytes = 0;
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        if (isSortedLevel(level))
+        {
+            bytes += std::max<int64_t>(0, getLevelBytes(level) - getMaxLevelBytes(level));
         }
-
-        // Reload page from SST2 if keys2 are exhausted and more pages are available
-        if (keyIndex2 >= keys2.size() && (currentPage2 + 1) < numpages2)
+        else if (levels[level].size() >= getMaxRuns(level))
         {
-            offset2 += PAGE_SIZE;
-            bytesRead2 = pread(sst2_fd, buffer2, PAGE_SIZE, offset2);
+            bytes += getLevelBytes(level); // A full tiered level is rewritten as a whole
+        }
+    }
+    return bytes;
+}
 
-            if (bytesRead2 != PAGE_SIZE)
-            {
-                close(sst1_fd);
-                close(sst2_fd);
-                throw std::runtime_error("Failed to read a page from SST2.");
-            }
+void LSMTree::updateWriteStallCondition()
+{
+    size_t l0Files = levels.empty() ? 0 : levels[0].size();
+    int64_t pendingBytes = getPendingCompactionBytes();
 
-            std::memcpy(&numEntries2, buffer2, sizeof(int)); // Update numEntries for new page
-            keys2.clear();
+    if (l0Files >= writeStallOptions.l0StopFiles || pendingBytes >= writeStallOptions.hardPendingCompactionBytes)
+    {
+        writeStallCondition = WriteStallCondition::Stopped;
+    }
+    else if (l0Files >= writeStallOptions.l0SlowdownFiles || pendingBytes >= writeStallOptions.softPendingCompactionBytes)
+    {
+        writeStallCondition = WriteStallCondition::Delayed;
+    }
+    else
+    {
+        writeStallCondition = WriteStallCondition::Normal;
+    }
+}
 
-            keyOffsetPos2 = sizeof(int) + sizeof(int64_t) + sizeof(int);
-            for (int i = 0; i < numEntries2; ++i)
-            {
-                if (keyOffsetPos2 + sizeof(int64_t) + sizeof(int) > PAGE_SIZE)
-                {
-                    close(sst1_fd);
-                    close(sst2_fd);
-                    throw std::runtime_error("KeyOffsetPos2 exceeds PAGE_SIZE during page reload.");
-                }
+void LSMTree::throttleWrite(int64_t bytes)
+{
+    using namespace std::chrono;
+    if (writeStallCondition == WriteStallCondition::Normal)
+    {
+        return;
+    }
 
-                KeyOffset keyOffset;
-                std::memcpy(&keyOffset.key, buffer2 + keyOffsetPos2, sizeof(int64_t));
-                std::memcpy(&keyOffset.valueOffset, buffer2 + keyOffsetPos2 + sizeof(int64_t), sizeof(int));
-                keys2.push_back(keyOffset);
-                keyOffsetPos2 += sizeof(int64_t) + sizeof(int);
+    if (writeStallCondition == WriteStallCondition::Stopped)
+    {
+        auto start = steady_clock::now();
+        if (compactionThread.joinable())
+        {
+            std::unique_lock<std::mutex> lock(stallMutex);
+            while (writeStallCondition == WriteStallCondition::Stopped && compactionThread.joinable())
+            {
+                compactionProgress.wait_for(lock, milliseconds(10));
             }
-
-            keyIndex2 = 0;
-            currentPage2++;
+        }
+        if (writeStallCondition == WriteStallCondition::Stopped)
+        {
+            compact(); // Without a background thread the writer pays off the debt itself
         }
 
-        // Determine the current keys to compare
-        int64_t key1 = (keyIndex1 < keys1.size()) ? keys1[keyIndex1].key : INT64_MAX;
-        int64_t key2 = (keyIndex2 < keys2.size()) ? keys2[keyIndex2].key : INT64_MAX;
-
-        std::cout << "Comparing keys: key1 = " << key1 << ", key2 = " << key2 << std::endl;
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        writeStallStats.stoppedWrites++;
+        writeStallStats.stopMicros += duration_cast<microseconds>(steady_clock::now() - start).count();
+    }
 
-        // Compare keys and merge
-        if (key1 < key2)
+    if (writeStallCondition == WriteStallCondition::Delayed)
+    {
+        // Sleep in steps of at least a millisecond to hold writes to the delayed rate
+        int64_t delay = 0;
         {
-            if (keyIndex1 >= keys1.size())
+            std::lock_guard<std::recursive_mutex> lock(mutex);
+            writeStallStats.delayedWrites++;
+            delayedBytes += bytes;
+            delay = delayedBytes * 1000000 / writeStallOptions.delayedWriteRate;
+            if (delay < 1000)
             {
-                break; // Or handle appropriately
+                return;
             }
+            delayedBytes = 0;
+            writeStallStats.delayMicros += delay;
+        }
+        std::this_thread::sleep_for(microseconds(delay));
+    }
+}
 
-            int valueOffset = keys1[keyIndex1].valueOffset;
-
-            // Validate valueOffset within the page
-            if (valueOffset < 0 || static_cast<size_t>(valueOffset) + sizeof(int64_t) > PAGE_SIZE)
-            {
-                close(sst1_fd);
-                close(sst2_fd);
-                throw std::runtime_error("Invalid valueOffset in SST1.");
-            }
+LevelCompactionStats &LSMTree::getLevelCompactionStats(size_t level)
+{
+    if (compactionStats.size() <= level)
+    {
+        compactionStats.resize(level + 1);
+    }
+    return compactionStats[level];
+}
 
-            int64_t value;
-            std::memcpy(&value, buffer1 + valueOffset, sizeof(int64_t));
+void LSMTree::recordCompaction(size_t outputLevel, const CompactionJob &job, size_t filesIn, size_t filesOut,
+                               std::chrono::steady_clock::time_point started)
+{
+    LevelCompactionStats &stats = getLevelCompactionStats(outputLevel);
+    stats.compactions++;
+    stats.filesIn += filesIn;
+    stats.filesOut += filesOut;
+    stats.bytesRead += job.bytesRead;
+    stats.bytesWritten += job.bytesWritten;
+    stats.entriesIn += job.inputEntries;
+    stats.entriesOverwritten += job.inputEntries - job.outputEntries - job.droppedTombstones;
+    stats.tombstonesDropped += job.droppedTombstones;
+    stats.micros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+    stats.cpuMicros += job.cpuMicros;
+}
 
-            std::cout << "[DEBUG] Processing key " << key1 << " from SST1 with value " << value << std::endl;
+std::vector<LevelCompactionStats> LSMTree::getCompactionStats() const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    std::vector<LevelCompactionStats> stats = compactionStats;
+    stats.resize(std::max(stats.size(), levels.size()));
+    return stats;
+}
 
-            if (!outputPage.addEntry(key1, value))
-            {
-                mergedSST->addPage(outputPage);
-                outputPage = Page();
-                outputPage.addEntry(key1, value);
-            }
+bool LSMTree::hasOlderData(size_t level) const
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    for (size_t i = level + 1; i < levels.size(); ++i)
+    {
+        if (!levels[i].empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-            keyIndex1++;
+bool LSMTree::hasOlderData(size_t level, int64_t start, int64_t end)
+{
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    for (size_t i = level + 1; i < levels.size(); ++i)
+    {
+        if (!getSSTFilesForRange(i, start, end).empty())
+        {
+            return true;
         }
-        else if (key1 > key2)
+    }
+    return false;
+}
+
+std::vector<std::pair<int64_t, int64_t>> LSMTree::getKeyRangesBelow(size_t level)
+{
+    std::vector<std::pair<int64_t, int64_t>> ranges;
+    for (size_t i = level + 1; i < levels.size(); ++i)
+    {
+        for (const auto &file : levels[i])
         {
-            if (keyIndex2 >= keys2.size())
-            {
-                break; // Or handle appropriately
-            }
+            std::shared_ptr<SSTReader> reader = openSSTReader(file);
+            ranges.push_back({reader->startingKey, reader->endingKey});
+        }
+    }
+    return ranges;
+}
 
-            int valueOffset = keys2[keyIndex2].valueOffset;
+void LSMTree::removeSSTFiles(size_t level, const std::vector<std::string> &files, VersionEdit &edit)
+{
+    std::vector<std::string> &levelFiles = levels[level];
+    for (const auto &file : files)
+    {
+        levelFiles.erase(std::remove(levelFiles.begin(), levelFiles.end(), file), levelFiles.end());
+        edit.deletedFiles.emplace_back(level, fileName(file));
+    }
+}
 
-            // Validate valueOffset within the page
-            if (valueOffset < 0 || static_cast<size_t>(valueOffset) + sizeof(int64_t) > PAGE_SIZE)
-            {
-                close(sst1_fd);
-                close(sst2_fd);
-                throw std::runtime_error("Invalid valueOffset in SST2.");
-            }
+void LSMTree::compactIntoLevel(size_t level, const std::vector<std::string> &files, TreeLock &lock)
+{
+    ensureLevelExists(level + 1);
+    size_t outputLevel = level + 1;
+
+    // Key range of the SSTs pushed down
+    int64_t smallest = INT64_MAX, largest = INT64_MIN;
+    for (const auto &file : files)
+    {
+        std::shared_ptr<SSTReader> reader = openSSTReader(file);
+        smallest = std::min(smallest, reader->startingKey);
+        largest = std::max(largest, reader->endingKey);
+    }
+
+    // Inputs that overlap neither each other nor the output level keep their
+    // place in key order there, so they are re-linked instead of rewritten
+    if (isTrivialMove(files, outputLevel))
+    {
+        moveToLevel(level, files);
+        return;
+    }
 
-            int64_t value;
-            std::memcpy(&value, buffer2 + valueOffset, sizeof(int64_t));
+    // Only the overlapping SSTs of the output level are rewritten. They are older
+    // than the SSTs pushed down, which are themselves ordered oldest first.
+    std::vector<std::string> overlapping = getSSTFilesForRange(outputLevel, smallest, largest);
+    std::vector<std::shared_ptr<SSTReader>> inputs;
+    for (const auto &file : overlapping)
+    {
+        inputs.push_back(openSSTReader(file));
+    }
+    for (const auto &file : files)
+    {
+        inputs.push_back(openSSTReader(file));
+    }
 
-            std::cout << "[DEBUG] Processing key " << key2 << " from SST2 with value " << value << std::endl;
+    CompactionOptions options;
+    options.pageFormat = pageFormat;
+    options.compression = getCompression(outputLevel);
+    options.blockSize = blockSize;
+    options.rateLimiter = &rateLimiter;
+    options.directIO = directIO;
+    options.dropTombstones = true; // Unless an SST below the output level may hold the key
+    options.olderKeyRanges = getKeyRangesBelow(outputLevel);
+    options.targetFileSize = targetFileSize;
+    options.maxSubcompactions = maxSubcompactions;
+    options.threadPool = compactionPool.get();
+
+    CompactionJob job(inputs, [this]()
+                      { return newSSTFilename(); }, options);
+    auto started = std::chrono::steady_clock::now();
+    lock.unlock();
+    std::vector<std::string> outputs = job.run();
+    inputs.clear();
+    lock.lock();
+    recordCompaction(outputLevel, job, files.size() + overlapping.size(), outputs.size(), started);
+
+    // Replace the inputs with the outputs, keeping the output level in key order
+    VersionEdit edit;
+    removeSSTFiles(level, files, edit);
+    removeSSTFiles(outputLevel, overlapping, edit);
+
+    std::vector<std::string> &outputFiles = levels[outputLevel];
+    outputFiles.insert(outputFiles.end(), outputs.begin(), outputs.end());
+    std::sort(outputFiles.begin(), outputFiles.end(), [this](const std::string &a, const std::string &b)
+              { return openSSTReader(a)->startingKey < openSSTReader(b)->startingKey; });
+    for (const auto &output : outputs)
+    {
+        edit.addedFiles.emplace_back(outputLevel, fileName(output));
+    }
+    installEdit(edit);
+}
 
-            if (!outputPage.addEntry(key2, value))
-            {
-                mergedSST->addPage(outputPage);
-                outputPage = Page();
-                outputPage.addEntry(key2, value);
-            }
+bool LSMTree::isTrivialMove(const std::vector<std::string> &files, size_t outputLevel)
+{
+    std::vector<std::shared_ptr<SSTReader>> readers;
+    for (const auto &file : files)
+    {
+        std::shared_ptr<SSTReader> reader = openSSTReader(file);
 
-            keyIndex2++;
+        // Moved SSTs keep their compression, which must be the output level's
+        if (reader->compression != getCompression(outputLevel) ||
+            !getSSTFilesForRange(outputLevel, reader->startingKey, reader->endingKey).empty())
+        {
+            return false;
         }
-        else
+
+        // Tombstones that nothing older lies under are dropped by rewriting the SST
+        if (reader->numTombstones > 0 && !hasOlderData(outputLevel, reader->startingKey, reader->endingKey))
         {
-            if (keyIndex1 >= keys1.size() || keyIndex2 >= keys2.size())
-            {
-                break; // Or handle appropriately
-            }
+            return false;
+        }
+        readers.push_back(reader);
+    }
 
-            // Retrieve values from both SSTs
-            int valueOffset2 = keys2[keyIndex2].valueOffset;
-            int64_t value2;
-            std::memcpy(&value2, buffer2 + valueOffset2, sizeof(int64_t));
+    std::sort(readers.begin(), readers.end(), [](const std::shared_ptr<SSTReader> &a, const std::shared_ptr<SSTReader> &b)
+              { return a->startingKey < b->startingKey; });
+    for (size_t i = 1; i < readers.size(); ++i)
+    {
+        if (readers[i - 1]->endingKey >= readers[i]->startingKey)
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-            std::cout << "[DEBUG] Processing duplicate key " << key1 << " from SST2 with value " << value2 << std::endl;
-            if (!isLargestLevel || (isLargestLevel && value2 != TOMBSTONE))
-            {
-                if (!outputPage.addEntry(key1, value2))
-                {
-                    mergedSST->addPage(outputPage);
-                    outputPage = Page();
-                    outputPage.addEntry(key1, value2);
-                }
-                // If value2 is TOMBSTONE and isLargestLevel, do not add the key
-            }
+void LSMTree::moveToLevel(size_t level, const std::vector<std::string> &files)
+{
+    ensureLevelExists(level + 1);
 
-            // Increment both indices
-            keyIndex1++;
-            keyIndex2++;
-        }
+    VersionEdit edit;
+    std::vector<std::string> &levelFiles = levels[level];
+    std::vector<std::string> &outputFiles = levels[level + 1];
+    for (const auto &file : files)
+    {
+        levelFiles.erase(std::remove(levelFiles.begin(), levelFiles.end(), file), levelFiles.end());
+        outputFiles.push_back(file);
+        edit.deletedFiles.emplace_back(level, fileName(file));
+        edit.addedFiles.emplace_back(level + 1, fileName(file));
     }
+    getLevelCompactionStats(level + 1).filesMoved += files.size();
+    if (isSortedLevel(level + 1))
+    {
+        std::sort(outputFiles.begin(), outputFiles.end(), [this](const std::string &a, const std::string &b)
+                  { return openSSTReader(a)->startingKey < openSSTReader(b)->startingKey; });
+    }
+    installEdit(edit);
+}
 
-    // Add the final page if it has entries
-    if (outputPage.numEntries > 0)
+void LSMTree::mergeLevel(size_t level, const std::vector<std::string> &inputFilenames, TreeLock &lock)
+{
+    // Ensure the next level exists before merging
+    ensureLevelExists(level + 1);
+
+    // Inputs are ordered from oldest to newest, as they were added to the level
+    std::vector<std::shared_ptr<SSTReader>> inputs;
+    for (const auto &filename : inputFilenames)
     {
-        mergedSST->addPage(outputPage);
+        inputs.push_back(openSSTReader(filename));
     }
 
-    // Close file descriptors
-    close(sst1_fd);
-    close(sst2_fd);
+    auto extractNumericSuffix = [](const std::string &filename) -> int
+    {
+        size_t start = filename.find_last_of('_') + 1;
+        size_t end = filename.find_last_of('.');
+        return std::stoi(filename.substr(start, end - start));
+    };
 
-    return mergedSST;
-}
\ No newline at end of file
+    // Name the output after the smallest and largest numeric suffixes of the inputs
+    int minSuffix = extractNumericSuffix(inputFilenames.front());
+    int maxSuffix = minSuffix;
+    for (const auto &filename : inputFilenames)
+    {
+        minSuffix = std::min(minSuffix, extractNumericSuffix(filename));
+        maxSuffix = std::max(maxSuffix, extractNumericSuffix(filename));
+    }
+    std::string merged_filename = db_name + "/sst_" + std::to_string(minSuffix) + "_" + std::to_string(maxSuffix) + ".sst";
+
+    CompactionOptions options;
+    options.pageFormat = pageFormat;
+    options.compression = getCompression(level + 1);
+    options.blockSize = blockSize;
+    options.rateLimiter = &rateLimiter;
+    options.directIO = directIO;
+    options.dropTombstones = true; // Unless an older run of the next level or an SST below it may hold the key
+    options.olderKeyRanges = getKeyRangesBelow(level);
+
+    // Stream the merged entries into the output SST
+    CompactionJob job(inputs, [&merged_filename]()
+                      { return merged_filename; }, options);
+    auto started = std::chrono::steady_clock::now();
+    lock.unlock();
+    bool wroteOutput = !job.run().empty();
+    inputs.clear();
+    lock.lock();
+    recordCompaction(level + 1, job, inputFilenames.size(), wroteOutput ? 1 : 0, started);
+
+    // Remove the old SSTs from the current level, then from disk once the edit is logged
+    VersionEdit edit;
+    removeSSTFiles(level, inputFilenames, edit);
+
+    // Add the merged SST to the next level as its newest run, unless every entry was a dropped tombstone
+    if (wroteOutput)
+    {
+        levels[level + 1].push_back(merged_filename);
+        getSSTReader(merged_filename);
+        edit.addedFiles.emplace_back(level + 1, fileName(merged_filename));
+    }
+    installEdit(edit);
+}
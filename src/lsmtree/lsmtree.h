@@ -5,20 +5,204 @@
 #include <string>
 #include <memory>
 #include <cstdint>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include "sst/sst.h"
+#include "sst/sstreader.h"
+#include "compactionpolicy.h"
+#include "manifest.h"
+#include "version.h"
+#include "threadpool.h"
 
+// Limits on compaction debt. Past a soft limit every write is delayed to
+// delayedWriteRate; past a hard limit writes stop until compaction catches up.
+struct WriteStallOptions
+{
+    size_t l0SlowdownFiles = 20;
+    size_t l0StopFiles = 36;
+    int64_t softPendingCompactionBytes = 64LL << 30;
+    int64_t hardPendingCompactionBytes = 256LL << 30;
+    int64_t delayedWriteRate = 16 << 20; // Bytes per second written while delayed
+};
+
+enum class WriteStallCondition
+{
+    Normal,
+    Delayed,
+    Stopped
+};
+
+// Outcome of a manual compaction of a key range
+struct CompactRangeStats
+{
+    size_t inputFiles = 0;
+    size_t outputFiles = 0;
+    size_t outputLevel = 0;
+    int64_t bytesRead = 0;
+    int64_t bytesWritten = 0;
+    int64_t droppedTombstones = 0;
+
+    // Shape of the tree afterwards: SSTs and bytes of every level
+    std::vector<size_t> levelFiles;
+    std::vector<int64_t> levelBytes;
+};
+
+// Cumulative counters of the compactions writing into one level
+struct LevelCompactionStats
+{
+    int64_t compactions = 0; // Merges whose output went to the level
+    int64_t filesMoved = 0;  // SSTs moved into the level without a rewrite
+    int64_t filesIn = 0;
+    int64_t filesOut = 0;
+    int64_t bytesRead = 0;
+    int64_t bytesWritten = 0;
+    int64_t entriesIn = 0;
+    int64_t entriesOverwritten = 0; // Versions hidden by a newer one of the same key
+    int64_t tombstonesDropped = 0;
+    int64_t micros = 0;    // Wall time of the merges
+    int64_t cpuMicros = 0; // CPU time of the threads that merged
+};
+
+// Writes held back by the write stall limits
+struct WriteStallStats
+{
+    int64_t delayedWrites = 0;
+    int64_t delayMicros = 0;
+    int64_t stoppedWrites = 0;
+    int64_t stopMicros = 0;
+};
+
+class CompactionJob;
+
+// The tree is safe to use from a foreground thread while a background thread
+// compacts it. Compactions pick and install their SSTs under the tree mutex
+// and read and write SSTs without it, so flushes are not blocked by
+// compaction I/O. Lookups do not take the mutex at all: they search the
+// current Version, which compactions replace rather than change.
 class LSMTree
 {
 public:
     explicit LSMTree(const std::string &db_name, size_t levelSizeRatio = 2);
 
+    // Stops the background compaction thread
+    ~LSMTree();
+
     void addSST(const std::string &sst_filename);                      // Add a new SST file to the tree (triggered by flush)
     void addSSTToLevel(const std::string &sst_filename, size_t level); // Used during restoration
+
+    // Restores the levels of a reopened tree, oldest SST of every level first
+    void restoreLevels(const std::vector<std::vector<std::string>> &files);
     void compact();                                                    // Perform compaction across levels
+
+    // Rewrites every SST overlapping [start, end] into the bottom level, the
+    // deepest non-empty level and at least level 1. The range is widened to the
+    // key ranges of the SSTs it picks up, so no SST left in place holds an
+    // older version of a key moved down. Compactions into a sorted bottom level
+    // are split into subcompactions; a tiered bottom level gets one new run.
+    CompactRangeStats compactRange(int64_t start, int64_t end);
+
+    // Compaction counters of every level since the tree was created
+    std::vector<LevelCompactionStats> getCompactionStats() const;
     std::vector<std::string> getSSTFilesByLevel(size_t level) const;
+    size_t getLevelFileCount(size_t level) const;
+
+    // Snapshot of the levels as of the last flush or compaction
+    std::shared_ptr<const Version> getCurrentVersion() const;
+
+    // SSTs of a level of the current version that may hold a key or overlap a range, newest first
+    std::vector<std::string> getSSTFilesForKey(size_t level, int64_t key) const;
+    std::vector<std::string> getSSTFilesForRange(size_t level, int64_t start, int64_t end) const;
+
+    // Total size of the SST files of a level in bytes
+    int64_t getLevelBytes(size_t level);
     size_t getNumLevels() const;
     void clearLevels();
 
+    // Records every later change to the levels and the persisted settings in
+    // the manifest, starting with a snapshot of the tree as it is now
+    void setManifest(std::unique_ptr<Manifest> manifest);
+
+    // Page format used for SSTs written by compaction
+    void setPageFormat(PageFormat format);
+
+    // Data block compression of SSTs written to levels at or below minLevel
+    void setCompression(CompressionType type, size_t minLevel = 0);
+    CompressionType getCompression(size_t level) const;
+
+    // Data page size of SSTs written by compaction
+    void setBlockSize(int size);
+
+    // Compaction policy; throws if the tree holds SSTs below level 0 that the
+    // new policy would read with a different level organization
+    void setCompactionStyle(CompactionStyle style);
+    CompactionStyle getCompactionStyle() const;
+
+    // Output file size of compactions into sorted levels, and the unit of their capacities
+    void setTargetFileSize(int64_t size);
+    int64_t getTargetFileSize() const;
+
+    // Size ratio and run limit of one level; zero fields use the tree-wide size ratio
+    void setLevelOptions(size_t level, LevelOptions options);
+    LevelOptions getLevelOptions(size_t level) const;
+    size_t getSizeRatio(size_t level) const;
+    size_t getMaxRuns(size_t level) const;
+    size_t getLevelSizeRatio() const;
+
+    // Runs compactions on a background thread instead of in addSST. Disabling
+    // waits for the running compaction; the remaining debt stays for later.
+    void setBackgroundCompaction(bool enabled);
+
+    // Maps the SSTs opened from now on into memory for the lifetime of their handles
+    void setMmapReads(bool enabled);
+
+    // Reads the SSTs opened from now on, and writes compaction outputs, with
+    // O_DIRECT; it takes precedence over mmap reads
+    void setDirectIO(bool enabled);
+
+    // Write stall limits, and the state they currently put writers in
+    void setWriteStallOptions(const WriteStallOptions &options);
+    WriteStallCondition getWriteStallCondition() const;
+    WriteStallStats getWriteStallStats() const;
+
+    // Estimated bytes compaction must rewrite to bring every level within its limits
+    int64_t getPendingCompactionBytes();
+
+    // Called before a write of `bytes`; delays or blocks it as the stall limits require
+    void throttleWrite(int64_t bytes);
+
+    // Byte capacity of a sorted level: the target file size times the size
+    // ratios of levels 1 through `level`
+    int64_t getMaxLevelBytes(size_t level) const;
+
+    // True if any SST below the level holds data; with a key range, only SSTs
+    // overlapping [start, end] count
+    bool hasOlderData(size_t level) const;
+    bool hasOlderData(size_t level, int64_t start, int64_t end);
+
+    // True if the SSTs of the level have disjoint key ranges and are ordered by key
+    bool isSortedLevel(size_t level) const;
+
+    // Number of key ranges a compaction into a sorted level merges in parallel
+    void setMaxSubcompactions(size_t count);
+
+    // Token bucket shared by flush and compaction I/O; unlimited by default
+    RateLimiter &getRateLimiter();
+
+    // Returns a new, unique SST file name; the counter is persisted by the store
+    std::string newSSTFilename();
+    uint64_t getFileCounter() const;
+    void setFileCounter(uint64_t counter);
+
+    // Returns the open handle of an SST file, loading it on first use
+    std::shared_ptr<SSTReader> getSSTReader(const std::string &sst_filename);
+
+    // Same as getSSTReader, but throws if the SST cannot be opened
+    std::shared_ptr<SSTReader> openSSTReader(const std::string &sst_filename);
+
     // helpers for testing
     void printLevels() const;
     void dumpSSTFile(const std::string &filename);
@@ -26,16 +210,81 @@ public:
 private:
     // Fixed parameters
     size_t levelSizeRatio; // Ratio between level sizes (default: 2)
+    std::vector<LevelOptions> levelOptions; // Per-level overrides of the size ratio
     std::string db_name;
+    PageFormat pageFormat = PageFormat::Packed;
+    bool mmapReads = false;
+    bool directIO = false;
+    CompressionType compression = CompressionType::None;
+    size_t compressionMinLevel = 0;
+    int blockSize = PAGE_SIZE;
+    std::unique_ptr<CompactionPolicy> policy;
+    int64_t targetFileSize = TARGET_FILE_SIZE;
+    uint64_t fileCounter = 0; // Number of the last SST file name handed out
+    size_t maxSubcompactions = 1;
+    std::unique_ptr<ThreadPool> compactionPool; // Runs subcompactions; one thread per range
+    RateLimiter rateLimiter;
 
     // LSM-tree structure
     std::vector<std::vector<std::string>> levels; // SSTables organized by levels (file names)
 
+    // Guards the levels, the open SST handles and the settings. It is recursive
+    // since compaction policies call back into the tree while a task is picked.
+    mutable std::recursive_mutex mutex;
+    std::mutex compactionMutex; // Held by the one compaction running at a time
+
+    // Background compaction
+    std::thread compactionThread;
+    std::mutex backgroundMutex;
+    std::condition_variable backgroundWork; // Signalled when a flush adds an SST or the thread stops
+    bool compactionRequested = false;
+    std::atomic<bool> stopBackground{false};
+
+    // Write stalls
+    WriteStallOptions writeStallOptions;
+    std::atomic<WriteStallCondition> writeStallCondition{WriteStallCondition::Normal};
+    WriteStallStats writeStallStats;
+    int64_t delayedBytes = 0; // Bytes written while delayed since the last sleep
+    std::mutex stallMutex;
+    std::condition_variable compactionProgress; // Signalled after every compaction
+
+    // Open SSTs keyed by file name; metadata and fence pointers are loaded once
+    std::unordered_map<std::string, std::shared_ptr<TableFile>> tableFiles;
+    std::shared_ptr<TableFile> getTableFile(const std::string &sst_filename); // Throws if the SST cannot be opened
+
+    // Loaded by readers without the tree mutex, stored under it
+    std::atomic<std::shared_ptr<const Version>> currentVersion;
+    void publishVersion(); // Installs a version of the levels as they are now
+
     // Helper Functions
     void ensureLevelExists(size_t level); // Dynamically add levels as needed
-    void mergeLevels(size_t level);       // Compact SSTables in a given level
-    std::shared_ptr<SST> mergeTwoSSTs(const std::string &sst1, const std::string &sst2,
-                                      bool isLargestLevel);
+    // Detaches SSTs from a level and records their deletion in an edit
+    void removeSSTFiles(size_t level, const std::vector<std::string> &files, VersionEdit &edit);
+
+    // Logs an edit made to the levels and publishes the new version. SSTs it
+    // dropped are deleted once no version holds them; crashing before leaves
+    // unreferenced SSTs, which the next open deletes.
+    void installEdit(VersionEdit &edit);
+    void logEdit(VersionEdit &edit);
+    VersionEdit makeSnapshot() const;
+    std::unique_ptr<Manifest> manifest; // Null while the tree is not persisted
+    std::vector<std::pair<int64_t, int64_t>> getKeyRangesBelow(size_t level); // Of every SST below the level
+
+    std::vector<LevelCompactionStats> compactionStats; // Indexed by output level
+    LevelCompactionStats &getLevelCompactionStats(size_t level);
+    void recordCompaction(size_t outputLevel, const CompactionJob &job, size_t filesIn, size_t filesOut,
+                          std::chrono::steady_clock::time_point started);
+
+    void backgroundCompactionLoop();
+    void updateWriteStallCondition(); // Recomputes the condition after the levels change
+
+    // Compactions picked by the policy; the lock on the tree mutex is released while SSTs are merged
+    using TreeLock = std::unique_lock<std::recursive_mutex>;
+    void runCompaction(const CompactionTask &task, TreeLock &lock);
+    void mergeLevel(size_t level, const std::vector<std::string> &files, TreeLock &lock);       // Into one new run of the next level
+    void compactIntoLevel(size_t level, const std::vector<std::string> &files, TreeLock &lock); // Into the sorted next level
+    void moveToLevel(size_t level, const std::vector<std::string> &files);      // Unchanged, to the next level
+    bool isTrivialMove(const std::vector<std::string> &files, size_t outputLevel); // True if moving keeps the output level sorted
 };
 
 #endif // LSMTREE_H
\ No newline at end of file
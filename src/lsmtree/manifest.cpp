@@ -0,0 +1,386 @@
+#include "manifest.h"
+#include "global/globals.h"
+#include "murmur3.h"
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+    // Every field of an edit is a tag followed by its value
+    enum Tag : uint8_t
+    {
+        TagFileCounter = 1,
+        TagCompactionStyle = 2,
+        TagSizeRatio = 3,
+        TagTargetFileSize = 4,
+        TagLevelOptions = 5, // Level, size ratio, max runs
+        TagDeletedFile = 6,  // Level, file name
+        TagAddedFile = 7     // Level, file name
+    };
+
+    constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t); // Payload size, checksum
+
+    void putInt64(std::string &buffer, int64_t value)
+    {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void putString(std::string &buffer, const std::string &value)
+    {
+        putInt64(buffer, static_cast<int64_t>(value.size()));
+        buffer.append(value);
+    }
+
+    // Reads the fields of a record, throwing if one runs past its end
+    class RecordReader
+    {
+    public:
+        RecordReader(const char *buffer, size_t size) : buffer(buffer), size(size) {}
+
+        bool done() const { return offset == size; }
+
+        uint8_t getTag()
+        {
+            require(1);
+            return static_cast<uint8_t>(buffer[offset++]);
+        }
+
+        int64_t getInt64()
+        {
+            int64_t value;
+            require(sizeof(value));
+            std::memcpy(&value, buffer + offset, sizeof(value));
+            offset += sizeof(value);
+            return value;
+        }
+
+        std::string getString()
+        {
+            int64_t length = getInt64();
+            if (length < 0)
+            {
+                throw std::runtime_error("Malformed manifest record: negative string length.");
+            }
+            require(length);
+            std::string value(buffer + offset, length);
+            offset += length;
+            return value;
+        }
+
+    private:
+        void require(size_t bytes)
+        {
+            if (bytes > size - offset)
+            {
+                throw std::runtime_error("Malformed manifest record: field runs past the record.");
+            }
+        }
+
+        const char *buffer;
+        size_t size;
+        size_t offset = 0;
+    };
+
+    uint32_t checksum(const char *data, size_t size)
+    {
+        uint32_t hash;
+        MurmurHash3_x86_32(data, static_cast<int>(size), 0, &hash);
+        return hash;
+    }
+
+    void writeAll(int fd, const std::string &data, const std::string &path)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            ssize_t result = write(fd, data.data() + written, data.size() - written);
+            if (result <= 0)
+            {
+                throw std::runtime_error("Failed to write manifest: " + path);
+            }
+            written += result;
+        }
+    }
+}
+
+void VersionEdit::encodeTo(std::string &buffer) const
+{
+    if (fileCounter)
+    {
+        buffer.push_back(TagFileCounter);
+        putInt64(buffer, static_cast<int64_t>(*fileCounter));
+    }
+    if (compactionStyle)
+    {
+        buffer.push_back(TagCompactionStyle);
+        putInt64(buffer, static_cast<int64_t>(*compactionStyle));
+    }
+    if (sizeRatio)
+    {
+        buffer.push_back(TagSizeRatio);
+        putInt64(buffer, static_cast<int64_t>(*sizeRatio));
+    }
+    if (targetFileSize)
+    {
+        buffer.push_back(TagTargetFileSize);
+        putInt64(buffer, *targetFileSize);
+    }
+    for (const auto &[level, options] : levelOptions)
+    {
+        buffer.push_back(TagLevelOptions);
+        putInt64(buffer, static_cast<int64_t>(level));
+        putInt64(buffer, static_cast<int64_t>(options.sizeRatio));
+        putInt64(buffer, static_cast<int64_t>(options.maxRuns));
+    }
+    for (const auto &[level, file] : deletedFiles)
+    {
+        buffer.push_back(TagDeletedFile);
+        putInt64(buffer, static_cast<int64_t>(level));
+        putString(buffer, file);
+    }
+    for (const auto &[level, file] : addedFiles)
+    {
+        buffer.push_back(TagAddedFile);
+        putInt64(buffer, static_cast<int64_t>(level));
+        putString(buffer, file);
+    }
+}
+
+void VersionEdit::decodeFrom(const char *buffer, size_t size)
+{
+    RecordReader reader(buffer, size);
+    while (!reader.done())
+    {
+        uint8_t tag = reader.getTag();
+        switch (tag)
+        {
+        case TagFileCounter:
+            fileCounter = static_cast<uint64_t>(reader.getInt64());
+            break;
+        case TagCompactionStyle:
+        {
+            int64_t style = reader.getInt64();
+            if (style < static_cast<int64_t>(CompactionStyle::Tiered) || style > static_cast<int64_t>(CompactionStyle::LazyLeveled))
+            {
+                throw std::runtime_error("Unknown compaction style in manifest: " + std::to_string(style));
+            }
+            compactionStyle = static_cast<CompactionStyle>(style);
+            break;
+        }
+        case TagSizeRatio:
+            sizeRatio = static_cast<size_t>(reader.getInt64());
+            break;
+        case TagTargetFileSize:
+            targetFileSize = reader.getInt64();
+            break;
+        case TagLevelOptions:
+        {
+            size_t level = static_cast<size_t>(reader.getInt64());
+            LevelOptions options;
+            options.sizeRatio = static_cast<size_t>(reader.getInt64());
+            options.maxRuns = static_cast<size_t>(reader.getInt64());
+            levelOptions.emplace_back(level, options);
+            break;
+        }
+        case TagDeletedFile:
+        case TagAddedFile:
+        {
+            size_t level = static_cast<size_t>(reader.getInt64());
+            std::string file = reader.getString();
+            (tag == TagDeletedFile ? deletedFiles : addedFiles).emplace_back(level, file);
+            break;
+        }
+        default:
+            throw std::runtime_error("Unknown manifest record field: " + std::to_string(tag));
+        }
+    }
+}
+
+void ManifestState::apply(const VersionEdit &edit)
+{
+    if (edit.fileCounter)
+    {
+        fileCounter = std::max(fileCounter, *edit.fileCounter);
+    }
+    if (edit.compactionStyle)
+    {
+        compactionStyle = edit.compactionStyle;
+    }
+    if (edit.sizeRatio)
+    {
+        sizeRatio = edit.sizeRatio;
+    }
+    if (edit.targetFileSize)
+    {
+        targetFileSize = edit.targetFileSize;
+    }
+    for (const auto &[level, options] : edit.levelOptions)
+    {
+        levelOptions.resize(std::max(levelOptions.size(), level + 1));
+        levelOptions[level] = options;
+    }
+
+    for (const auto &[level, file] : edit.deletedFiles)
+    {
+        if (level < levels.size())
+        {
+            std::vector<std::string> &files = levels[level];
+            files.erase(std::remove(files.begin(), files.end(), file), files.end());
+        }
+    }
+    for (const auto &[level, file] : edit.addedFiles)
+    {
+        levels.resize(std::max(levels.size(), level + 1));
+        levels[level].push_back(file);
+    }
+}
+
+Manifest::Manifest(const std::string &path) : path(path)
+{
+}
+
+Manifest::~Manifest()
+{
+    if (fd != -1)
+    {
+        close(fd);
+    }
+}
+
+bool Manifest::replay(const std::string &path, ManifestState &state)
+{
+    if (!std::filesystem::exists(path))
+    {
+        return false;
+    }
+
+    // The whole log is read at once; it holds one snapshot and a bounded number of edits
+    std::vector<char> log(std::filesystem::file_size(path));
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1 || pread(fd, log.data(), log.size(), 0) != (ssize_t)log.size())
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Failed to read manifest: " + path);
+    }
+    close(fd);
+
+    size_t offset = 0;
+    while (log.size() - offset >= RECORD_HEADER_SIZE)
+    {
+        uint32_t size, expected;
+        std::memcpy(&size, log.data() + offset, sizeof(size));
+        std::memcpy(&expected, log.data() + offset + sizeof(size), sizeof(expected));
+        const char *payload = log.data() + offset + RECORD_HEADER_SIZE;
+        size_t end = offset + RECORD_HEADER_SIZE + size;
+        if (end > log.size())
+        {
+            break; // Torn by a crash during the last append
+        }
+        if (checksum(payload, size) != expected)
+        {
+            if (end == log.size())
+            {
+                break; // The last append was only partly written
+            }
+            throw std::runtime_error("Manifest record at offset " + std::to_string(offset) + " is corrupt: " + path);
+        }
+
+        VersionEdit edit;
+        edit.decodeFrom(payload, size);
+        state.apply(edit);
+        offset = end;
+    }
+    return true;
+}
+
+void Manifest::writeRecord(int fd, const VersionEdit &edit)
+{
+    std::string payload;
+    edit.encodeTo(payload);
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    uint32_t hash = checksum(payload.data(), payload.size());
+
+    std::string record;
+    record.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    record.append(reinterpret_cast<const char *>(&hash), sizeof(hash));
+    record.append(payload);
+    writeAll(fd, record, path);
+}
+
+void Manifest::writeSnapshot(const VersionEdit &snapshot)
+{
+    // Write the snapshot beside the log and rename it into place, so the log
+    // is replaced atomically and a torn tail of the old log is dropped
+    std::string tempPath = path + ".tmp";
+    int tempFd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (tempFd == -1)
+    {
+        throw std::runtime_error("Failed to create manifest: " + tempPath);
+    }
+    try
+    {
+        writeRecord(tempFd, snapshot);
+        if (fsync(tempFd) != 0)
+        {
+            throw std::runtime_error("Failed to sync manifest: " + tempPath);
+        }
+    }
+    catch (...)
+    {
+        close(tempFd);
+        std::remove(tempPath.c_str());
+        throw;
+    }
+
+    if (fd != -1)
+    {
+        close(fd);
+    }
+    fd = tempFd;
+    std::filesystem::rename(tempPath, path);
+    syncDirectory(); // Persist the rename itself
+    editsSinceSnapshot = 0;
+}
+
+void Manifest::syncDirectory() const
+{
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dirFd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd == -1)
+    {
+        throw std::runtime_error("Failed to open database directory: " + directory);
+    }
+    int result = fsync(dirFd);
+    close(dirFd);
+    if (result != 0)
+    {
+        throw std::runtime_error("Failed to sync database directory: " + directory);
+    }
+}
+
+void Manifest::append(const VersionEdit &edit)
+{
+    if (fd == -1)
+    {
+        throw std::runtime_error("Manifest has no snapshot to append to: " + path);
+    }
+    writeRecord(fd, edit);
+    if (fdatasync(fd) != 0)
+    {
+        throw std::runtime_error("Failed to sync manifest: " + path);
+    }
+    ++editsSinceSnapshot;
+}
+
+bool Manifest::needsSnapshot() const
+{
+    return editsSinceSnapshot >= MANIFEST_SNAPSHOT_EDITS;
+}
@@ -0,0 +1,81 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "compactionpolicy.h"
+
+// A change to the tree recorded in the manifest. Unset settings are left as
+// they are; deleted files are removed from their level before added files are
+// appended to theirs, in order. File names are relative to the database directory.
+struct VersionEdit
+{
+    std::optional<uint64_t> fileCounter;
+    std::optional<CompactionStyle> compactionStyle;
+    std::optional<size_t> sizeRatio;
+    std::optional<int64_t> targetFileSize;
+    std::vector<std::pair<size_t, LevelOptions>> levelOptions;
+
+    std::vector<std::pair<size_t, std::string>> deletedFiles; // Level and file name
+    std::vector<std::pair<size_t, std::string>> addedFiles;
+
+    void encodeTo(std::string &buffer) const;
+    void decodeFrom(const char *buffer, size_t size); // Throws if the record is malformed
+};
+
+// The tree described by a replayed manifest
+struct ManifestState
+{
+    uint64_t fileCounter = 0;
+    std::optional<CompactionStyle> compactionStyle;
+    std::optional<size_t> sizeRatio;
+    std::optional<int64_t> targetFileSize;
+    std::vector<LevelOptions> levelOptions;
+    std::vector<std::vector<std::string>> levels; // File names of every level, in tree order
+
+    void apply(const VersionEdit &edit);
+};
+
+// Manifest is the append-only log of the version edits of a database. Each
+// record is its payload size, a MurmurHash3 checksum of the payload and the
+// encoded edit, synced to disk before the edit takes effect, so the level
+// layout survives a crash at any point. The first record is a snapshot of the
+// whole tree; once MANIFEST_SNAPSHOT_EDITS edits follow it, the log is
+// atomically replaced by a new snapshot. A torn record at the end of the log,
+// left by a crash during an append, ends the replay.
+class Manifest
+{
+public:
+    explicit Manifest(const std::string &path);
+    ~Manifest();
+
+    Manifest(const Manifest &) = delete;
+    Manifest &operator=(const Manifest &) = delete;
+
+    // Replays the manifest at `path` into `state`; returns false if there is none
+    static bool replay(const std::string &path, ManifestState &state);
+
+    // Replaces the log with a single snapshot edit; later edits are appended to it
+    void writeSnapshot(const VersionEdit &snapshot);
+
+    // Appends an edit and syncs it to disk
+    void append(const VersionEdit &edit);
+
+    // True once enough edits follow the snapshot that the log should be rewritten
+    bool needsSnapshot() const;
+
+    // Syncs the directory holding the manifest, so the SSTs created in it
+    // are found after a power loss
+    void syncDirectory() const;
+
+private:
+    void writeRecord(int fd, const VersionEdit &edit);
+
+    std::string path;
+    int fd = -1;
+    size_t editsSinceSnapshot = 0;
+};
+
+#endif // MANIFEST_H
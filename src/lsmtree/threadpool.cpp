@@ -0,0 +1,59 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t numThreads)
+{
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> result = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(packaged));
+    }
+    available.notify_one();
+    return result;
+}
+
+size_t ThreadPool::getNumThreads() const
+{
+    return workers.size();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]()
+                           { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return; // Stopping, and every queued task has run
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task(); // Exceptions are stored in the task's future
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+// ThreadPool runs tasks on a fixed set of worker threads. Tasks are started
+// in submission order; the future of a task reports its completion and
+// rethrows any exception it raised.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t numThreads);
+
+    // Finishes the queued tasks and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::future<void> submit(std::function<void()> task);
+
+    size_t getNumThreads() const;
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available; // Signalled when a task is queued or the pool stops
+    bool stopping = false;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,76 @@
+#include "version.h"
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+
+TableFile::TableFile(const std::string &filename, std::shared_ptr<SSTReader> reader)
+    : filename(filename), reader(std::move(reader))
+{
+}
+
+TableFile::~TableFile()
+{
+    if (obsolete && std::remove(filename.c_str()) != 0)
+    {
+        std::cerr << "Warning: Failed to delete file " << filename << std::endl;
+    }
+}
+
+void TableFile::markObsolete()
+{
+    obsolete = true;
+}
+
+Version::Version(std::vector<Level> levels, std::vector<bool> sortedLevels)
+    : levels(std::move(levels)), sortedLevels(std::move(sortedLevels))
+{
+}
+
+size_t Version::getNumLevels() const
+{
+    return levels.size();
+}
+
+const Version::Level &Version::getFiles(size_t level) const
+{
+    static const Level empty;
+    return level < levels.size() ? levels[level] : empty;
+}
+
+bool Version::isSortedLevel(size_t level) const
+{
+    return level < sortedLevels.size() && sortedLevels[level];
+}
+
+Version::Level Version::getFilesForKey(size_t level, int64_t key) const
+{
+    return getFilesForRange(level, key, key);
+}
+
+Version::Level Version::getFilesForRange(size_t level, int64_t start, int64_t end) const
+{
+    Level result;
+    const Level &files = getFiles(level);
+    if (isSortedLevel(level))
+    {
+        // The overlapping SSTs of a sorted level are consecutive; a key falls in at most one
+        auto it = std::lower_bound(files.begin(), files.end(), start,
+                                   [](const std::shared_ptr<TableFile> &file, int64_t target)
+                                   { return file->reader->endingKey < target; });
+        for (; it != files.end() && (*it)->reader->startingKey <= end; ++it)
+        {
+            result.push_back(*it);
+        }
+        return result;
+    }
+
+    // SSTs of an overlapping level are searched from the newest to the oldest
+    for (auto it = files.rbegin(); it != files.rend(); ++it)
+    {
+        if (end >= (*it)->reader->startingKey && start <= (*it)->reader->endingKey)
+        {
+            result.push_back(*it);
+        }
+    }
+    return result;
+}
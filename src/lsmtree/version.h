@@ -0,0 +1,61 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "sst/sstreader.h"
+
+// An SST of the tree with its open handle. Once the tree drops the SST it is
+// marked obsolete, and the file is deleted when the last version holding it
+// is released, so readers of older versions never find it missing.
+class TableFile
+{
+public:
+    TableFile(const std::string &filename, std::shared_ptr<SSTReader> reader);
+
+    // Deletes the file if it is obsolete
+    ~TableFile();
+
+    TableFile(const TableFile &) = delete;
+    TableFile &operator=(const TableFile &) = delete;
+
+    void markObsolete();
+
+    const std::string filename;
+    const std::shared_ptr<SSTReader> reader;
+
+private:
+    std::atomic<bool> obsolete{false};
+};
+
+// Version is an immutable snapshot of the levels of the tree. Every flush
+// and compaction installs a new version; readers take the current one with a
+// single atomic load and search it without the tree mutex, while the SSTs it
+// lists stay open and on disk for as long as they hold it.
+class Version
+{
+public:
+    using Level = std::vector<std::shared_ptr<TableFile>>; // Oldest first, or in key order if sorted
+
+    Version() = default;
+    Version(std::vector<Level> levels, std::vector<bool> sortedLevels);
+
+    size_t getNumLevels() const;
+    const Level &getFiles(size_t level) const;
+
+    // True if the SSTs of the level have disjoint key ranges and are ordered by key
+    bool isSortedLevel(size_t level) const;
+
+    // SSTs of a level that may hold a key or overlap a range, newest first
+    Level getFilesForKey(size_t level, int64_t key) const;
+    Level getFilesForRange(size_t level, int64_t start, int64_t end) const;
+
+private:
+    std::vector<Level> levels;
+    std::vector<bool> sortedLevels;
+};
+
+#endif // VERSION_H
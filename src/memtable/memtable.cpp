@@ -13,29 +13,31 @@ Node::Node(int64_t k, int64_t v)
 // AVLTree constructor
 AVLTree::AVLTree(int max_size) : root(nullptr), memtable_size(max_size), current_size(0) {}
 
+AVLTree::~AVLTree() = default; // Releasing the root frees every node no reader holds
+
 // Get the height of the node
-int AVLTree::height(Node *node)
+int AVLTree::height(const std::shared_ptr<Node> &node)
 {
     return node ? node->height : 0;
 }
 
 // Update the height of the node based on its children's heights
-int AVLTree::updateHeight(Node *node)
+int AVLTree::updateHeight(const std::shared_ptr<Node> &node)
 {
     return node ? 1 + std::max(height(node->left), height(node->right)) : 0;
 }
 
 // Calculate the balance factor of the node
-int AVLTree::balanceFactor(Node *node)
+int AVLTree::balanceFactor(const std::shared_ptr<Node> &node)
 {
     return node ? height(node->left) - height(node->right) : 0;
 }
 
 // Perform a right rotation
-Node *AVLTree::rotateRight(Node *y)
+std::shared_ptr<Node> AVLTree::rotateRight(std::shared_ptr<Node> y)
 {
-    Node *x = y->left;
-    Node *T2 = x->right;
+    std::shared_ptr<Node> x = y->left;
+    std::shared_ptr<Node> T2 = x->right;
 
     // Perform rotation
     x->right = y;
@@ -49,10 +51,10 @@ Node *AVLTree::rotateRight(Node *y)
 }
 
 // Perform a left rotation
-Node *AVLTree::rotateLeft(Node *x)
+std::shared_ptr<Node> AVLTree::rotateLeft(std::shared_ptr<Node> x)
 {
-    Node *y = x->right;
-    Node *T2 = y->left;
+    std::shared_ptr<Node> y = x->right;
+    std::shared_ptr<Node> T2 = y->left;
 
     // Perform rotation
     y->left = x;
@@ -66,7 +68,7 @@ Node *AVLTree::rotateLeft(Node *x)
 }
 
 // Balance the tree by performing rotations if needed
-Node *AVLTree::balance(Node *node)
+std::shared_ptr<Node> AVLTree::balance(std::shared_ptr<Node> node)
 {
     node->height = updateHeight(node);
     int balance = balanceFactor(node);
@@ -94,33 +96,49 @@ Node *AVLTree::balance(Node *node)
     return node; // Already balanced
 }
 
-// Insert a key-value pair and balance the tree
-Node *AVLTree::put(Node *node, int64_t key, int64_t value)
+// Insert a key-value pair and balance the tree. Every node on the path is
+// copied first; rotations only involve nodes on the path, so the published
+// tree is never changed. The copies share every subtree off the path.
+std::shared_ptr<Node> AVLTree::put(const std::shared_ptr<Node> &node, int64_t key, int64_t value)
 {
     if (!node)
-        return new Node(key, value);
+    {
+        return std::make_shared<Node>(key, value);
+    }
 
-    if (key < node->key)
+    std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+    if (key < copy->key)
     {
-        node->left = put(node->left, key, value);
+        copy->left = put(copy->left, key, value);
     }
-    else if (key > node->key)
+    else if (key > copy->key)
     {
-        node->right = put(node->right, key, value);
+        copy->right = put(copy->right, key, value);
     }
     else
     {
-        node->value = value; // Update the value if the key already exists
+        copy->value = value; // Update the value if the key already exists
     }
 
-    return balance(node);
+    return balance(std::move(copy));
 }
 
 // Public interface to insert a key-value pair
 void AVLTree::put(int64_t key, int64_t value)
 {
     current_size++;
-    root = put(root, key, value);
+    root.store(put(root.load(std::memory_order_relaxed), key, value), std::memory_order_release);
+}
+
+void AVLTree::put(const std::pair<int64_t, int64_t> *entries, size_t count)
+{
+    std::shared_ptr<Node> newRoot = root.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i)
+    {
+        newRoot = put(newRoot, entries[i].first, entries[i].second);
+    }
+    current_size += count;
+    root.store(std::move(newRoot), std::memory_order_release);
 }
 
 // Public interface to delete a key
@@ -136,18 +154,18 @@ int AVLTree::getCurrentSize() const
 }
 
 // Search for a key and return its value
-int64_t AVLTree::get(Node *node, int64_t key)
+int64_t AVLTree::get(const Node *node, int64_t key)
 {
     if (!node)
         return -1; // Using -1 as a sentinel for "Key not found"
 
     if (key < node->key)
     {
-        return get(node->left, key);
+        return get(node->left.get(), key);
     }
     else if (key > node->key)
     {
-        return get(node->right, key);
+        return get(node->right.get(), key);
     }
     else
     {
@@ -158,7 +176,9 @@ int64_t AVLTree::get(Node *node, int64_t key)
 // Public interface to search for a key
 int64_t AVLTree::get(int64_t key)
 {
-    int64_t value = get(root, key);
+    // The loaded root keeps every node under it alive until the lookup ends
+    std::shared_ptr<Node> snapshot = root.load(std::memory_order_acquire);
+    int64_t value = get(snapshot.get(), key);
     if (value == INT64_MIN)
     {
         return -1; // Return -1 if the key has been deleted
@@ -167,14 +187,14 @@ int64_t AVLTree::get(int64_t key)
 }
 
 // Recursive in-order traversal to collect key-value pairs within the given range
-void AVLTree::inOrderTraversal(Node *node, std::vector<std::pair<int64_t, int64_t>> &result, int64_t start, int64_t end)
+void AVLTree::inOrderTraversal(const Node *node, std::vector<std::pair<int64_t, int64_t>> &result, int64_t start, int64_t end)
 {
     if (!node)
         return;
 
     if (node->key > start)
     {
-        inOrderTraversal(node->left, result, start, end);
+        inOrderTraversal(node->left.get(), result, start, end);
     }
 
     if (node->key >= start && node->key <= end && node->value != INT64_MIN)
@@ -184,7 +204,7 @@ void AVLTree::inOrderTraversal(Node *node, std::vector<std::pair<int64_t, int64_
 
     if (node->key < end)
     {
-        inOrderTraversal(node->right, result, start, end);
+        inOrderTraversal(node->right.get(), result, start, end);
     }
 }
 
@@ -192,25 +212,14 @@ void AVLTree::inOrderTraversal(Node *node, std::vector<std::pair<int64_t, int64_
 std::vector<std::pair<int64_t, int64_t>> AVLTree::scan(int64_t start, int64_t end)
 {
     std::vector<std::pair<int64_t, int64_t>> memtableResult;
-    inOrderTraversal(root, memtableResult, start, end);
+    std::shared_ptr<Node> snapshot = root.load(std::memory_order_acquire);
+    inOrderTraversal(snapshot.get(), memtableResult, start, end);
 
     return memtableResult; // Only return results from the memtable
 }
 
 void AVLTree::clear()
 {
-    clearTree(root); // Helper function to recursively delete nodes
-    root = nullptr;
+    root.store(nullptr);
     current_size = 0;
-}
-
-// Helper function to recursively delete nodes in the tree
-void AVLTree::clearTree(Node *node)
-{
-    if (node)
-    {
-        clearTree(node->left);
-        clearTree(node->right);
-        delete node;
-    }
 }
\ No newline at end of file
@@ -2,51 +2,64 @@
 #define MEMTABLE_H
 
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <cstdint>
+#include <cstddef>
+#include <utility>
 
 // Node structure for AVL Tree
 struct Node
 {
     int64_t key;
     int64_t value;
-    Node *left;
-    Node *right;
+    std::shared_ptr<Node> left; // Shared with the trees of earlier puts
+    std::shared_ptr<Node> right;
     int height;
 
     Node(int64_t k, int64_t v); // Constructor updated to int64_t
 };
 
-// AVL Tree class that supports put and get operations
+// AVL Tree class that supports put and get operations. One writer may put
+// while any number of threads get and scan: a put never changes a node a
+// reader can reach, it copies the nodes on the path to the key and then
+// publishes the new root with one atomic store. Nodes are refcounted, so the
+// nodes a put replaced are freed as soon as the last reader holding an older
+// root lets go of it, and a tree holds about one node per key.
 class AVLTree
 {
 private:
-    Node *root;
-    int memtable_size; // Threshold for AVL tree size
-    int current_size;  // Current AVL tree size
+    std::atomic<std::shared_ptr<Node>> root;
+    int memtable_size;             // Threshold for AVL tree size
+    std::atomic<int> current_size; // Current AVL tree size
 
     // Helper functions for tree manipulation
-    int height(Node *node);
-    int updateHeight(Node *node);
-    int balanceFactor(Node *node);
-    Node *rotateRight(Node *y);
-    Node *rotateLeft(Node *x);
-    Node *balance(Node *node);
+    int height(const std::shared_ptr<Node> &node);
+    int updateHeight(const std::shared_ptr<Node> &node);
+    int balanceFactor(const std::shared_ptr<Node> &node);
+    std::shared_ptr<Node> rotateRight(std::shared_ptr<Node> y);
+    std::shared_ptr<Node> rotateLeft(std::shared_ptr<Node> x);
+    std::shared_ptr<Node> balance(std::shared_ptr<Node> node);
 
     // Recursive functions for put and get
-    Node *put(Node *node, int64_t key, int64_t value);
-    int64_t get(Node *node, int64_t key);
+    std::shared_ptr<Node> put(const std::shared_ptr<Node> &node, int64_t key, int64_t value);
+    int64_t get(const Node *node, int64_t key);
 
     // Recursive in-order traversal for scan
-    void inOrderTraversal(Node *node, std::vector<std::pair<int64_t, int64_t>> &result, int64_t start, int64_t end); // Updated to int64_t
-
-    // Recursive function to clear the tree after it is full
-    void clearTree(Node *node);
+    void inOrderTraversal(const Node *node, std::vector<std::pair<int64_t, int64_t>> &result, int64_t start, int64_t end); // Updated to int64_t
 
 public:
     AVLTree(int max_size); // Constructor
+    ~AVLTree();
+
+    AVLTree(const AVLTree &) = delete;
+    AVLTree &operator=(const AVLTree &) = delete;
 
     void put(int64_t key, int64_t value);
 
+    // Inserts the entries in order and publishes them with one root, so readers see all or none of them
+    void put(const std::pair<int64_t, int64_t> *entries, size_t count);
+
     void del(int64_t key);
 
     int64_t get(int64_t key);
@@ -54,7 +67,7 @@ public:
     // Scan method to get all key-value pairs in the range [start, end] or all by default
     std::vector<std::pair<int64_t, int64_t>> scan(int64_t start, int64_t end);
 
-    // Clear the AVL tree
+    // Clear the AVL tree; readers already in it keep seeing the old nodes
     void clear();
 
     // Get the current size of the AVL tree
@@ -1,15 +1,195 @@
 #include "page.h"
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#define PAGE_AVX2_UNPACKING
+#include <immintrin.h>
+#endif
 
-Page::Page() : data(PAGE_SIZE, 0)
+namespace
+{
+    // Unpacking loads whole 64-bit words, so packed pages keep spare bytes after the value column
+    constexpr size_t PACKED_COLUMN_SLACK = 8;
+
+    // Layout of the packed page header
+    constexpr size_t PACKED_TAG_OFFSET = sizeof(int) + sizeof(int64_t);
+    constexpr size_t PACKED_BITS_OFFSET = PACKED_TAG_OFFSET + sizeof(int);
+    constexpr size_t PACKED_VALUE_BASE_OFFSET = PACKED_BITS_OFFSET + 8;
+
+    int bitWidth(uint64_t delta)
+    {
+        return delta == 0 ? 0 : 64 - __builtin_clzll(delta);
+    }
+
+    size_t columnBytes(int count, int bits)
+    {
+        return (static_cast<size_t>(count) * bits + 7) / 8;
+    }
+
+    size_t packedPageSize(int count, int keyBits, int valueBits)
+    {
+        return PACKED_PAGE_HEADER_SIZE + columnBytes(count, keyBits) + columnBytes(count, valueBits) + PACKED_COLUMN_SLACK;
+    }
+
+    // Writes `delta` as the bits-wide integer at `index` of a zero-initialized column
+    void packAt(char *column, int bits, int index, uint64_t delta)
+    {
+        if (bits == 0)
+        {
+            return;
+        }
+        uint64_t bitPos = static_cast<uint64_t>(index) * bits;
+        char *p = column + (bitPos >> 3);
+        unsigned shift = bitPos & 7;
+
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        word |= delta << shift;
+        std::memcpy(p, &word, sizeof(word));
+
+        // Widths above 56 bits can spill into a ninth byte
+        if (shift + bits > 64)
+        {
+            p[8] |= static_cast<char>(delta >> (64 - shift));
+        }
+    }
+
+    // Reads the bits-wide integer at `index` of a column
+    uint64_t unpackAt(const char *column, int bits, int index)
+    {
+        if (bits == 0)
+        {
+            return 0;
+        }
+        uint64_t bitPos = static_cast<uint64_t>(index) * bits;
+        const char *p = column + (bitPos >> 3);
+        unsigned shift = bitPos & 7;
+
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        uint64_t delta = word >> shift;
+        if (shift + bits > 64)
+        {
+            delta |= static_cast<uint64_t>(static_cast<uint8_t>(p[8])) << (64 - shift);
+        }
+        return bits == 64 ? delta : delta & ((1ULL << bits) - 1);
+    }
+
+#ifdef PAGE_AVX2_UNPACKING
+    // Decodes four integers at a time: gathers the word holding each one, then shifts
+    // and masks it. A width of at most 56 bits always fits in the word loaded at its
+    // first byte. Returns how many integers were decoded; the caller finishes the rest.
+    __attribute__((target("avx2"))) int unpackRangeAVX2(const char *column, int bits, int first, int count, int64_t base, int64_t *out)
+    {
+        int i = 0;
+        if (bits == 0 || bits > 56)
+        {
+            return i;
+        }
+        const __m256i mask = _mm256_set1_epi64x((1LL << bits) - 1);
+        const __m256i frame = _mm256_set1_epi64x(base);
+        const __m256i width = _mm256_set1_epi64x(bits);
+        const __m256i seven = _mm256_set1_epi64x(7);
+        const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i index = _mm256_add_epi64(_mm256_set1_epi64x(first + i), lanes);
+            __m256i bitPos = _mm256_mul_epu32(index, width);
+            __m256i words = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(column),
+                                                   _mm256_srli_epi64(bitPos, 3), 1);
+            __m256i deltas = _mm256_and_si256(_mm256_srlv_epi64(words, _mm256_and_si256(bitPos, seven)), mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_add_epi64(deltas, frame));
+        }
+        return i;
+    }
+
+    // The AVX2 routine is compiled in regardless of the build flags and picked
+    // at run time, so the same binary runs on CPUs without AVX2
+    const bool cpuHasAVX2 = __builtin_cpu_supports("avx2");
+    bool vectorUnpacking = cpuHasAVX2;
+#else
+    const bool cpuHasAVX2 = false;
+    bool vectorUnpacking = false;
+#endif
+
+    // Decodes `count` integers starting at `first` and adds the frame of reference
+    void unpackRange(const char *column, int bits, int first, int count, int64_t base, int64_t *out)
+    {
+        int i = 0;
+#ifdef PAGE_AVX2_UNPACKING
+        if (vectorUnpacking)
+        {
+            i = unpackRangeAVX2(column, bits, first, count, base, out);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            out[i] = static_cast<int64_t>(static_cast<uint64_t>(base) + unpackAt(column, bits, first + i));
+        }
+    }
+
+    struct PackedView
+    {
+        int numEntries;
+        int64_t keyBase;
+        int keyBits;
+        int valueBits;
+        int64_t valueBase;
+        const char *keyColumn;
+        const char *valueColumn;
+
+        explicit PackedView(const char *buffer)
+        {
+            std::memcpy(&numEntries, buffer, sizeof(numEntries));
+            std::memcpy(&keyBase, buffer + sizeof(int), sizeof(keyBase));
+            keyBits = static_cast<uint8_t>(buffer[PACKED_BITS_OFFSET]);
+            valueBits = static_cast<uint8_t>(buffer[PACKED_BITS_OFFSET + 1]);
+            std::memcpy(&valueBase, buffer + PACKED_VALUE_BASE_OFFSET, sizeof(valueBase));
+            keyColumn = buffer + PACKED_PAGE_HEADER_SIZE;
+            valueColumn = keyColumn + columnBytes(numEntries, keyBits);
+        }
+
+        // Index of the first key not less than `key`
+        int lowerBound(int64_t key) const
+        {
+            if (key <= keyBase)
+            {
+                return 0;
+            }
+            uint64_t target = static_cast<uint64_t>(key) - static_cast<uint64_t>(keyBase);
+            int low = 0, high = numEntries;
+            while (low < high)
+            {
+                int mid = low + (high - low) / 2;
+                if (unpackAt(keyColumn, keyBits, mid) < target)
+                {
+                    low = mid + 1;
+                }
+                else
+                {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+    };
+}
+
+Page::Page(PageFormat format, int pageSize) : format(format), pageSize(pageSize), data(pageSize, 0)
 {
     int metadataSize = calculateMetadataSize();
-    freeSpace = PAGE_SIZE - metadataSize;
+    freeSpace = pageSize - metadataSize;
 }
 
 bool Page::addEntry(int64_t key, int64_t value)
 {
+    if (format == PageFormat::Packed)
+    {
+        return addPackedEntry(key, value);
+    }
+
     int entrySize = sizeof(key) + sizeof(int) + sizeof(value);
 
     if (entrySize > freeSpace)
@@ -22,7 +202,7 @@ bool Page::addEntry(int64_t key, int64_t value)
         startingKey = key;
     }
 
-    int valueOffset = PAGE_SIZE - sizeof(value) * (numEntries + 1);
+    int valueOffset = pageSize - sizeof(value) * (numEntries + 1);
 
     // Add the key-offset pair to the `keys` vector
     keys.push_back({key, valueOffset});
@@ -59,9 +239,74 @@ bool Page::addEntry(int64_t key, int64_t value)
        return true;
 }
 
+bool Page::addPackedEntry(int64_t key, int64_t value)
+{
+    // Keys arrive in ascending order, so the first key is the frame of reference
+    // and the newest key has the widest delta
+    int64_t keyBase = numEntries == 0 ? key : startingKey;
+    int64_t newMin = numEntries == 0 ? value : std::min(minValue, value);
+    int64_t newMax = numEntries == 0 ? value : std::max(maxValue, value);
+
+    int newKeyBits = std::max(keyBits, bitWidth(static_cast<uint64_t>(key) - static_cast<uint64_t>(keyBase)));
+    int newValueBits = bitWidth(static_cast<uint64_t>(newMax) - static_cast<uint64_t>(newMin));
+
+    size_t requiredSize = packedPageSize(numEntries + 1, newKeyBits, newValueBits);
+    if (requiredSize > static_cast<size_t>(pageSize))
+    {
+        return false; // Not enough space for this entry
+    }
+
+    startingKey = keyBase;
+    minValue = newMin;
+    maxValue = newMax;
+    keyBits = newKeyBits;
+    valueBits = newValueBits;
+
+    // Entries are serialized in bulk by finalize()
+    keys.push_back({key, -1});
+    values.push_back(value);
+    ++numEntries;
+    freeSpace = pageSize - static_cast<int>(requiredSize);
+
+    return true;
+}
+
+bool Page::setVectorUnpacking(bool enabled)
+{
+    vectorUnpacking = enabled && cpuHasAVX2;
+    return vectorUnpacking;
+}
+
+void Page::finalize()
+{
+    if (format != PageFormat::Packed)
+    {
+        return;
+    }
+
+    std::fill(data.begin(), data.end(), 0);
+
+    // Header: numEntries, key base, format tag, bit widths, value base
+    std::memcpy(&data[0], &numEntries, sizeof(numEntries));
+    std::memcpy(&data[sizeof(int)], &startingKey, sizeof(startingKey));
+    std::memcpy(&data[PACKED_TAG_OFFSET], &PACKED_PAGE_TAG_V1, sizeof(PACKED_PAGE_TAG_V1));
+    data[PACKED_BITS_OFFSET] = static_cast<char>(keyBits);
+    data[PACKED_BITS_OFFSET + 1] = static_cast<char>(valueBits);
+    std::memcpy(&data[PACKED_VALUE_BASE_OFFSET], &minValue, sizeof(minValue));
+
+    // Key column followed by the value column
+    char *keyColumn = &data[PACKED_PAGE_HEADER_SIZE];
+    char *valueColumn = keyColumn + columnBytes(numEntries, keyBits);
+    for (int i = 0; i < numEntries; ++i)
+    {
+        packAt(keyColumn, keyBits, i, static_cast<uint64_t>(keys[i].key) - static_cast<uint64_t>(startingKey));
+        packAt(valueColumn, valueBits, i, static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(minValue));
+    }
+}
+
 int64_t Page::readValueAtOffset(int valueOffset)
 {
-    if (valueOffset < 0 || valueOffset + sizeof(int64_t) > PAGE_SIZE)
+    if (valueOffset < 0 || valueOffset + sizeof(int64_t) > static_cast<size_t>(pageSize))
     {
         throw std::out_of_range("Invalid value offset in page");
     }
@@ -75,4 +320,135 @@ int64_t Page::readValueAtOffset(int valueOffset)
 int Page::calculateMetadataSize() const
 {
     return sizeof(numEntries) + sizeof(startingKey) + sizeof(int);
-}
\ No newline at end of file
+}
+
+int Page::readNumEntries(const char *buffer)
+{
+    int entries = 0;
+    std::memcpy(&entries, buffer, sizeof(entries));
+    return entries;
+}
+
+bool Page::isPacked(const char *buffer)
+{
+    int tag = 0;
+    std::memcpy(&tag, buffer + sizeof(int) + sizeof(int64_t), sizeof(tag));
+    return tag == PACKED_PAGE_TAG_V1;
+}
+
+int Page::readSlottedPageSize(const char *buffer)
+{
+    // The slots, values and free space of a slotted page add up to its size
+    int freeSpace = 0;
+    std::memcpy(&freeSpace, buffer + sizeof(int) + sizeof(int64_t), sizeof(freeSpace));
+    int entrySize = sizeof(int64_t) + sizeof(int) + sizeof(int64_t);
+    return sizeof(int) + sizeof(int64_t) + sizeof(int) + readNumEntries(buffer) * entrySize + freeSpace;
+}
+
+bool Page::search(const char *buffer, int64_t key, int64_t &value)
+{
+    if (isPacked(buffer))
+    {
+        PackedView page(buffer);
+        int index = page.lowerBound(key);
+        if (index == page.numEntries ||
+            static_cast<int64_t>(static_cast<uint64_t>(page.keyBase) + unpackAt(page.keyColumn, page.keyBits, index)) != key)
+        {
+            return false;
+        }
+        unpackRange(page.valueColumn, page.valueBits, index, 1, page.valueBase, &value);
+        return true;
+    }
+
+    // Binary search on the key-offset slots
+    size_t offset_in_page = sizeof(int) + sizeof(int64_t) + sizeof(int); // Skip metadata
+    size_t pageSize = readSlottedPageSize(buffer);
+    int low = 0, high = readNumEntries(buffer) - 1;
+    while (low <= high)
+    {
+        int mid = low + (high - low) / 2;
+        size_t key_offset_position = offset_in_page + mid * (sizeof(int64_t) + sizeof(int));
+
+        KeyOffset key_offset;
+        std::memcpy(&key_offset.key, buffer + key_offset_position, sizeof(int64_t));
+        std::memcpy(&key_offset.valueOffset, buffer + key_offset_position + sizeof(int64_t), sizeof(int));
+
+        if (key_offset.key == key)
+        {
+            if (key_offset.valueOffset < 0 || key_offset.valueOffset + sizeof(int64_t) > pageSize)
+            {
+                throw std::runtime_error("Invalid value offset in page.");
+            }
+            std::memcpy(&value, buffer + key_offset.valueOffset, sizeof(value));
+            return true;
+        }
+        else if (key_offset.key < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return false;
+}
+
+void Page::scan(const char *buffer, int64_t start, int64_t end, std::vector<std::pair<int64_t, int64_t>> &result)
+{
+    if (isPacked(buffer))
+    {
+        PackedView page(buffer);
+        int first = page.lowerBound(start);
+        int last = end == INT64_MAX ? page.numEntries : page.lowerBound(end + 1);
+        if (first >= last)
+        {
+            return;
+        }
+
+        // Decode both columns of the matching run
+        std::vector<int64_t> keyRun(last - first), valueRun(last - first);
+        unpackRange(page.keyColumn, page.keyBits, first, last - first, page.keyBase, keyRun.data());
+        unpackRange(page.valueColumn, page.valueBits, first, last - first, page.valueBase, valueRun.data());
+        for (int i = 0; i < last - first; ++i)
+        {
+            result.emplace_back(keyRun[i], valueRun[i]);
+        }
+        return;
+    }
+
+    // Range scan within the key-offset slots
+    size_t offset_in_page = sizeof(int) + sizeof(int64_t) + sizeof(int); // Skip metadata
+    size_t pageSize = readSlottedPageSize(buffer);
+    int page_num_entries = readNumEntries(buffer);
+    for (int i = 0; i < page_num_entries; ++i)
+    {
+        size_t key_offset_position = offset_in_page + i * (sizeof(int64_t) + sizeof(int));
+
+        KeyOffset key_offset;
+        std::memcpy(&key_offset.key, buffer + key_offset_position, sizeof(int64_t));
+        std::memcpy(&key_offset.valueOffset, buffer + key_offset_position + sizeof(int64_t), sizeof(int));
+
+        // If the current key exceeds the end of the range, stop scanning
+        if (key_offset.key > end)
+        {
+            return;
+        }
+
+        if (key_offset.key >= start)
+        {
+            if (key_offset.valueOffset < 0 || key_offset.valueOffset + sizeof(int64_t) > pageSize)
+            {
+                throw std::runtime_error("Invalid value offset in page.");
+            }
+            int64_t value;
+            std::memcpy(&value, buffer + key_offset.valueOffset, sizeof(value));
+            result.emplace_back(key_offset.key, value);
+        }
+    }
+}
+
+void Page::decode(const char *buffer, std::vector<std::pair<int64_t, int64_t>> &result)
+{
+    scan(buffer, INT64_MIN, INT64_MAX, result);
+}
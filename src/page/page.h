@@ -12,25 +12,59 @@ struct KeyOffset
     int valueOffset;
 };
 
+// On-disk layout of a page. Both formats share the numEntries and startingKey
+// header fields; the header word after them holds freeSpace for slotted pages
+// and a negative format tag for packed pages.
+enum class PageFormat
+{
+    Slotted, // Key-offset slots growing forward, values growing backward
+    Packed   // Frame-of-reference bit-packed key column and value column
+};
+
 class Page
 {
 public:
-    Page();
+    Page(PageFormat format = PageFormat::Slotted, int pageSize = PAGE_SIZE);
 
     // Methods
     bool addEntry(int64_t key, int64_t value);
     int64_t readValueAtOffset(int valueOffset);
 
+    // Serializes entries buffered by a packed page into `data`; no-op for slotted pages
+    void finalize();
+
+    // Helpers for reading serialized pages of either format
+    static int readNumEntries(const char *buffer);
+    static bool isPacked(const char *buffer);
+    static int readSlottedPageSize(const char *buffer);
+    static bool search(const char *buffer, int64_t key, int64_t &value);
+    static void scan(const char *buffer, int64_t start, int64_t end, std::vector<std::pair<int64_t, int64_t>> &result);
+    static void decode(const char *buffer, std::vector<std::pair<int64_t, int64_t>> &result);
+
+    // Decodes packed pages with AVX2 where the CPU supports it (the default) or with
+    // the scalar loop; returns whether AVX2 is used. Set it while no page is read.
+    static bool setVectorUnpacking(bool enabled);
+
     // Params
+    PageFormat format;       // Layout used when serializing this page
+    int pageSize;            // Size of the serialized page (the SST block size)
     int numEntries = 0;      // Number of key-value pairs
     int64_t startingKey = 0; // Starting key for the page
     int freeSpace;           // Available space in the page
 
     std::vector<KeyOffset> keys; // Vector of keys and offsets within the page
+    std::vector<int64_t> values; // Values of a packed page, in key order
     std::vector<char> data;      // Raw data representing the page contents
 
 private:
     int calculateMetadataSize() const; // Calculates and returns the metadata size
+    bool addPackedEntry(int64_t key, int64_t value);
+
+    // Frame of reference of a packed page
+    int keyBits = 0;
+    int valueBits = 0;
+    int64_t minValue = 0;
+    int64_t maxValue = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
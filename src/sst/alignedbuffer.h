@@ -0,0 +1,80 @@
+#ifndef ALIGNEDBUFFER_H
+#define ALIGNEDBUFFER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <sys/types.h>
+#include "global/globals.h"
+
+// Rounds a file offset or size down or up to a multiple of DIRECT_IO_ALIGNMENT
+inline off_t alignDown(off_t value)
+{
+    return value - value % static_cast<off_t>(DIRECT_IO_ALIGNMENT);
+}
+
+inline off_t alignUp(off_t value)
+{
+    return alignDown(value + static_cast<off_t>(DIRECT_IO_ALIGNMENT) - 1);
+}
+
+// True if an O_DIRECT read of `size` bytes at `offset` may land at `address` in place
+inline bool isDirectAligned(const void *address, off_t offset, size_t size)
+{
+    return reinterpret_cast<uintptr_t>(address) % DIRECT_IO_ALIGNMENT == 0 &&
+           offset % static_cast<off_t>(DIRECT_IO_ALIGNMENT) == 0 && size % DIRECT_IO_ALIGNMENT == 0;
+}
+
+// AlignedBuffer is a heap buffer whose address and size are multiples of
+// DIRECT_IO_ALIGNMENT, as O_DIRECT reads and writes require
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() = default;
+
+    // Allocates at least `size` zeroed bytes
+    explicit AlignedBuffer(size_t size) : length(alignUp(size))
+    {
+        if (length > 0)
+        {
+            buffer = static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, length));
+            if (!buffer)
+            {
+                throw std::bad_alloc();
+            }
+            std::memset(buffer, 0, length);
+        }
+    }
+
+    AlignedBuffer(AlignedBuffer &&other) noexcept
+        : buffer(std::exchange(other.buffer, nullptr)), length(std::exchange(other.length, 0))
+    {
+    }
+
+    AlignedBuffer &operator=(AlignedBuffer &&other) noexcept
+    {
+        std::swap(buffer, other.buffer);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    AlignedBuffer(const AlignedBuffer &) = delete;
+    AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+
+    ~AlignedBuffer()
+    {
+        std::free(buffer);
+    }
+
+    char *data() { return buffer; }
+    const char *data() const { return buffer; }
+    size_t size() const { return length; }
+
+private:
+    char *buffer = nullptr;
+    size_t length = 0;
+};
+
+#endif // ALIGNEDBUFFER_H
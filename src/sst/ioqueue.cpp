@@ -0,0 +1,328 @@
+#include "ioqueue.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    int ioUringSetup(unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    // The kernel reads the submission tail and writes the completion tail concurrently
+    unsigned loadAcquire(const unsigned *p)
+    {
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    }
+
+    void storeRelease(unsigned *p, unsigned value)
+    {
+        __atomic_store_n(p, value, __ATOMIC_RELEASE);
+    }
+
+    // Reads the rest of a request after a short read, or all of it without
+    // io_uring. A read failing after some progress, like an O_DIRECT read
+    // resumed off alignment at the end of the file, reports the bytes read.
+    void completeWithPread(ReadRequest &request)
+    {
+        size_t done = request.result > 0 ? request.result : 0;
+        while (done < request.size)
+        {
+            ssize_t n = pread(request.fd, request.buffer + done, request.size - done, request.offset + done);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0)
+            {
+                request.result = done > 0 ? static_cast<ssize_t>(done) : -errno;
+                return;
+            }
+            if (n == 0)
+            {
+                break; // End of file
+            }
+            done += n;
+        }
+        request.result = done;
+    }
+}
+
+IOQueue::IOQueue(unsigned depth, bool useIOUring)
+{
+    if (useIOUring && !setup(depth))
+    {
+        ringFd = -1; // Fall back to pread
+    }
+}
+
+IOQueue::~IOQueue()
+{
+    if (sqes)
+    {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing && cqRing != sqRing)
+    {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing)
+    {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd != -1)
+    {
+        close(ringFd);
+    }
+}
+
+IOQueue &IOQueue::forThread()
+{
+    thread_local IOQueue queue;
+    return queue;
+}
+
+bool IOQueue::usesIOUring() const
+{
+    return ringFd != -1;
+}
+
+bool IOQueue::setup(unsigned depth)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd = ioUringSetup(depth, &params);
+    if (ringFd < 0)
+    {
+        ringFd = -1;
+        return false;
+    }
+    entries = params.sq_entries;
+
+    // Both rings share one mapping on kernels with IORING_FEAT_SINGLE_MMAP
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+    {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED)
+    {
+        sqRing = nullptr;
+        close(ringFd);
+        return false;
+    }
+    cqRing = singleMmap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = cqRing == MAP_FAILED ? MAP_FAILED : mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (cqRing == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+        {
+            munmap(cqRing, cqRingSize);
+        }
+        munmap(sqRing, sqRingSize);
+        sqRing = cqRing = sqes = nullptr;
+        close(ringFd);
+        return false;
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cqRing);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+void IOQueue::readAll(std::vector<ReadRequest> &requests)
+{
+    if (!usesIOUring())
+    {
+        for (auto &request : requests)
+        {
+            request.result = 0;
+            completeWithPread(request);
+        }
+        return;
+    }
+
+    // At most a ring's worth of reads is in flight at once
+    for (size_t first = 0; first < requests.size(); first += entries)
+    {
+        submitAndWait(requests, first, std::min<size_t>(entries, requests.size() - first));
+    }
+    for (auto &request : requests)
+    {
+        if (request.result >= 0 && static_cast<size_t>(request.result) < request.size)
+        {
+            completeWithPread(request);
+        }
+    }
+}
+
+void IOQueue::submitAndWait(std::vector<ReadRequest> &requests, size_t first, size_t count)
+{
+    io_uring_sqe *ring = static_cast<io_uring_sqe *>(sqes);
+    unsigned tail = *sqTail; // Only this thread advances the submission tail
+    for (size_t i = 0; i < count; ++i)
+    {
+        ReadRequest &request = requests[first + i];
+        unsigned index = tail & *sqMask;
+        io_uring_sqe &sqe = ring[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = request.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(request.buffer);
+        sqe.len = static_cast<uint32_t>(request.size);
+        sqe.off = static_cast<uint64_t>(request.offset);
+        sqe.user_data = first + i;
+        sqArray[index] = index;
+        ++tail;
+    }
+    storeRelease(sqTail, tail);
+
+    size_t submitted = 0, completed = 0;
+    while (completed < count)
+    {
+        int result = ioUringEnter(ringFd, count - submitted, 1, IORING_ENTER_GETEVENTS);
+        if (result < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+                continue;
+            }
+            // The ring failed; the reads not yet completed are done with pread
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (requests[first + i].result == 0)
+                {
+                    completeWithPread(requests[first + i]);
+                }
+            }
+            return;
+        }
+        submitted += result;
+
+        io_uring_cqe *completions = static_cast<io_uring_cqe *>(cqes);
+        unsigned head = *cqHead;
+        unsigned end = loadAcquire(cqTail);
+        for (; head != end; ++head, ++completed)
+        {
+            const io_uring_cqe &cqe = completions[head & *cqMask];
+            requests[cqe.user_data].result = cqe.res;
+        }
+        storeRelease(cqHead, head);
+    }
+}
+
+bool IOQueue::submit(ReadRequest *request)
+{
+    if (!usesIOUring())
+    {
+        request->result = 0;
+        completeWithPread(*request);
+        readWithPread.push_back(request);
+        ++inFlight;
+        return true;
+    }
+    if (inFlight == entries)
+    {
+        return false;
+    }
+
+    io_uring_sqe *ring = static_cast<io_uring_sqe *>(sqes);
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe &sqe = ring[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = request->fd;
+    sqe.addr = reinterpret_cast<uint64_t>(request->buffer);
+    sqe.len = static_cast<uint32_t>(request->size);
+    sqe.off = static_cast<uint64_t>(request->offset);
+    sqe.user_data = reinterpret_cast<uint64_t>(request);
+    sqArray[index] = index;
+    storeRelease(sqTail, tail + 1);
+    ++unsubmitted;
+    ++inFlight;
+    return true;
+}
+
+void IOQueue::reap(std::vector<ReadRequest *> &completed, bool wait)
+{
+    if (!usesIOUring())
+    {
+        completed.insert(completed.end(), readWithPread.begin(), readWithPread.end());
+        inFlight -= readWithPread.size();
+        readWithPread.clear();
+        return;
+    }
+
+    size_t first = completed.size();
+
+    // Pass the queued reads to the kernel, waiting for a completion only if
+    // none is ready yet
+    bool ready = *cqHead != loadAcquire(cqTail);
+    unsigned minComplete = wait && inFlight > 0 && !ready ? 1 : 0;
+    while (unsubmitted > 0 || minComplete > 0)
+    {
+        int result = ioUringEnter(ringFd, unsubmitted, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0);
+        if (result < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+                continue;
+            }
+            throw std::runtime_error("Failed to submit reads to io_uring: " + std::string(std::strerror(errno)));
+        }
+        unsubmitted -= result;
+        minComplete = 0;
+    }
+
+    io_uring_cqe *completions = static_cast<io_uring_cqe *>(cqes);
+    unsigned head = *cqHead;
+    unsigned end = loadAcquire(cqTail);
+    for (; head != end; ++head)
+    {
+        const io_uring_cqe &cqe = completions[head & *cqMask];
+        ReadRequest *request = reinterpret_cast<ReadRequest *>(cqe.user_data);
+        request->result = cqe.res;
+        completed.push_back(request);
+        --inFlight;
+    }
+    storeRelease(cqHead, head);
+
+    for (size_t i = first; i < completed.size(); ++i)
+    {
+        ReadRequest *request = completed[i];
+        if (request->result >= 0 && static_cast<size_t>(request->result) < request->size)
+        {
+            completeWithPread(*request);
+        }
+    }
+}
+
+size_t IOQueue::getInFlight() const
+{
+    return inFlight;
+}
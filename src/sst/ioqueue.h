@@ -0,0 +1,85 @@
+#ifndef IOQUEUE_H
+#define IOQUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+#include "global/globals.h"
+
+// One positional read issued through an IOQueue
+struct ReadRequest
+{
+    int fd;
+    char *buffer;
+    size_t size;
+    off_t offset;
+    ssize_t result = 0; // Bytes read, or -errno
+};
+
+// IOQueue issues independent reads together so the device works on them in
+// parallel instead of one after another. It drives an io_uring set up with
+// the raw system calls, keeping up to IO_QUEUE_DEPTH reads in flight, and
+// falls back to one pread at a time where io_uring is unavailable (old
+// kernels, seccomp filters). A queue belongs to one thread; forThread
+// returns the calling thread's queue. A queue either performs whole batches
+// with readAll, or starts reads with submit and collects them with reap.
+class IOQueue
+{
+public:
+    explicit IOQueue(unsigned depth = IO_QUEUE_DEPTH, bool useIOUring = true);
+    ~IOQueue();
+
+    IOQueue(const IOQueue &) = delete;
+    IOQueue &operator=(const IOQueue &) = delete;
+
+    static IOQueue &forThread();
+
+    // True if reads go through io_uring rather than the pread fallback
+    bool usesIOUring() const;
+
+    // Performs every read and returns once all have completed. Short reads are
+    // completed with pread, so a request only falls short at the end of the file.
+    void readAll(std::vector<ReadRequest> &requests);
+
+    // Starts a read without waiting for it; returns false while IO_QUEUE_DEPTH
+    // reads are in flight. The request must stay valid until it is reaped.
+    bool submit(ReadRequest *request);
+
+    // Appends the reads started with submit that have completed, waiting for
+    // at least one if `wait` is set and any are in flight
+    void reap(std::vector<ReadRequest *> &completed, bool wait);
+
+    // Reads started with submit and not yet reaped
+    size_t getInFlight() const;
+
+private:
+    bool setup(unsigned depth);
+    void submitAndWait(std::vector<ReadRequest> &requests, size_t first, size_t count);
+
+    int ringFd = -1;
+    unsigned entries = 0;
+
+    unsigned unsubmitted = 0;                 // Reads queued by submit, not yet passed to the kernel
+    size_t inFlight = 0;                      // Reads started with submit, not yet reaped
+    std::vector<ReadRequest *> readWithPread; // Completed by submit without io_uring
+
+    // Shared ring memory mapped from the kernel
+    void *sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void *cqRing = nullptr;
+    size_t cqRingSize = 0;
+    void *sqes = nullptr;
+    size_t sqesSize = 0;
+
+    // Fields of the rings, located by the offsets io_uring_setup reports
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    void *cqes = nullptr;
+};
+
+#endif // IOQUEUE_H
@@ -0,0 +1,144 @@
+#include "ratelimiter.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr double BURST_SECONDS = 0.1;            // Bucket capacity, in seconds of the rate
+    constexpr auto LOW_PRIORITY_RECHECK = std::chrono::milliseconds(10);
+    constexpr auto TUNE_INTERVAL = std::chrono::milliseconds(100);
+    constexpr double RECENT_WEIGHT = 0.2;            // Weight of a sample in the fast average
+    constexpr double BASELINE_WEIGHT = 0.01;         // Weight of a sample in the slow average
+    constexpr double SLOWDOWN_THRESHOLD = 2.0;       // Back off once latency doubles
+    constexpr double RECOVERY_THRESHOLD = 1.2;       // Speed up once latency is near the baseline
+    constexpr double BACKOFF_FACTOR = 0.7;
+    constexpr double RECOVERY_FACTOR = 1.1;
+}
+
+RateLimiter::RateLimiter(int64_t bytesPerSecond)
+    : maxBytesPerSecond(bytesPerSecond), bytesPerSecond(bytesPerSecond),
+      lastRefill(Clock::now()), lastTune(Clock::now())
+{
+}
+
+void RateLimiter::refill(Clock::time_point now)
+{
+    double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+    lastRefill = now;
+    tokens = std::min(tokens + elapsed * bytesPerSecond, bytesPerSecond * BURST_SECONDS);
+}
+
+void RateLimiter::request(int64_t bytes, IOPriority priority)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    RateLimiterStats &stat = stats[static_cast<int>(priority)];
+    stat.bytes += bytes;
+    stat.requests++;
+    if (bytesPerSecond <= 0)
+    {
+        return; // Unlimited
+    }
+
+    Clock::time_point start = Clock::now();
+    bool high = priority == IOPriority::High;
+    if (high)
+    {
+        highPriorityWaiters++;
+    }
+
+    while (true)
+    {
+        Clock::time_point now = Clock::now();
+        refill(now);
+        if (!high && highPriorityWaiters > 0)
+        {
+            // Flushes take the tokens first
+            released.wait_for(lock, LOW_PRIORITY_RECHECK);
+            continue;
+        }
+        if (tokens >= 0 || bytesPerSecond <= 0)
+        {
+            break;
+        }
+        // Sleep until the debt of earlier requests is repaid
+        auto wait = std::chrono::duration<double>(-tokens / bytesPerSecond);
+        released.wait_for(lock, std::chrono::duration_cast<Clock::duration>(wait));
+    }
+    tokens -= bytes;
+
+    if (high)
+    {
+        highPriorityWaiters--;
+        released.notify_all();
+    }
+    stat.throttledMicros += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+void RateLimiter::setBytesPerSecond(int64_t rate)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    maxBytesPerSecond = rate;
+    bytesPerSecond = autoTune ? std::min(std::max(bytesPerSecond, minBytesPerSecond), rate) : rate;
+    released.notify_all();
+}
+
+int64_t RateLimiter::getBytesPerSecond() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesPerSecond;
+}
+
+void RateLimiter::setAutoTune(bool enabled, int64_t minRate)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    autoTune = enabled;
+    minBytesPerSecond = std::min(minRate, maxBytesPerSecond);
+    if (!enabled)
+    {
+        bytesPerSecond = maxBytesPerSecond;
+    }
+}
+
+void RateLimiter::recordForegroundLatency(std::chrono::microseconds latency)
+{
+    // Concurrent readers do not queue up on the limiter: a sample arriving
+    // while another is recorded, or while I/O takes tokens, is dropped
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+    double sample = static_cast<double>(latency.count());
+    if (baselineLatency == 0)
+    {
+        recentLatency = baselineLatency = sample;
+    }
+    recentLatency += RECENT_WEIGHT * (sample - recentLatency);
+    baselineLatency += BASELINE_WEIGHT * (sample - baselineLatency);
+
+    Clock::time_point now = Clock::now();
+    if (autoTune && maxBytesPerSecond > 0 && now - lastTune >= TUNE_INTERVAL)
+    {
+        tune(now);
+    }
+}
+
+void RateLimiter::tune(Clock::time_point now)
+{
+    lastTune = now;
+    refill(now);
+    if (recentLatency > SLOWDOWN_THRESHOLD * baselineLatency)
+    {
+        bytesPerSecond = std::max<int64_t>(minBytesPerSecond, bytesPerSecond * BACKOFF_FACTOR);
+    }
+    else if (recentLatency < RECOVERY_THRESHOLD * baselineLatency)
+    {
+        bytesPerSecond = std::min<int64_t>(maxBytesPerSecond, bytesPerSecond * RECOVERY_FACTOR + 1);
+    }
+}
+
+RateLimiterStats RateLimiter::getStats(IOPriority priority) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats[static_cast<int>(priority)];
+}
@@ -0,0 +1,80 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Priority of background I/O charged to a RateLimiter
+enum class IOPriority
+{
+    Low,  // Compaction
+    High, // Memtable flush; always served before waiting low-priority requests
+    Count
+};
+
+// Throttling statistics of one priority
+struct RateLimiterStats
+{
+    int64_t bytes = 0;          // Bytes granted
+    int64_t requests = 0;       // Requests granted
+    int64_t throttledMicros = 0; // Time requests spent waiting for tokens
+};
+
+// RateLimiter is a token bucket shared by the flush and compaction I/O of a
+// tree. Tokens (bytes) refill continuously at bytesPerSecond, up to a burst of
+// a tenth of a second. A request may overdraw the bucket, and later requests
+// wait until the debt is repaid, so large sequential reads and writes keep
+// their size while the average rate holds. High-priority requests go first.
+//
+// In auto-tuned mode the rate moves between a floor and the configured rate:
+// it is cut when foreground read latency rises well above its long-run
+// baseline and raised again once latency recovers.
+class RateLimiter
+{
+public:
+    // A rate of 0 disables throttling
+    explicit RateLimiter(int64_t bytesPerSecond = 0);
+
+    // Blocks until `bytes` may be read or written at the given priority
+    void request(int64_t bytes, IOPriority priority);
+
+    // Changes the rate at runtime; in auto-tuned mode this is the upper bound
+    void setBytesPerSecond(int64_t bytesPerSecond);
+    int64_t getBytesPerSecond() const; // Current rate, which auto-tuning may have lowered
+
+    // Enables auto-tuning between minBytesPerSecond and the configured rate
+    void setAutoTune(bool enabled, int64_t minBytesPerSecond);
+
+    // Reports the latency of one foreground read from disk, the auto-tuning
+    // signal. Never blocks; samples are dropped while the limiter is busy.
+    void recordForegroundLatency(std::chrono::microseconds latency);
+
+    RateLimiterStats getStats(IOPriority priority) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void refill(Clock::time_point now); // Adds the tokens earned since the last refill
+    void tune(Clock::time_point now);   // Adjusts the rate from the latency averages
+
+    mutable std::mutex mutex;
+    std::condition_variable released; // Signalled when a high-priority request leaves
+
+    int64_t maxBytesPerSecond;
+    int64_t bytesPerSecond;
+    double tokens = 0;
+    Clock::time_point lastRefill;
+    int highPriorityWaiters = 0;
+
+    bool autoTune = false;
+    int64_t minBytesPerSecond = 0;
+    double recentLatency = 0;   // Fast moving average of foreground latency, in microseconds
+    double baselineLatency = 0; // Slow moving average of foreground latency, in microseconds
+    Clock::time_point lastTune;
+
+    RateLimiterStats stats[static_cast<int>(IOPriority::Count)];
+};
+
+#endif // RATELIMITER_H
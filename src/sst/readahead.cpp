@@ -0,0 +1,48 @@
+#include "readahead.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+ReadAhead::ReadAhead(int fd, off_t limit, size_t maxWindow, const char *mapping)
+    : fd(fd), limit(limit), maxWindow(maxWindow), mapping(mapping)
+{
+}
+
+void ReadAhead::onRead(off_t offset, size_t size)
+{
+    off_t readEnd = offset + static_cast<off_t>(size);
+    bool sequential = offset == expected;
+    expected = readEnd;
+    if (!sequential)
+    {
+        window = 0;
+        prefetchedUntil = readEnd;
+        return;
+    }
+
+    // The first sequential read prefetches as much as it read, and each next one twice the window
+    window = std::min(maxWindow, std::max(window * 2, size));
+    off_t from = std::max(prefetchedUntil, readEnd);
+    off_t until = std::min(limit, readEnd + static_cast<off_t>(window));
+    if (until > from && mapping)
+    {
+        off_t aligned = from - from % PAGE_SIZE; // madvise takes a range starting on a page boundary
+        madvise(const_cast<char *>(mapping) + aligned, until - aligned, MADV_WILLNEED);
+        prefetchedUntil = until;
+    }
+    else if (until > from)
+    {
+        posix_fadvise(fd, from, until - from, POSIX_FADV_WILLNEED);
+        prefetchedUntil = until;
+    }
+}
+
+size_t ReadAhead::getWindow() const
+{
+    return window;
+}
+
+off_t ReadAhead::getPrefetchedUntil() const
+{
+    return prefetchedUntil;
+}
@@ -0,0 +1,40 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <cstddef>
+#include <sys/types.h>
+#include "global/globals.h"
+
+// ReadAhead follows the reads of one cursor over a file. Once they turn
+// sequential it asks the kernel to load the bytes ahead of the cursor with
+// posix_fadvise(WILLNEED), so the next reads find them in the page cache
+// instead of waiting for the device. The window doubles with every
+// sequential read up to maxWindow; a read elsewhere resets it. Prefetched
+// bytes go to the page cache only, never to the buffer pool. For a file
+// mapped into memory, the bytes are advised with madvise on the mapping.
+class ReadAhead
+{
+public:
+    // Prefetches never reach past `limit`, such as the end of the data pages
+    ReadAhead(int fd, off_t limit, size_t maxWindow = SCAN_READAHEAD_SIZE, const char *mapping = nullptr);
+
+    // Records a read of [offset, offset + size) and prefetches ahead of it
+    void onRead(off_t offset, size_t size);
+
+    // Bytes currently prefetched ahead of a sequential cursor; 0 after random reads
+    size_t getWindow() const;
+
+    // End of the bytes prefetched so far
+    off_t getPrefetchedUntil() const;
+
+private:
+    int fd;
+    off_t limit;
+    size_t maxWindow;
+    const char *mapping;
+    off_t expected = -1; // Where the next sequential read starts
+    size_t window = 0;
+    off_t prefetchedUntil = 0;
+};
+
+#endif // READAHEAD_H
@@ -1,4 +1,5 @@
 #include "sst.h"
+#include "sstwriter.h"
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
@@ -10,131 +11,147 @@
 #include "global/globals.h"
 #include "bloomfilter.h"
 
-SST::SST() : startingKey(0), endingKey(0), numEntries(0), numPages(0), bloomFilter(NUM_ENTRIES, BITS_PER_ENTRY) {}
-
-//////////////////////////////////////////
-// YOU CAN MODIFY THE CONTENTS OF THIS FILE
-//////////////////////////////////////////
-void SST::addPage(const Page &page)
+SST::SST(CompressionType compression, int blockSize) : startingKey(0), endingKey(0), numEntries(0), numPages(0), blockSize(blockSize), compression(compression), bloomFilter(NUM_ENTRIES, BITS_PER_ENTRY)
 {
-    // Update SST metadata
-    if (numPages == 0)
+    if (!isValidBlockSize(blockSize))
     {
-        startingKey = page.startingKey; // Set the starting key from the first page
+        throw std::runtime_error("Invalid SST block size: " + std::to_string(blockSize));
     }
-    endingKey = page.keys.back().key; // Set the ending key from the last entry in this page
-    numEntries += page.numEntries;
-    numPages++;
-
-    // Add the page to the collection
-    pages.push_back(page);
+}
 
-    // Add all keys in the page to the Bloom filter
-    for (const auto &entry : page.keys)
+namespace
+{
+    void putInt64(char *buffer, size_t &offset, int64_t value)
     {
-        bloomFilter.insert(entry.key); // Add keys to Bloom filter
+        std::memcpy(buffer + offset, &value, sizeof(value));
+        offset += sizeof(value);
     }
-    bloomFilter.updateData();
-    // Calculate the offset of this page in the SST file
-    // Assuming that pages are written sequentially after the SST metadata
-    int64_t pageOffset = SST_METADATA_SIZE + PAGE_SIZE + (numPages - 1) * PAGE_SIZE;
-    pageOffsets.push_back(pageOffset);
-
-    // Build the B-tree incrementally
-    if (!btree)
+
+    void putInt32(char *buffer, size_t &offset, int32_t value)
     {
-        // std::cout << "Initialize new btree" << std::endl;
-        btree = new BTree(BTREE_DEGREE); // Initialize B-tree with specified degree
+        std::memcpy(buffer + offset, &value, sizeof(value));
+        offset += sizeof(value);
     }
 
-    // Insert the ending key of the page and its offset into the B-tree
-    btree->insert(endingKey, pageOffset);
+    int64_t getInt64(const char *buffer, size_t &offset)
+    {
+        int64_t value;
+        std::memcpy(&value, buffer + offset, sizeof(value));
+        offset += sizeof(value);
+        return value;
+    }
 
-    // std::cout << "A new B-tree node with key " << endingKey << " is inserted" << std::endl;
-    // std::cout << "The is what the btree looks like right now:" << std::endl;
-    // btree->printTree();
-    // std::cout << "End. Please see the tree in the next round" << std::endl;
+    int32_t getInt32(const char *buffer, size_t &offset)
+    {
+        int32_t value;
+        std::memcpy(&value, buffer + offset, sizeof(value));
+        offset += sizeof(value);
+        return value;
+    }
 }
 
-// write to file
-void SST::writeToFile(const std::string &filename)
+void SSTFooter::encodeTo(char *buffer) const
 {
-    int sst_fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
-    if (sst_fd == -1)
+    size_t offset = 0;
+    for (const BlockRange *range : {&data, &filter, &index, &fences, &handles, &stats})
     {
-        throw std::runtime_error("Failed to open SST file for writing.");
+        putInt64(buffer, offset, range->offset);
+        putInt64(buffer, offset, range->size);
     }
+    putInt64(buffer, offset, rootOffset);
+    putInt32(buffer, offset, static_cast<int32_t>(version));
+    putInt32(buffer, offset, static_cast<int32_t>(SST_FOOTER_MAGIC));
+}
 
-    off_t offset = 0; // Start writing at the beginning of the file
-    size_t totalBytesWritten = 0;
-
-    // Step 1: Write SST-level metadata
-    pwrite(sst_fd, &numEntries, sizeof(numEntries), offset);
-    offset += sizeof(numEntries);
-    totalBytesWritten += sizeof(numEntries);
-
-    pwrite(sst_fd, &numPages, sizeof(numPages), offset);
-    offset += sizeof(numPages);
-    totalBytesWritten += sizeof(numPages);
-
-    pwrite(sst_fd, &startingKey, sizeof(startingKey), offset);
-    offset += sizeof(startingKey);
-    totalBytesWritten += sizeof(startingKey);
+bool SSTFooter::decodeFrom(const char *buffer)
+{
+    size_t offset = SST_FOOTER_SIZE - sizeof(SST_FOOTER_MAGIC);
+    if (static_cast<uint32_t>(getInt32(buffer, offset)) != SST_FOOTER_MAGIC)
+    {
+        return false;
+    }
 
-    pwrite(sst_fd, &endingKey, sizeof(endingKey), offset);
-    offset += sizeof(endingKey);
-    totalBytesWritten += sizeof(endingKey);
+    offset = 0;
+    for (BlockRange *range : {&data, &filter, &index, &fences, &handles, &stats})
+    {
+        range->offset = getInt64(buffer, offset);
+        range->size = getInt64(buffer, offset);
+    }
+    rootOffset = getInt64(buffer, offset);
+    version = static_cast<uint32_t>(getInt32(buffer, offset));
+    return true;
+}
 
-    bloomFilter.updateData();
-    // bloomFilter.printData();
-    std::cout << "Bytes written before write bloom: " << totalBytesWritten << std::endl;
-    // Write Bloom filter metadata and bit array
-    ssize_t bloomFilterSize = bloomFilter.data.size();
+void SSTStats::encodeTo(char *buffer) const
+{
+    size_t offset = 0;
+    putInt32(buffer, offset, numEntries);
+    putInt32(buffer, offset, numPages);
+    putInt64(buffer, offset, startingKey);
+    putInt64(buffer, offset, endingKey);
+    putInt32(buffer, offset, blockSize);
+    putInt32(buffer, offset, numTombstones);
+}
 
-    // Write size of the bit array
-    pwrite(sst_fd, bloomFilter.data.data(), bloomFilterSize, offset);
-    offset += bloomFilterSize;
-    totalBytesWritten += bloomFilterSize;
+void SSTStats::decodeFrom(const char *buffer, size_t size)
+{
+    size_t offset = 0;
+    numEntries = getInt32(buffer, offset);
+    numPages = getInt32(buffer, offset);
+    startingKey = getInt64(buffer, offset);
+    endingKey = getInt64(buffer, offset);
+    blockSize = getInt32(buffer, offset);
+    if (size >= offset + sizeof(int32_t))
+    {
+        numTombstones = getInt32(buffer, offset);
+    }
+}
 
-    std::cout << "Bytes written after write bloom: " << totalBytesWritten << std::endl;
+bool SST::isValidBlockSize(int blockSize)
+{
+    return blockSize >= PAGE_SIZE && blockSize <= MAX_BLOCK_SIZE && blockSize % PAGE_SIZE == 0;
+}
 
-    // Step 2: Write each page (entire page data is stored in page.data)
-    for (const auto &page : pages)
+//////////////////////////////////////////
+// YOU CAN MODIFY THE CONTENTS OF THIS FILE
+//////////////////////////////////////////
+void SST::addPage(const Page &page)
+{
+    if (page.pageSize != blockSize)
     {
-        // Write the entire page data (consolidated as `page.data`)
-        ssize_t pageDataSize = page.data.size();
-        pwrite(sst_fd, page.data.data(), pageDataSize, offset);
-        offset += pageDataSize;
-        totalBytesWritten += pageDataSize;
+        throw std::runtime_error("Page size does not match the SST block size.");
     }
 
-    // Get the vector of nodes in pre-order traversal
-    std::vector<BTree::Node *> preOrderNodes = btree->preorderTraversal();
+    // Update SST metadata
+    if (numPages == 0)
+    {
+        startingKey = page.startingKey; // Set the starting key from the first page
+    }
+    endingKey = page.keys.back().key; // Set the ending key from the last entry in this page
+    numEntries += page.numEntries;
+    numPages++;
 
-    postorderTraversalWrite(btree->getRoot(), offset, totalBytesWritten, sst_fd);
+    // Add the page to the collection
+    pages.push_back(page);
 
-    close(sst_fd);
+    // Add all keys in the page to the Bloom filter
+    for (const auto &entry : page.keys)
+    {
+        bloomFilter.insert(entry.key); // Add keys to Bloom filter
+    }
 }
 
-void SST::postorderTraversalWrite(BTree::Node *node, off_t &currentOffset, size_t &BytesWritten, int &fd)
+// write to file
+void SST::writeToFile(const std::string &filename, RateLimiter *rateLimiter, bool directIO)
 {
-    if (!node)
-        return;
-
-    // Recursively visit each child first
-    if (!node->isLeaf)
+    SSTWriter writer(filename, compression, blockSize);
+    writer.setRateLimiter(rateLimiter, IOPriority::High);
+    writer.setDirectIO(directIO);
+    for (const auto &page : pages)
     {
-        for (auto child : node->children)
-        {
-            node->offsets.push_back(currentOffset);
-            postorderTraversalWrite(child, currentOffset, BytesWritten, fd);
-        }
+        writer.addPage(page);
     }
-    node->updateData();
-    ssize_t nodeDataSize = node->data.size();
-    pwrite(fd, node->data.data(), nodeDataSize, currentOffset);
-    currentOffset += nodeDataSize;
-    BytesWritten += nodeDataSize;
+    writer.finish();
 }
 
 bool SST::mightContain(int64_t key) const
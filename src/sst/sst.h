@@ -8,19 +8,76 @@
 #include "btree/btree.h" // Include the BTree header
 #include "global/globals.h"
 #include "bloomfilter.h"
+#include "compression/compression.h"
+#include "ratelimiter.h"
+
+// Location of a variable-length data block in a compressed SST
+struct BlockHandle
+{
+    int64_t offset;
+    int32_t size;
+};
+
+// Location of a region of an SST file
+struct BlockRange
+{
+    int64_t offset = 0;
+    int64_t size = 0;
+};
+
+// Fixed-size footer at the end of every SST. It locates every other region of
+// the file, so readers never derive the file geometry from PAGE_SIZE.
+struct SSTFooter
+{
+    BlockRange data;    // Data pages
+    BlockRange filter;  // Bloom filter
+    BlockRange index;   // B-tree nodes
+    BlockRange fences;  // Starting key of every data page
+    BlockRange handles; // Block handle table; empty unless the data pages are compressed
+    BlockRange stats;   // SST properties
+    int64_t rootOffset = 0;
+    uint32_t version = SST_FORMAT_VERSION;
+
+    // Serializes the footer into SST_FOOTER_SIZE bytes
+    void encodeTo(char *buffer) const;
+
+    // Parses SST_FOOTER_SIZE bytes; returns false if they do not end with the footer magic
+    bool decodeFrom(const char *buffer);
+};
+
+// Contents of the stats block
+struct SSTStats
+{
+    int32_t numEntries = 0;
+    int32_t numPages = 0;
+    int64_t startingKey = 0;
+    int64_t endingKey = 0;
+    int32_t blockSize = PAGE_SIZE;
+    int32_t numTombstones = 0; // Deletions among the entries
+
+    // New fields are appended; stats blocks written before numTombstones are 28 bytes
+    static constexpr size_t ENCODED_SIZE = 32;
+    static constexpr size_t MIN_ENCODED_SIZE = 28;
+
+    void encodeTo(char *buffer) const;
+    void decodeFrom(const char *buffer, size_t size); // Fields past `size` keep their defaults
+};
 
 class SST
 {
 public:
-    SST(); // Constructor
+    // Constructor; blockSize is the size of every data page of this SST
+    SST(CompressionType compression = CompressionType::None, int blockSize = PAGE_SIZE);
+
+    // Data block sizes are whole multiples of PAGE_SIZE up to MAX_BLOCK_SIZE
+    static bool isValidBlockSize(int blockSize);
 
     // Adds a page to the SST
     void addPage(const Page &page);
 
-    // Flushes the SST to disk, writing all pages and metadata
-    void writeToFile(const std::string &filename);
-
-    void postorderTraversalWrite(BTree::Node* node, off_t& currentOffset, size_t& BytesWritten, int& fd);
+    // Flushes the SST to disk through an SSTWriter, writing all pages and
+    // metadata; writes are charged to rateLimiter at high priority if given
+    void writeToFile(const std::string &filename, RateLimiter *rateLimiter = nullptr, bool directIO = false);
 
     bool mightContain(int64_t key) const;          // Query Bloom filter
     
@@ -29,15 +86,12 @@ public:
     int64_t endingKey;
     int numEntries = 0; // Total number of entries in the SST
     int numPages = 0;   // Total number of pages in the SST
+    int blockSize;      // Size of every data page, recorded in the SST header
 
 private:
     std::vector<Page> pages; // Collection of pages in this SST
 
-    // Offsets of pages within the SST file
-    std::vector<int64_t> pageOffsets;
-
-    // B-tree built over the pages
-    BTree* btree = nullptr;
+    CompressionType compression; // Compression of the data blocks
 
     BloomFilter bloomFilter; // Bloom filter for quick key lookups
 
@@ -0,0 +1,88 @@
+#include "sstiterator.h"
+#include "page.h"
+#include <algorithm>
+
+SSTIterator::SSTIterator(std::shared_ptr<SSTReader> reader, size_t readAheadBytes)
+    : SSTIterator(std::move(reader), INT64_MIN, INT64_MAX, readAheadBytes)
+{
+}
+
+SSTIterator::SSTIterator(std::shared_ptr<SSTReader> reader, int64_t start, int64_t end, size_t readAheadBytes,
+                         RateLimiter *rateLimiter)
+    : reader(std::move(reader)), rateLimiter(rateLimiter), start(start), end(end)
+{
+    pagesPerRead = std::max<int>(1, readAheadBytes / this->reader->blockSize);
+
+    // Pages from the last one starting at or before `start` up to the last one starting at or before `end`
+    const std::vector<int64_t> &fences = this->reader->fencePointers;
+    nextPage = std::max<int>(0, std::upper_bound(fences.begin(), fences.end(), start) - fences.begin() - 1);
+    endPage = std::upper_bound(fences.begin(), fences.end(), end) - fences.begin();
+    loadBatch();
+}
+
+void SSTIterator::loadBatch()
+{
+    entries.clear();
+    position = 0;
+
+    // Skip over pages without entries until a batch yields some
+    while (entries.empty() && nextPage < endPage)
+    {
+        int count = std::min(pagesPerRead, endPage - nextPage);
+        int64_t batchBytes = reader->getPageOffset(nextPage + count) - reader->getPageOffset(nextPage);
+        if (rateLimiter)
+        {
+            rateLimiter->request(batchBytes, IOPriority::Low);
+        }
+        size_t batchSize = static_cast<size_t>(count) * reader->blockSize;
+        if (buffer.size() < batchSize)
+        {
+            buffer = AlignedBuffer(batchSize);
+        }
+        reader->readPages(nextPage, count, buffer.data());
+        bytesRead += batchBytes;
+        nextPage += count;
+        if (nextPage < endPage)
+        {
+            reader->prefetchPages(nextPage, std::min(pagesPerRead, endPage - nextPage));
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            Page::decode(buffer.data() + static_cast<size_t>(i) * reader->blockSize, entries);
+        }
+
+        // Only the first and last pages of the range can hold keys outside it
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [this](const std::pair<int64_t, int64_t> &entry)
+                                     { return entry.first < start || entry.first > end; }),
+                      entries.end());
+    }
+}
+
+bool SSTIterator::valid() const
+{
+    return position < entries.size();
+}
+
+int64_t SSTIterator::key() const
+{
+    return entries[position].first;
+}
+
+int64_t SSTIterator::value() const
+{
+    return entries[position].second;
+}
+
+void SSTIterator::next()
+{
+    if (++position == entries.size())
+    {
+        loadBatch();
+    }
+}
+
+int64_t SSTIterator::getBytesRead() const
+{
+    return bytesRead;
+}
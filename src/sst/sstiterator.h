@@ -0,0 +1,50 @@
+#ifndef SSTITERATOR_H
+#define SSTITERATOR_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "sstreader.h"
+#include "ratelimiter.h"
+
+// SSTIterator walks the entries of an SST in key order. Pages are read in
+// batches of consecutive pages with one read per batch, so sequential passes
+// such as compaction issue few large reads instead of one read per page.
+// While a batch is merged, the kernel is already loading the next one.
+class SSTIterator
+{
+public:
+    // readAheadBytes is the number of data page bytes fetched per read
+    explicit SSTIterator(std::shared_ptr<SSTReader> reader, size_t readAheadBytes = COMPACTION_READAHEAD_SIZE);
+
+    // Walks only the entries with keys in [start, end], reading just the pages
+    // that may hold them. Reads are charged to rateLimiter at low priority.
+    SSTIterator(std::shared_ptr<SSTReader> reader, int64_t start, int64_t end,
+                size_t readAheadBytes = COMPACTION_READAHEAD_SIZE, RateLimiter *rateLimiter = nullptr);
+
+    bool valid() const;
+    int64_t key() const;
+    int64_t value() const;
+    void next();
+
+    // Bytes of data pages read from the file so far
+    int64_t getBytesRead() const;
+
+private:
+    void loadBatch(); // Reads and decodes the next batch of pages
+
+    std::shared_ptr<SSTReader> reader;
+    RateLimiter *rateLimiter = nullptr;
+    int pagesPerRead;
+    int nextPage = 0; // First page not yet read
+    int endPage = 0;  // Page past the last one that may hold keys in range
+    int64_t start = INT64_MIN;
+    int64_t end = INT64_MAX;
+    int64_t bytesRead = 0;
+
+    AlignedBuffer buffer;                             // Decompressed pages of the current batch; aligned for direct reads
+    std::vector<std::pair<int64_t, int64_t>> entries; // Decoded entries of the current batch
+    size_t position = 0;
+};
+
+#endif // SSTITERATOR_H
@@ -0,0 +1,523 @@
+#include "sstreader.h"
+#include "sst.h"
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <atomic>
+#include <cerrno>
+
+namespace
+{
+    // Bounce buffer for the direct reads that cannot land in place. Handles are
+    // shared between threads, so each thread keeps one, grown as needed.
+    AlignedBuffer &bounceBuffer()
+    {
+        thread_local AlignedBuffer buffer;
+        return buffer;
+    }
+}
+
+SSTReader::SSTReader(const std::string &filename) : filename(filename)
+{
+    static std::atomic<uint64_t> nextHandleID{0};
+    cacheKey = filename + "#" + std::to_string(nextHandleID++);
+
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Failed to open SST file for reading: " + filename);
+    }
+
+    try
+    {
+        load();
+    }
+    catch (...)
+    {
+        close(fd); // The destructor does not run for a throwing constructor
+        throw;
+    }
+}
+
+void SSTReader::load()
+{
+    fileSize = lseek(fd, 0, SEEK_END);
+    if (fileSize == -1)
+    {
+        throw std::runtime_error("Failed to determine SST file size: " + filename);
+    }
+
+    // Step 1: Read the tail of the file with a single pread. It holds the footer
+    // and, unless the SST has a very large number of pages, the fence pointers,
+    // block handles and stats that precede it.
+    off_t tailOffset = fileSize - std::min<off_t>(fileSize, SST_TAIL_READ_SIZE);
+    std::vector<char> tail(fileSize - tailOffset);
+    if (pread(fd, tail.data(), tail.size(), tailOffset) != (ssize_t)tail.size())
+    {
+        throw std::runtime_error("Failed to read SST footer: " + filename);
+    }
+
+    SSTFooter footer;
+    if (tail.size() < SST_FOOTER_SIZE || !footer.decodeFrom(tail.data() + tail.size() - SST_FOOTER_SIZE))
+    {
+        // SSTs written before the footer existed end with the B-tree root
+        loadLegacyMetadata(fileSize);
+        return;
+    }
+
+    if (footer.version > SST_FORMAT_VERSION)
+    {
+        throw std::runtime_error("Unsupported SST format version " + std::to_string(footer.version) + ": " + filename);
+    }
+
+    // Step 2: The metadata blocks are contiguous before the footer; read the rest
+    // of them if the tail read did not reach back far enough
+    off_t footerOffset = fileSize - SST_FOOTER_SIZE;
+    off_t metadataOffset = footer.fences.offset;
+    for (const BlockRange &range : {footer.fences, footer.handles, footer.stats})
+    {
+        if (range.offset < 0 || range.size < 0 || range.offset + range.size > footerOffset)
+        {
+            throw std::runtime_error("SST footer points outside the file: " + filename);
+        }
+        metadataOffset = std::min<off_t>(metadataOffset, range.offset);
+    }
+    if (metadataOffset < tailOffset)
+    {
+        tail.resize(fileSize - metadataOffset);
+        if (pread(fd, tail.data(), tail.size(), metadataOffset) != (ssize_t)tail.size())
+        {
+            throw std::runtime_error("Failed to read SST metadata blocks: " + filename);
+        }
+        tailOffset = metadataOffset;
+    }
+    auto blockData = [&](const BlockRange &range)
+    { return tail.data() + (range.offset - tailOffset); };
+
+    // Step 3: SST properties from the stats block
+    if (footer.stats.size < (int64_t)SSTStats::MIN_ENCODED_SIZE)
+    {
+        throw std::runtime_error("SST stats block is truncated: " + filename);
+    }
+    SSTStats stats;
+    stats.decodeFrom(blockData(footer.stats), footer.stats.size);
+    numEntries = stats.numEntries;
+    numPages = stats.numPages;
+    startingKey = stats.startingKey;
+    endingKey = stats.endingKey;
+    blockSize = stats.blockSize;
+    numTombstones = stats.numTombstones;
+
+    if (numPages <= 0)
+    {
+        throw std::runtime_error("SST file has no pages: " + filename);
+    }
+    if (!SST::isValidBlockSize(blockSize))
+    {
+        throw std::runtime_error("Invalid block size in SST stats: " + filename);
+    }
+
+    // Step 4: Geometry of the filter, data and index regions
+    filterOffset = footer.filter.offset;
+    filterSize = footer.filter.size;
+    dataOffset = footer.data.offset;
+    dataEndOffset = footer.data.offset + footer.data.size;
+    rootOffset = footer.rootOffset;
+    if (rootOffset < footer.index.offset || rootOffset + PAGE_SIZE > footer.index.offset + footer.index.size)
+    {
+        throw std::runtime_error("B-tree root lies outside the index block: " + filename);
+    }
+
+    // Step 5: Fence pointers
+    if (footer.fences.size != (int64_t)(numPages * sizeof(int64_t)))
+    {
+        throw std::runtime_error("Fence pointer count does not match page count: " + filename);
+    }
+    fencePointers.resize(numPages);
+    std::memcpy(fencePointers.data(), blockData(footer.fences), footer.fences.size);
+
+    // Step 6: Block handles of compressed data pages
+    if (footer.handles.size > 0)
+    {
+        loadBlockHandles(blockData(footer.handles), footer.handles.size);
+    }
+}
+
+void SSTReader::loadBlockHandles(const char *table, size_t tableSize)
+{
+    int32_t compressionType = 0;
+    int32_t numBlocks = 0;
+    size_t offset = 0;
+    if (tableSize < sizeof(compressionType) + sizeof(numBlocks))
+    {
+        throw std::runtime_error("Block handle table is truncated: " + filename);
+    }
+    std::memcpy(&compressionType, table + offset, sizeof(compressionType));
+    offset += sizeof(compressionType);
+    std::memcpy(&numBlocks, table + offset, sizeof(numBlocks));
+    offset += sizeof(numBlocks);
+
+    size_t handleSize = sizeof(int64_t) + sizeof(int32_t);
+    if (numBlocks != numPages || tableSize != offset + numBlocks * handleSize)
+    {
+        throw std::runtime_error("Block handle table does not match page count: " + filename);
+    }
+    compression = static_cast<CompressionType>(compressionType);
+
+    blockHandles.resize(numBlocks);
+    for (auto &handle : blockHandles)
+    {
+        std::memcpy(&handle.offset, table + offset, sizeof(handle.offset));
+        offset += sizeof(handle.offset);
+        std::memcpy(&handle.size, table + offset, sizeof(handle.size));
+        offset += sizeof(handle.size);
+    }
+}
+
+SSTReader::~SSTReader()
+{
+    if (mapping)
+    {
+        munmap(const_cast<char *>(mapping), fileSize);
+    }
+    if (directFd != -1)
+    {
+        close(directFd);
+    }
+    if (fd != -1)
+    {
+        close(fd);
+    }
+}
+
+void SSTReader::loadLegacyMetadata(off_t fileSize)
+{
+    // The legacy header holds numEntries, numPages, startingKey and endingKey
+    char metadata[LEGACY_SST_METADATA_SIZE];
+    if (pread(fd, metadata, LEGACY_SST_METADATA_SIZE, 0) != (ssize_t)LEGACY_SST_METADATA_SIZE)
+    {
+        throw std::runtime_error("Failed to read SST metadata: " + filename);
+    }
+    size_t offset = 0;
+    std::memcpy(&numEntries, metadata + offset, sizeof(numEntries));
+    offset += sizeof(numEntries);
+    std::memcpy(&numPages, metadata + offset, sizeof(numPages));
+    offset += sizeof(numPages);
+    std::memcpy(&startingKey, metadata + offset, sizeof(startingKey));
+    offset += sizeof(startingKey);
+    std::memcpy(&endingKey, metadata + offset, sizeof(endingKey));
+
+    if (numPages <= 0)
+    {
+        throw std::runtime_error("SST file has no pages: " + filename);
+    }
+
+    // One-page filter and fixed-size pages, with the B-tree root last
+    blockSize = PAGE_SIZE;
+    filterOffset = LEGACY_SST_METADATA_SIZE;
+    filterSize = PAGE_SIZE;
+    dataOffset = filterOffset + filterSize;
+    dataEndOffset = dataOffset + static_cast<off_t>(numPages) * blockSize;
+    rootOffset = fileSize - PAGE_SIZE;
+
+    // Rebuild the fence pointers from the page headers
+    fencePointers.resize(numPages);
+    for (int page = 0; page < numPages; ++page)
+    {
+        // The starting key follows numEntries in the page metadata
+        off_t keyOffset = getPageOffset(page) + sizeof(int);
+        if (pread(fd, &fencePointers[page], sizeof(int64_t), keyOffset) != sizeof(int64_t))
+        {
+            throw std::runtime_error("Failed to read page metadata: " + filename);
+        }
+    }
+}
+
+int SSTReader::findPage(int64_t key) const
+{
+    if (key < startingKey || key > endingKey)
+    {
+        return -1;
+    }
+
+    // The candidate page is the last one starting at or before the key
+    auto it = std::upper_bound(fencePointers.begin(), fencePointers.end(), key);
+    if (it == fencePointers.begin())
+    {
+        return -1;
+    }
+    return static_cast<int>(it - fencePointers.begin()) - 1;
+}
+
+off_t SSTReader::getPageOffset(int page) const
+{
+    if (!blockHandles.empty())
+    {
+        return page < numPages ? blockHandles[page].offset : getDataEndOffset();
+    }
+    return dataOffset + (static_cast<off_t>(page) * blockSize);
+}
+
+off_t SSTReader::getDataEndOffset() const
+{
+    return dataEndOffset;
+}
+
+size_t SSTReader::getBlockSize(off_t offset) const
+{
+    // Data blocks span blockSize bytes; B-tree nodes always span PAGE_SIZE
+    return offset >= dataOffset && offset < getDataEndOffset() ? blockSize : PAGE_SIZE;
+}
+
+size_t SSTReader::getStoredSize(off_t offset) const
+{
+    if (blockHandles.empty() || offset >= getDataEndOffset())
+    {
+        return getBlockSize(offset);
+    }
+
+    // Locate the handle of the data block starting at this offset
+    auto it = std::lower_bound(blockHandles.begin(), blockHandles.end(), offset,
+                               [](const BlockHandle &handle, off_t value)
+                               { return handle.offset < value; });
+    if (it == blockHandles.end() || it->offset != offset)
+    {
+        throw std::runtime_error("No data block starts at offset " + std::to_string(offset) + ": " + filename);
+    }
+    // Blocks that did not shrink are stored raw
+    return std::min<size_t>(it->size, blockSize);
+}
+
+size_t SSTReader::readBlock(off_t offset, char *buffer) const
+{
+    size_t size = getBlockSize(offset);
+    size_t storedSize = getStoredSize(offset);
+    const char *block = getMappedRange(offset, storedSize);
+    if (!block && directFd != -1)
+    {
+        if (storedSize == size && isDirectAligned(buffer, offset, size))
+        {
+            if (readDirect(buffer, size, offset) != size)
+            {
+                throw std::runtime_error("Failed to read SST file or incomplete page read.");
+            }
+            return size;
+        }
+        block = readAligned(offset, storedSize, bounceBuffer());
+    }
+    if (block)
+    {
+        if (storedSize < size)
+        {
+            decompressBlock(block, storedSize, buffer, size);
+        }
+        else
+        {
+            std::memcpy(buffer, block, size);
+        }
+        return size;
+    }
+    if (storedSize < size)
+    {
+        std::vector<char> compressed(storedSize);
+        if (pread(fd, compressed.data(), storedSize, offset) != (ssize_t)storedSize)
+        {
+            throw std::runtime_error("Failed to read compressed block: " + filename);
+        }
+        decompressBlock(compressed.data(), compressed.size(), buffer, size);
+        return size;
+    }
+
+    ssize_t bytes_read = pread(fd, buffer, size, offset);
+    if (bytes_read == -1 || bytes_read != (ssize_t)size)
+    {
+        throw std::runtime_error("Failed to read SST file or incomplete page read.");
+    }
+    return size;
+}
+
+void SSTReader::prefetchPages(int firstPage, int count) const
+{
+    if (directFd != -1)
+    {
+        return; // Direct reads bypass the page cache, so there is nothing to prefetch into
+    }
+    off_t start = getPageOffset(firstPage);
+    off_t length = getPageOffset(firstPage + count) - start;
+    if (mapping)
+    {
+        // madvise takes a range starting on a page boundary
+        off_t aligned = start - start % PAGE_SIZE;
+        madvise(const_cast<char *>(mapping) + aligned, length + (start - aligned), MADV_WILLNEED);
+        return;
+    }
+    posix_fadvise(fd, start, length, POSIX_FADV_WILLNEED);
+}
+
+void SSTReader::openDirect()
+{
+    if (directFd != -1)
+    {
+        return;
+    }
+    directFd = open(filename.c_str(), O_RDONLY | O_DIRECT);
+    if (directFd == -1)
+    {
+        throw std::runtime_error("Failed to open SST file for direct I/O: " + filename);
+    }
+}
+
+const char *SSTReader::readAligned(off_t offset, size_t size, AlignedBuffer &buffer) const
+{
+    off_t start = alignDown(offset);
+    size_t length = alignUp(offset + static_cast<off_t>(size)) - start;
+    if (buffer.size() < length)
+    {
+        buffer = AlignedBuffer(length);
+    }
+
+    // The last aligned block may run past the end of the file
+    if (readDirect(buffer.data(), length, start) < offset - start + size)
+    {
+        throw std::runtime_error("Failed to read SST file or incomplete page read.");
+    }
+    return buffer.data() + (offset - start);
+}
+
+size_t SSTReader::readDirect(char *buffer, size_t length, off_t start) const
+{
+    size_t bytesRead = 0;
+    while (bytesRead < length)
+    {
+        ssize_t result = pread(directFd, buffer + bytesRead, length - bytesRead, start + bytesRead);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            break;
+        }
+        bytesRead += result;
+    }
+    return bytesRead;
+}
+
+void SSTReader::mapFile()
+{
+    if (mapping)
+    {
+        return;
+    }
+    void *address = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map SST file: " + filename);
+    }
+
+    // Point lookups touch one page each; sequential passes advise their own ranges
+    madvise(address, fileSize, MADV_RANDOM);
+    mapping = static_cast<const char *>(address);
+}
+
+bool SSTReader::isMapped() const
+{
+    return mapping != nullptr;
+}
+
+const char *SSTReader::getMappedRange(off_t offset, size_t size) const
+{
+    if (!mapping || offset < 0 || offset + static_cast<off_t>(size) > fileSize)
+    {
+        return nullptr;
+    }
+    return mapping + offset;
+}
+
+const char *SSTReader::getMappedBlock(off_t offset) const
+{
+    if (!mapping || getStoredSize(offset) < getBlockSize(offset))
+    {
+        return nullptr;
+    }
+    return getMappedRange(offset, getBlockSize(offset));
+}
+
+void SSTReader::readPages(int firstPage, int count, char *buffer) const
+{
+    if (firstPage < 0 || count <= 0 || firstPage + count > numPages)
+    {
+        throw std::runtime_error("Page range is outside the SST: " + filename);
+    }
+
+    off_t start = getPageOffset(firstPage);
+    size_t length = getPageOffset(firstPage + count) - start;
+    if (mapping)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            readBlock(getPageOffset(firstPage + i), buffer + static_cast<size_t>(i) * blockSize);
+        }
+        return;
+    }
+    if (directFd != -1)
+    {
+        if (blockHandles.empty() && isDirectAligned(buffer, start, length))
+        {
+            if (readDirect(buffer, length, start) != length)
+            {
+                throw std::runtime_error("Failed to read SST file or incomplete page read.");
+            }
+            return;
+        }
+        const char *blocks = readAligned(start, length, bounceBuffer());
+        for (int i = 0; i < count; ++i)
+        {
+            off_t pageOffset = getPageOffset(firstPage + i);
+            char *page = buffer + static_cast<size_t>(i) * blockSize;
+            size_t storedSize = getStoredSize(pageOffset);
+            if (storedSize < static_cast<size_t>(blockSize))
+            {
+                decompressBlock(blocks + (pageOffset - start), storedSize, page, blockSize);
+            }
+            else
+            {
+                std::memcpy(page, blocks + (pageOffset - start), blockSize);
+            }
+        }
+        return;
+    }
+    if (blockHandles.empty())
+    {
+        // Uncompressed pages are read straight into place
+        if (pread(fd, buffer, length, start) != (ssize_t)length)
+        {
+            throw std::runtime_error("Failed to read SST file or incomplete page read.");
+        }
+        return;
+    }
+
+    std::vector<char> blocks(length);
+    if (pread(fd, blocks.data(), length, start) != (ssize_t)length)
+    {
+        throw std::runtime_error("Failed to read compressed blocks: " + filename);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        const BlockHandle &handle = blockHandles[firstPage + i];
+        const char *block = blocks.data() + (handle.offset - start);
+        char *page = buffer + static_cast<size_t>(i) * blockSize;
+        if (handle.size < blockSize)
+        {
+            decompressBlock(block, handle.size, page, blockSize);
+        }
+        else
+        {
+            std::memcpy(page, block, blockSize);
+        }
+    }
+}
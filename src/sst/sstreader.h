@@ -0,0 +1,135 @@
+#ifndef SSTREADER_H
+#define SSTREADER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
+#include "global/globals.h"
+#include "compression/compression.h"
+#include "sst.h"
+#include "alignedbuffer.h"
+
+// SSTReader is an open handle on an SST file on disk. It keeps the file
+// descriptor open for the lifetime of the handle and loads the footer, the SST
+// stats and the fence pointer array (the minimum key of every data page) once,
+// usually with a single read of the file tail, so that point lookups can
+// locate the only candidate page in memory and then read exactly one data page.
+class SSTReader
+{
+public:
+    // Opens the SST file and loads its metadata and fence pointers
+    explicit SSTReader(const std::string &filename);
+
+    // Unmaps the file and closes the file descriptor
+    ~SSTReader();
+
+    SSTReader(const SSTReader &) = delete;
+    SSTReader &operator=(const SSTReader &) = delete;
+
+    // Returns the index of the only page that can contain the key, or -1 if
+    // the key is outside the key range of the SST
+    int findPage(int64_t key) const;
+
+    // Returns the file offset of the given data page
+    off_t getPageOffset(int page) const;
+
+    // Returns the offset just past the last data page, where the B-tree nodes begin
+    off_t getDataEndOffset() const;
+
+    // Returns the size of the block at a file offset once read: blockSize for
+    // data pages, PAGE_SIZE for B-tree nodes
+    size_t getBlockSize(off_t offset) const;
+
+    // Returns the bytes the block at a file offset occupies on disk, which is
+    // less than its block size only for compressed data blocks
+    size_t getStoredSize(off_t offset) const;
+
+    // Reads the page or B-tree node at a file offset into a buffer of at least
+    // blockSize bytes, decompressing it if it is a compressed data block.
+    // Returns the size of the block: blockSize for pages, PAGE_SIZE for nodes.
+    // Direct reads of uncompressed pages land in place if the buffer is aligned.
+    size_t readBlock(off_t offset, char *buffer) const;
+
+    // Reads `count` consecutive data pages starting at `firstPage` with a single
+    // read, decompressing them into `buffer` (count * blockSize bytes). Direct
+    // reads of uncompressed pages land in place if the buffer is aligned.
+    void readPages(int firstPage, int count, char *buffer) const;
+
+    // Asks the kernel to start loading `count` consecutive data pages from
+    // `firstPage` into the page cache, without waiting for them
+    void prefetchPages(int firstPage, int count) const;
+
+    // Maps the whole file read-only for the lifetime of the handle, advising
+    // the kernel of random access; blocks are then read from the mapping.
+    // Must be called before the handle is shared with other threads.
+    void mapFile();
+
+    bool isMapped() const;
+
+    // Returns the bytes [offset, offset + size) of the mapped file, or nullptr
+    // if the file is not mapped or the range runs past its end
+    const char *getMappedRange(off_t offset, size_t size) const;
+
+    // Returns the mapped page or B-tree node at a file offset, for searching in
+    // place, or nullptr if the file is not mapped or the block is compressed
+    const char *getMappedBlock(off_t offset) const;
+
+    // Opens a second descriptor with O_DIRECT; pages and B-tree nodes are then
+    // read through it, bypassing the page cache, in whole aligned blocks. The
+    // metadata and Bloom filter keep being read through the page cache.
+    // Must be called before the handle is shared with other threads.
+    void openDirect();
+
+    // Reads [offset, offset + size) through the O_DIRECT descriptor into an
+    // aligned buffer covering the aligned blocks around the range, growing the
+    // buffer if it is too small; returns the start of the range in the buffer
+    const char *readAligned(off_t offset, size_t size, AlignedBuffer &buffer) const;
+
+    std::string filename;
+    int fd = -1;
+    off_t fileSize = 0;
+    const char *mapping = nullptr; // The whole file, once mapFile is called
+    int directFd = -1;             // O_DIRECT descriptor, once openDirect is called
+
+    // Prefix of the buffer pool page IDs of this file. It is unique per open
+    // handle, so cached pages of a deleted or rewritten file are never served.
+    std::string cacheKey;
+
+    // SST metadata
+    int numEntries = 0;
+    int numPages = 0;
+    int64_t startingKey = 0;
+    int64_t endingKey = 0;
+    int blockSize = PAGE_SIZE; // Size of every data page
+    int numTombstones = 0;     // Deleted keys; 0 for SSTs written before the count was kept
+
+    // File geometry, located by the SST footer
+    off_t filterOffset = 0;  // Offset of the Bloom filter
+    off_t filterSize = 0;    // Size of the Bloom filter
+    off_t dataOffset = 0;    // Offset of the first data page
+    off_t dataEndOffset = 0; // Offset just past the last data page
+
+    off_t rootOffset = 0;               // Offset of the B-tree root node
+    std::vector<int64_t> fencePointers; // Starting key of every data page
+
+    // Data block compression; block handles are only stored for compressed SSTs
+    CompressionType compression = CompressionType::None;
+    std::vector<BlockHandle> blockHandles;
+
+private:
+    // Loads the metadata located by the footer; throws if the file is malformed
+    void load();
+
+    // Reads the header and rebuilds the fence pointers of SSTs written without a footer
+    void loadLegacyMetadata(off_t fileSize);
+
+    // Parses the block handle table of a compressed SST
+    void loadBlockHandles(const char *table, size_t tableSize);
+
+    // Reads an aligned range through the O_DIRECT descriptor; returns the bytes
+    // read, which fall short of `length` only at the end of the file
+    size_t readDirect(char *buffer, size_t length, off_t start) const;
+};
+
+#endif // SSTREADER_H
@@ -0,0 +1,353 @@
+#include "sstwriter.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+SSTWriter::SSTWriter(const std::string &filename, CompressionType compression, int blockSize, PageFormat pageFormat)
+    : filename(filename), compression(compression), blockSize(blockSize), pageFormat(pageFormat),
+      currentPage(pageFormat, blockSize), btree(BTREE_DEGREE), bloomFilter(NUM_ENTRIES, BITS_PER_ENTRY)
+{
+    if (!SST::isValidBlockSize(blockSize))
+    {
+        throw std::runtime_error("Invalid SST block size: " + std::to_string(blockSize));
+    }
+
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Failed to open SST file for writing.");
+    }
+
+    // Data pages follow the header and the Bloom filter (one byte per bit) from
+    // an aligned offset, so uncompressed pages are read with O_DIRECT in place
+    dataOffset = alignUp(SST_METADATA_SIZE + bloomFilter.numBits);
+    offset = dataOffset;
+}
+
+SSTWriter::~SSTWriter()
+{
+    if (fd != -1)
+    {
+        abandon();
+    }
+}
+
+void SSTWriter::setRateLimiter(RateLimiter *limiter, IOPriority priority)
+{
+    rateLimiter = limiter;
+    ioPriority = priority;
+}
+
+void SSTWriter::setDirectIO(bool enabled)
+{
+    if (!enabled || directIO)
+    {
+        return;
+    }
+    if (offset != dataOffset)
+    {
+        throw std::runtime_error("Direct I/O must be enabled before pages are added: " + filename);
+    }
+
+    int directFd = open(filename.c_str(), O_WRONLY | O_DIRECT);
+    if (directFd == -1)
+    {
+        throw std::runtime_error("Failed to open SST file for direct I/O: " + filename);
+    }
+    close(fd);
+    fd = directFd;
+    directIO = true;
+
+    head = AlignedBuffer(dataOffset);
+    staged = AlignedBuffer(DIRECT_IO_WRITE_BUFFER_SIZE);
+    stagedOffset = head.size();
+}
+
+void SSTWriter::writeAt(const void *buffer, size_t size, off_t position)
+{
+    if (rateLimiter)
+    {
+        rateLimiter->request(size, ioPriority);
+    }
+    if (directIO)
+    {
+        stage(static_cast<const char *>(buffer), size, position);
+        return;
+    }
+    if (pwrite(fd, buffer, size, position) != (ssize_t)size)
+    {
+        throw std::runtime_error("Failed to write SST file: " + filename);
+    }
+}
+
+void SSTWriter::add(int64_t key, int64_t value)
+{
+    if (!currentPage.addEntry(key, value))
+    {
+        addPage(currentPage);
+        currentPage = Page(pageFormat, blockSize);
+        currentPage.addEntry(key, value);
+    }
+}
+
+void SSTWriter::stage(const char *data, size_t size, off_t position)
+{
+    // The header and Bloom filter are written last, so their blocks stay in memory
+    if (position < static_cast<off_t>(head.size()))
+    {
+        size_t count = std::min<size_t>(size, head.size() - position);
+        std::memcpy(head.data() + position, data, count);
+        data += count;
+        size -= count;
+        position += count;
+    }
+
+    while (size > 0)
+    {
+        if (position != stagedOffset + static_cast<off_t>(stagedSize))
+        {
+            throw std::runtime_error("Direct I/O writes must append to the SST: " + filename);
+        }
+        size_t count = std::min(size, staged.size() - stagedSize);
+        std::memcpy(staged.data() + stagedSize, data, count);
+        stagedSize += count;
+        data += count;
+        size -= count;
+        position += count;
+        if (stagedSize == staged.size())
+        {
+            flushStaged();
+        }
+    }
+}
+
+void SSTWriter::writeAligned(const char *data, size_t size, off_t position)
+{
+    size_t written = 0;
+    while (written < size)
+    {
+        ssize_t result = pwrite(fd, data + written, size - written, position + written);
+        if (result <= 0)
+        {
+            throw std::runtime_error("Failed to write SST file: " + filename);
+        }
+        written += result;
+    }
+}
+
+void SSTWriter::flushStaged()
+{
+    if (stagedSize == 0)
+    {
+        return;
+    }
+
+    // A partial last block is padded; finish() truncates the file past its end
+    size_t size = alignUp(stagedSize);
+    std::memset(staged.data() + stagedSize, 0, size - stagedSize);
+    writeAligned(staged.data(), size, stagedOffset);
+    stagedOffset += stagedSize;
+    stagedSize = 0;
+}
+
+void SSTWriter::addPage(const Page &page)
+{
+    if (page.pageSize != blockSize)
+    {
+        throw std::runtime_error("Page size does not match the SST block size.");
+    }
+    if (page.numEntries == 0)
+    {
+        return;
+    }
+
+    // Update SST metadata
+    if (numPages == 0)
+    {
+        startingKey = page.startingKey;
+    }
+    endingKey = page.keys.back().key;
+    numEntries += page.numEntries;
+    numPages++;
+
+    // Serialize pages that buffer their entries
+    Page serialized = page;
+    serialized.finalize();
+
+    for (size_t i = 0; i < page.keys.size(); ++i)
+    {
+        bloomFilter.insert(page.keys[i].key);
+        int64_t value = page.format == PageFormat::Packed ? page.values[i] : serialized.readValueAtOffset(page.keys[i].valueOffset);
+        if (value == TOMBSTONE)
+        {
+            ++numTombstones;
+        }
+    }
+    const std::vector<char> *block = &serialized.data;
+
+    // Compressed pages that do not shrink are stored raw
+    if (compression == CompressionType::LZ4)
+    {
+        compressBlock(serialized.data.data(), serialized.data.size(), compressed);
+        if (compressed.size() < serialized.data.size())
+        {
+            block = &compressed;
+        }
+        handles.push_back({offset, static_cast<int32_t>(block->size())});
+    }
+
+    writeAt(block->data(), block->size(), offset);
+    fences.push_back(page.startingKey);
+    btree.insert(endingKey, offset); // Ending key of the page and its offset
+    offset += block->size();
+}
+
+void SSTWriter::writeIndexNode(BTree::Node *node, off_t &position)
+{
+    if (!node)
+        return;
+
+    // Children are written first, so every node knows the offsets of its children
+    if (!node->isLeaf)
+    {
+        for (auto child : node->children)
+        {
+            node->offsets.push_back(position);
+            writeIndexNode(child, position);
+        }
+    }
+    node->updateData();
+    writeAt(node->data.data(), node->data.size(), position);
+    position += node->data.size();
+}
+
+void SSTWriter::finish()
+{
+    addPage(currentPage);
+    currentPage = Page(pageFormat, blockSize);
+    if (numPages == 0)
+    {
+        throw std::runtime_error("Cannot finish an SST without entries: " + filename);
+    }
+
+    SSTFooter footer;
+    footer.filter = {static_cast<int64_t>(SST_METADATA_SIZE), static_cast<int64_t>(bloomFilter.numBits)};
+    footer.data = {dataOffset, offset - dataOffset};
+
+    // Step 1: Write the B-tree nodes; the root is the last node written in postorder
+    footer.index.offset = offset;
+    writeIndexNode(btree.getRoot(), offset);
+    footer.index.size = offset - footer.index.offset;
+    footer.rootOffset = offset - PAGE_SIZE;
+
+    // Step 2: Write the fence pointers (starting key of every page)
+    footer.fences = {offset, static_cast<int64_t>(fences.size() * sizeof(int64_t))};
+    writeAt(fences.data(), footer.fences.size, offset);
+    offset += footer.fences.size;
+
+    // Step 3: Compressed SSTs follow the fence pointers with the block handle table:
+    // compression type, block count, then the offset and size of every data block
+    footer.handles.offset = offset;
+    if (compression != CompressionType::None)
+    {
+        std::vector<char> table;
+        auto append = [&table](const void *value, size_t size)
+        {
+            const char *bytes = static_cast<const char *>(value);
+            table.insert(table.end(), bytes, bytes + size);
+        };
+        int32_t compressionType = static_cast<int32_t>(compression);
+        int32_t numBlocks = static_cast<int32_t>(handles.size());
+        append(&compressionType, sizeof(compressionType));
+        append(&numBlocks, sizeof(numBlocks));
+        for (const auto &handle : handles)
+        {
+            append(&handle.offset, sizeof(handle.offset));
+            append(&handle.size, sizeof(handle.size));
+        }
+        writeAt(table.data(), table.size(), offset);
+        offset += table.size();
+    }
+    footer.handles.size = offset - footer.handles.offset;
+
+    // Step 4: Write the stats block
+    SSTStats stats;
+    stats.numEntries = numEntries;
+    stats.numPages = numPages;
+    stats.startingKey = startingKey;
+    stats.endingKey = endingKey;
+    stats.blockSize = blockSize;
+    stats.numTombstones = numTombstones;
+
+    char statsBuffer[SSTStats::ENCODED_SIZE];
+    stats.encodeTo(statsBuffer);
+    footer.stats = {offset, static_cast<int64_t>(SSTStats::ENCODED_SIZE)};
+    writeAt(statsBuffer, SSTStats::ENCODED_SIZE, offset);
+    offset += SSTStats::ENCODED_SIZE;
+
+    // Step 5: Write the footer locating every other region of the file
+    char footerBuffer[SST_FOOTER_SIZE];
+    footer.encodeTo(footerBuffer);
+    writeAt(footerBuffer, SST_FOOTER_SIZE, offset);
+    offset += SST_FOOTER_SIZE;
+
+    // Step 6: Write the Bloom filter and the header in front of the data pages
+    bloomFilter.updateData();
+    writeAt(bloomFilter.data.data(), footer.filter.size, footer.filter.offset);
+
+    char header[SST_METADATA_SIZE] = {0};
+    size_t headerOffset = 0;
+    std::memcpy(header + headerOffset, &numEntries, sizeof(numEntries));
+    headerOffset += sizeof(numEntries);
+    std::memcpy(header + headerOffset, &numPages, sizeof(numPages));
+    headerOffset += sizeof(numPages);
+    std::memcpy(header + headerOffset, &startingKey, sizeof(startingKey));
+    headerOffset += sizeof(startingKey);
+    std::memcpy(header + headerOffset, &endingKey, sizeof(endingKey));
+    headerOffset += sizeof(endingKey);
+    std::memcpy(header + headerOffset, &blockSize, sizeof(blockSize)); // Followed by a reserved word
+    writeAt(header, SST_METADATA_SIZE, 0);
+
+    if (directIO)
+    {
+        flushStaged();
+        writeAligned(head.data(), head.size(), 0);
+        if (ftruncate(fd, offset) != 0)
+        {
+            throw std::runtime_error("Failed to truncate SST file: " + filename);
+        }
+    }
+
+    // Step 7: Sync the data and the file size, so a manifest edit naming the
+    // SST never survives a power loss that its contents do not
+    if (fdatasync(fd) != 0)
+    {
+        throw std::runtime_error("Failed to sync SST file: " + filename);
+    }
+    close(fd);
+    fd = -1;
+}
+
+void SSTWriter::abandon()
+{
+    if (fd == -1)
+    {
+        return;
+    }
+    close(fd);
+    fd = -1;
+    std::remove(filename.c_str());
+}
+
+int64_t SSTWriter::getFileSize() const
+{
+    return offset;
+}
+
+int64_t SSTWriter::getDataSize() const
+{
+    return offset - dataOffset;
+}
@@ -0,0 +1,102 @@
+#ifndef SSTWRITER_H
+#define SSTWRITER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "page.h"
+#include "btree/btree.h"
+#include "global/globals.h"
+#include "bloomfilter.h"
+#include "compression/compression.h"
+#include "sst.h"
+#include "ratelimiter.h"
+#include "alignedbuffer.h"
+
+// SSTWriter streams an SST to disk. Data pages are written as soon as they
+// are added, so memory use is bounded by one page plus the per-page index
+// (B-tree keys, fence pointers and block handles) regardless of the SST size.
+// finish() writes the filter, index, fence pointers, block handles, stats,
+// footer and header once all pages are known. With direct I/O the file is
+// written with O_DIRECT from aligned staging buffers, bypassing the page cache.
+class SSTWriter
+{
+public:
+    // Creates the file; pages built by add() use pageFormat
+    SSTWriter(const std::string &filename, CompressionType compression = CompressionType::None,
+              int blockSize = PAGE_SIZE, PageFormat pageFormat = PageFormat::Packed);
+
+    // Closes and removes the file if finish() was never called
+    ~SSTWriter();
+
+    SSTWriter(const SSTWriter &) = delete;
+    SSTWriter &operator=(const SSTWriter &) = delete;
+
+    // Appends an entry; keys must arrive in ascending order
+    void add(int64_t key, int64_t value);
+
+    // Appends a complete page; keys must be greater than those already added
+    void addPage(const Page &page);
+
+    // Writes the remaining metadata, syncs the file to disk and closes it
+    void finish();
+
+    // Closes and removes the file without finishing it
+    void abandon();
+
+    // Returns the bytes written to the file so far
+    int64_t getFileSize() const;
+
+    // Returns the bytes of data pages written so far, leaving out the header,
+    // Bloom filter and padding in front of the first page
+    int64_t getDataSize() const;
+
+    // Charges every write to a rate limiter; null writes at full speed
+    void setRateLimiter(RateLimiter *limiter, IOPriority priority);
+
+    // Writes the file with O_DIRECT. Appended blocks are staged in an aligned
+    // buffer and written DIRECT_IO_WRITE_BUFFER_SIZE at a time; the aligned
+    // blocks holding the header and Bloom filter are kept in memory until
+    // finish(). Must be called before the first page is added.
+    void setDirectIO(bool enabled);
+
+    std::string filename;
+
+    // SST metadata
+    int numEntries = 0;
+    int numPages = 0;
+    int64_t startingKey = 0;
+    int64_t endingKey = 0;
+    int numTombstones = 0;
+
+private:
+    void writeAt(const void *buffer, size_t size, off_t offset);
+    void stage(const char *data, size_t size, off_t position); // Copies a direct write into the staging buffers
+    void writeAligned(const char *data, size_t size, off_t position);
+    void flushStaged(); // Writes the staged appends, padded to the alignment
+    void writeIndexNode(BTree::Node *node, off_t &offset);
+
+    int fd = -1;
+    bool directIO = false;
+    AlignedBuffer head;    // Header and Bloom filter, padded up to the aligned data offset
+    AlignedBuffer staged;  // Appended bytes from stagedOffset on, not yet written
+    off_t stagedOffset = 0;
+    size_t stagedSize = 0;
+    RateLimiter *rateLimiter = nullptr;
+    IOPriority ioPriority = IOPriority::Low;
+    CompressionType compression;
+    int blockSize;
+    PageFormat pageFormat;
+
+    Page currentPage;              // Page being filled by add()
+    off_t offset = 0;              // Offset at which the next block is written
+    off_t dataOffset = 0;          // Offset of the first data page
+    std::vector<char> compressed;  // Scratch buffer for compressed pages
+    std::vector<int64_t> fences;   // Starting key of every page
+    std::vector<BlockHandle> handles;
+
+    BTree btree;             // Ending key and offset of every page
+    BloomFilter bloomFilter; // Bloom filter over every key
+};
+
+#endif // SSTWRITER_H
@@ -0,0 +1,168 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "executor.h"
+
+// Task is the coroutine type of the asynchronous KVStore operations. A task
+// starts when it is awaited by another coroutine, or when start is called
+// with a callback that receives its result, or the exception it threw, once
+// it finishes. Its continuation runs on whichever executor thread completed
+// the last read it waited on.
+template <typename T>
+class Task
+{
+public:
+    struct promise_type
+    {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation; // The coroutine awaiting this one
+
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Resumes the awaiting coroutine directly, without growing the stack
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T result) { value = std::move(result); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        handle.promise().continuation = caller;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        if (handle.promise().error)
+        {
+            std::rethrow_exception(handle.promise().error);
+        }
+        return std::move(*handle.promise().value);
+    }
+
+    // Starts the task; it keeps itself alive until `done` has run
+    void start(std::function<void(T, std::exception_ptr)> done) &&
+    {
+        detach(std::move(*this), std::move(done));
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    // A coroutine that starts at once and frees itself when it ends
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); } // Thrown by the callback
+        };
+    };
+
+    static Detached detach(Task task, std::function<void(T, std::exception_ptr)> done)
+    {
+        T result{};
+        std::exception_ptr error;
+        try
+        {
+            result = co_await task;
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        done(std::move(result), error);
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Awaiting a ReadAwaiter starts every read of the batch on the executor and
+// suspends the coroutine until all of them hold their results
+class ReadAwaiter
+{
+public:
+    ReadAwaiter(Executor &executor, std::vector<ReadRequest> &requests) : executor(executor), requests(requests) {}
+
+    bool await_ready() const { return requests.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> caller)
+    {
+        // One extra count held while the reads start, so a read completing
+        // meanwhile cannot resume the coroutine under this loop
+        remaining = requests.size() + 1;
+        for (ReadRequest &request : requests)
+        {
+            executor.read(request, [this, caller]()
+                          {
+                              if (--remaining == 0)
+                              {
+                                  caller.resume();
+                              } });
+        }
+        return --remaining != 0; // Every read already completed: carry on without suspending
+    }
+
+    void await_resume() const {}
+
+private:
+    Executor &executor;
+    std::vector<ReadRequest> &requests;
+    std::atomic<size_t> remaining{0};
+};
+
+#endif // TASK_H
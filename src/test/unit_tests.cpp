@@ -8,7 +8,30 @@
 #include "../bloomfilter/bloomfilter.h"
 #include "../bufferpool/HashMap.h"
 #include "../bufferpool/bufferpool.h"
+#include "../sst/sstreader.h"
+#include "../compression/compression.h"
 #include "../kvstore.h"
+#include "../sst/sstwriter.h"
+#include "../sst/sstiterator.h"
+#include "../lsmtree/compaction.h"
+#include "../lsmtree/manifest.h"
+#include "../lsmtree/threadpool.h"
+#include "../sst/ratelimiter.h"
+#include "../sst/ioqueue.h"
+#include "../sst/readahead.h"
+#include "../executor.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <numeric>
+#include <future>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 int runTest(const std::string &testName, bool (*testFunction)())
 {
@@ -32,6 +55,140 @@ bool testPageAddEntry()
     return result && page.numEntries == 1;
 }
 
+bool testPackedPageRoundTrip()
+{
+    Page packed(PageFormat::Packed);
+    Page slotted;
+
+    // Dense keys and values pack into far fewer bits than the 20-byte slotted entries
+    Page dense(PageFormat::Packed);
+    int64_t key = 0;
+    while (dense.addEntry(key, key * 10))
+    {
+        key += 2;
+    }
+    while (slotted.addEntry(key, key))
+    {
+        key += 2;
+    }
+    if (dense.numEntries < 3 * slotted.numEntries)
+        return false;
+
+    // A tombstone widens the value column to 64 bits but still decodes exactly
+    key = 1000000;
+    while (packed.addEntry(key, key % 7 == 0 ? TOMBSTONE : key * 10))
+    {
+        key += 2;
+    }
+
+    packed.finalize();
+    const char *buffer = packed.data.data();
+    if (!Page::isPacked(buffer) || Page::isPacked(slotted.data.data()) || Page::readNumEntries(buffer) != packed.numEntries)
+        return false;
+
+    // Every key is found with its value, and gaps are not
+    for (int i = 0; i < packed.numEntries; ++i)
+    {
+        int64_t k = 1000000 + 2 * i;
+        int64_t value;
+        if (!Page::search(buffer, k, value) || value != (k % 7 == 0 ? TOMBSTONE : k * 10))
+            return false;
+        if (Page::search(buffer, k + 1, value))
+            return false;
+    }
+
+    // Range scans decode exactly the keys in range
+    std::vector<std::pair<int64_t, int64_t>> result;
+    Page::scan(buffer, 1000101, 1000200, result);
+    if (result.size() != 50 || result.front().first != 1000102 || result.back().first != 1000200)
+        return false;
+
+    result.clear();
+    Page::decode(buffer, result);
+    return (int)result.size() == packed.numEntries && result[1].second == 1000002 * 10;
+}
+
+// testing that the AVX2 and scalar unpacking of packed pages decode the same
+// entries at every column width, including the widths the AVX2 path leaves to the scalar loop
+bool testPackedPageVectorUnpacking()
+{
+    bool hasAVX2 = Page::setVectorUnpacking(true);
+    std::cout << "AVX2 unpacking " << (hasAVX2 ? "available" : "not available; checking the scalar path only") << std::endl;
+
+    std::mt19937_64 rng(27);
+    bool passed = true;
+    for (int bits : {0, 1, 3, 7, 13, 31, 55, 56, 57, 63, 64})
+    {
+        uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        Page page(PageFormat::Packed);
+        std::vector<std::pair<int64_t, int64_t>> expected;
+        int64_t key = -1000;
+        int64_t value = static_cast<int64_t>(rng() & mask) - 500;
+        while (page.addEntry(key, value))
+        {
+            expected.emplace_back(key, value);
+            key += 1 + static_cast<int64_t>(rng() % (1ULL << (bits % 20)));
+            value = static_cast<int64_t>(rng() & mask) - 500;
+        }
+        page.finalize();
+
+        // Scans start at an unaligned index, so runs of four straddle the words of the column
+        size_t first = expected.size() / 3 + 1, last = 2 * expected.size() / 3;
+        std::vector<std::pair<int64_t, int64_t>> inRange(expected.begin() + first, expected.begin() + last + 1);
+        std::vector<std::pair<int64_t, int64_t>> decoded[2], scanned[2];
+        for (int vector = 0; vector < 2; ++vector)
+        {
+            Page::setVectorUnpacking(vector == 1);
+            Page::decode(page.data.data(), decoded[vector]);
+            Page::scan(page.data.data(), expected[first].first, expected[last].first, scanned[vector]);
+        }
+        passed = passed && decoded[0] == expected && decoded[1] == expected && scanned[0] == inRange && scanned[1] == inRange;
+    }
+    Page::setVectorUnpacking(true);
+    return passed;
+}
+
+bool testCompressionRoundTrip()
+{
+    // Repetitive data shrinks and decompresses exactly
+    std::vector<char> page(PAGE_SIZE);
+    for (int i = 0; i < PAGE_SIZE; ++i)
+    {
+        page[i] = static_cast<char>((i / 8) % 16);
+    }
+    std::vector<char> compressed;
+    compressBlock(page.data(), page.size(), compressed);
+    if (compressed.size() >= page.size() / 4)
+        return false;
+
+    std::vector<char> restored(PAGE_SIZE);
+    decompressBlock(compressed.data(), compressed.size(), restored.data(), restored.size());
+    if (restored != page)
+        return false;
+
+    // Random data survives the round trip even though it does not shrink
+    srand(42);
+    for (auto &byte : page)
+    {
+        byte = static_cast<char>(rand());
+    }
+    compressBlock(page.data(), page.size(), compressed);
+    decompressBlock(compressed.data(), compressed.size(), restored.data(), restored.size());
+    if (restored != page)
+        return false;
+
+    // Truncated blocks are rejected
+    try
+    {
+        decompressBlock(compressed.data(), compressed.size() / 2, restored.data(), restored.size());
+    }
+    catch (const std::runtime_error &)
+    {
+        return true;
+    }
+    return false;
+}
+
 bool testSSTMetadata()
 {
     SST sst;
@@ -43,6 +200,316 @@ bool testSSTMetadata()
     return (sst.numEntries == 2 && sst.numPages == 1);
 }
 
+bool testSSTFencePointers()
+{
+    // Build an SST with several full pages
+    SST sst;
+    Page page;
+    std::vector<int64_t> startingKeys;
+    for (int64_t key = 0; key < 1000; ++key)
+    {
+        if (!page.addEntry(key * 2, key))
+        {
+            startingKeys.push_back(page.startingKey);
+            sst.addPage(page);
+            page = Page();
+            page.addEntry(key * 2, key);
+        }
+    }
+    startingKeys.push_back(page.startingKey);
+    sst.addPage(page);
+    sst.writeToFile("test_fence.sst");
+
+    // The fence pointers are loaded from the footer when the SST is opened
+    bool passed = true;
+    {
+        SSTReader reader("test_fence.sst");
+        passed = reader.numPages == sst.numPages && reader.fencePointers == startingKeys;
+
+        // Every key maps to the page whose fence pointer precedes it
+        passed = passed && reader.findPage(-1) == -1 && reader.findPage(2000) == -1;
+        for (size_t i = 0; passed && i < startingKeys.size(); ++i)
+        {
+            passed = reader.findPage(startingKeys[i]) == (int)i && reader.findPage(startingKeys[i] + 1) == (int)i;
+        }
+    }
+
+    std::remove("test_fence.sst");
+    return passed;
+}
+
+bool testSSTFooter()
+{
+    // Enough pages that the fence pointers do not fit in the first tail read
+    SST sst;
+    int numPages = 2500;
+    for (int64_t key = 0; key < numPages; ++key)
+    {
+        Page page;
+        page.addEntry(key * 10, key);
+        sst.addPage(page);
+    }
+    sst.writeToFile("test_footer.sst");
+
+    bool passed = true;
+    {
+        SSTReader reader("test_footer.sst");
+        passed = reader.numEntries == numPages && reader.numPages == numPages &&
+                 reader.startingKey == 0 && reader.endingKey == (numPages - 1) * 10 &&
+                 reader.filterOffset == SST_METADATA_SIZE && reader.filterSize == PAGE_SIZE &&
+                 reader.dataOffset == alignUp(SST_METADATA_SIZE + PAGE_SIZE) &&
+                 reader.getDataEndOffset() == reader.dataOffset + (off_t)numPages * PAGE_SIZE &&
+                 reader.fencePointers.back() == (numPages - 1) * 10;
+
+        // The last page is found through the geometry recorded in the footer
+        char buffer[PAGE_SIZE];
+        int64_t value = 0;
+        reader.readBlock(reader.getPageOffset(numPages - 1), buffer);
+        passed = passed && Page::search(buffer, (numPages - 1) * 10, value) && value == numPages - 1;
+    }
+
+    // Files written by a newer format version are rejected
+    {
+        std::fstream file("test_footer.sst", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-(std::streamoff)(2 * sizeof(uint32_t)), std::ios::end);
+        uint32_t version = SST_FORMAT_VERSION + 1;
+        file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    }
+    try
+    {
+        SSTReader reader("test_footer.sst");
+        passed = false;
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+
+    std::remove("test_footer.sst");
+    return passed;
+}
+
+bool testCompactionJob()
+{
+    // Three overlapping inputs, oldest first: multiples of 2, 3 and 5 below 3000
+    std::vector<std::string> names = {"test_merge_0.sst", "test_merge_1.sst", "test_merge_2.sst"};
+    int64_t steps[] = {2, 3, 5};
+    for (int i = 0; i < 3; ++i)
+    {
+        SSTWriter writer(names[i], i == 1 ? CompressionType::LZ4 : CompressionType::None);
+        for (int64_t key = 0; key < 3000; key += steps[i])
+        {
+            // The newest input deletes multiples of 25
+            writer.add(key, i == 2 && key % 25 == 0 ? TOMBSTONE : key * 10 + i);
+        }
+        writer.finish();
+    }
+
+    // The newest input counts its tombstones in its stats
+    bool passed = SSTReader(names[2]).numTombstones == 120;
+
+    // Without older SSTs every tombstone is dropped; SSTs below [0, 1499] keep those in range
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        bool dropTombstones = mode > 0;
+        int64_t olderEnd = mode == 2 ? 1499 : -1;
+        std::vector<std::shared_ptr<SSTReader>> inputs;
+        for (const auto &name : names)
+        {
+            inputs.push_back(std::make_shared<SSTReader>(name));
+        }
+
+        CompactionOptions options;
+        options.compression = CompressionType::LZ4;
+        options.dropTombstones = dropTombstones;
+        if (mode == 2)
+        {
+            options.olderKeyRanges = {{700, 1499}, {0, 999}};
+        }
+        CompactionJob job(inputs, []() { return std::string("test_merged.sst"); }, options);
+        passed = passed && job.run().size() == 1 && job.inputEntries == 1500 + 1000 + 600;
+
+        // Read the output back in small batches so page reads cross batch boundaries
+        SSTIterator it(std::make_shared<SSTReader>("test_merged.sst"), PAGE_SIZE);
+        int64_t count = 0;
+        for (int64_t key = 0; key < 3000; ++key)
+        {
+            int newest = key % 5 == 0 ? 2 : key % 3 == 0 ? 1 : key % 2 == 0 ? 0 : -1;
+            if (newest == -1 || (dropTombstones && key % 25 == 0 && key > olderEnd))
+                continue;
+            int64_t expected = newest == 2 && key % 25 == 0 ? TOMBSTONE : key * 10 + newest;
+            passed = passed && it.valid() && it.key() == key && it.value() == expected;
+            it.next();
+            ++count;
+        }
+        passed = passed && !it.valid() && job.outputEntries == count &&
+                 job.droppedTombstones == (dropTombstones ? 120 - (olderEnd + 1) / 25 : 0) &&
+                 SSTReader("test_merged.sst").numTombstones == 120 - job.droppedTombstones;
+        std::remove("test_merged.sst");
+    }
+
+    // A target below the header and filter size still fills a page per output
+    {
+        std::vector<std::shared_ptr<SSTReader>> inputs;
+        for (const auto &name : names)
+        {
+            inputs.push_back(std::make_shared<SSTReader>(name));
+        }
+        CompactionOptions options;
+        options.targetFileSize = PAGE_SIZE;
+        int outputCount = 0;
+        CompactionJob job(inputs, [&]() { return "test_split_" + std::to_string(outputCount++) + ".sst"; }, options);
+        std::vector<std::string> outputs = job.run();
+        passed = passed && outputs.size() > 1 && static_cast<int64_t>(outputs.size()) < job.outputEntries / 100;
+        for (const auto &output : outputs)
+        {
+            passed = passed && SSTReader(output).numPages >= 1;
+            std::remove(output.c_str());
+        }
+    }
+
+    for (const auto &name : names)
+    {
+        std::remove(name.c_str());
+    }
+    return passed;
+}
+
+bool testParallelSubcompactions()
+{
+    // Four overlapping inputs, oldest first, spanning about 100 pages together
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<SSTReader>> inputs;
+    for (int i = 0; i < 4; ++i)
+    {
+        names.push_back("test_subcompaction_" + std::to_string(i) + ".sst");
+        SSTWriter writer(names.back(), CompressionType::None, PAGE_SIZE, PageFormat::Slotted);
+        for (int64_t key = i; key < 20000; key += 4 - i)
+        {
+            writer.add(key, key * 10 + i);
+        }
+        writer.finish();
+        inputs.push_back(std::make_shared<SSTReader>(names.back()));
+    }
+
+    ThreadPool pool(4);
+    int outputCounter = 0;
+    CompactionOptions options;
+    options.targetFileSize = 8 * PAGE_SIZE;
+    options.maxSubcompactions = 4;
+    options.threadPool = &pool;
+    CompactionJob job(inputs, [&outputCounter]()
+                      { return "test_subcompaction_out_" + std::to_string(outputCounter++) + ".sst"; }, options);
+    std::vector<std::string> outputs = job.run();
+    bool passed = job.subcompactions == 4 && job.outputEntries == 20000;
+
+    // The outputs have disjoint key ranges in order and hold the newest version of every key
+    int64_t expectedKey = 0;
+    for (const auto &output : outputs)
+    {
+        for (SSTIterator it(std::make_shared<SSTReader>(output)); it.valid(); it.next(), ++expectedKey)
+        {
+            int64_t newest = std::min<int64_t>(expectedKey, 3); // The newest input holds every key from 3 on
+            passed = passed && it.key() == expectedKey && it.value() == expectedKey * 10 + newest;
+        }
+        std::remove(output.c_str());
+    }
+    passed = passed && expectedKey == 20000;
+
+    // A failing range leaves no output behind
+    outputCounter = 0;
+    CompactionJob failing(inputs, [&outputCounter]()
+                          {
+                              if (outputCounter == 2)
+                                  throw std::runtime_error("No space left for outputs");
+                              return "test_subcompaction_out_" + std::to_string(outputCounter++) + ".sst"; },
+                          options);
+    bool threw = false;
+    try
+    {
+        failing.run();
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    passed = passed && threw;
+    for (int i = 0; i < 2; ++i)
+    {
+        passed = passed && !std::filesystem::exists("test_subcompaction_out_" + std::to_string(i) + ".sst");
+    }
+
+    inputs.clear();
+    for (const auto &name : names)
+    {
+        std::remove(name.c_str());
+    }
+    return passed;
+}
+
+bool testRateLimiter()
+{
+    using namespace std::chrono;
+
+    // 1 MB/s: after the first request every 100 KB waits about 0.1 s for tokens
+    RateLimiter limiter(1 << 20);
+    auto start = steady_clock::now();
+    for (int i = 0; i < 5; ++i)
+    {
+        limiter.request(100 << 10, IOPriority::Low);
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    RateLimiterStats low = limiter.getStats(IOPriority::Low);
+    bool passed = elapsed > 0.3 && low.bytes == 5 * (100 << 10) && low.requests == 5 && low.throttledMicros > 0;
+
+    // Flushes finish first even when compaction I/O queued up before them
+    steady_clock::time_point lowDone, highDone;
+    std::thread compaction([&]()
+                           {
+                               for (int i = 0; i < 8; ++i)
+                                   limiter.request(100 << 10, IOPriority::Low);
+                               lowDone = steady_clock::now(); });
+    std::this_thread::sleep_for(milliseconds(20));
+    for (int i = 0; i < 3; ++i)
+    {
+        limiter.request(100 << 10, IOPriority::High);
+    }
+    highDone = steady_clock::now();
+    compaction.join();
+    passed = passed && highDone < lowDone && limiter.getStats(IOPriority::High).bytes == 3 * (100 << 10);
+
+    // Auto-tuning backs off while foreground latency is high and recovers after
+    limiter.setAutoTune(true, 100 << 10);
+    for (int i = 0; i < 50; ++i)
+    {
+        limiter.recordForegroundLatency(microseconds(100));
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        std::this_thread::sleep_for(milliseconds(110));
+        limiter.recordForegroundLatency(microseconds(5000));
+    }
+    int64_t throttled = limiter.getBytesPerSecond();
+    passed = passed && throttled < (1 << 20) && throttled >= (100 << 10);
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int j = 0; j < 20; ++j)
+        {
+            limiter.recordForegroundLatency(microseconds(50));
+        }
+        std::this_thread::sleep_for(milliseconds(110));
+        limiter.recordForegroundLatency(microseconds(50));
+    }
+    passed = passed && limiter.getBytesPerSecond() > throttled;
+
+    // Runtime changes apply immediately; 0 turns throttling off
+    limiter.setAutoTune(false, 0);
+    limiter.setBytesPerSecond(0);
+    start = steady_clock::now();
+    limiter.request(100 << 20, IOPriority::Low);
+    passed = passed && duration<double>(steady_clock::now() - start).count() < 0.05;
+    return passed;
+}
+
 bool testAVLTreeInitialization()
 {
     AVLTree tree(10);                  // Initialize with a max size of 10
@@ -538,6 +1005,1423 @@ bool testKVStore()
     return true; // all tests passed
 }
 
+// testing point lookups and scans over multi-page SSTs
+bool testKVStoreMultiPageSST(PageFormat format, CompressionType compression = CompressionType::None, int blockSize = PAGE_SIZE)
+{
+    std::filesystem::remove_all("../test_db_pages");
+
+    KVStore kvStore(1000);
+    kvStore.SetPageFormat(format);
+    kvStore.SetCompression(compression);
+    kvStore.SetBlockSize(blockSize);
+    kvStore.Open("test_db_pages");
+
+    // Two flushes of 1000 entries each span several pages per SST
+    for (int64_t key = 0; key < 2000; ++key)
+    {
+        kvStore.Put(key * 3, key);
+    }
+
+    for (bool useBTree : {false, true})
+    {
+        kvStore.SetUseBTree(useBTree);
+        for (int64_t key = 0; key < 2000; key += 97)
+        {
+            assert(kvStore.Get(key * 3) == key);
+            assert(kvStore.Get(key * 3 + 1) == -1);
+        }
+        assert(kvStore.Get(-3) == -1);
+        assert(kvStore.Get(6000) == -1);
+    }
+
+    int result_count = 0;
+    std::pair<int64_t, int64_t> *results = kvStore.Scan(600, 1500, result_count);
+    assert(result_count == 301);
+    assert(results[0].first == 600 && results[300].first == 1500);
+    delete[] results;
+
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_pages");
+
+    return true;
+}
+
+bool testKVStoreSlottedPages()
+{
+    return testKVStoreMultiPageSST(PageFormat::Slotted);
+}
+
+bool testKVStorePackedPages()
+{
+    return testKVStoreMultiPageSST(PageFormat::Packed);
+}
+
+bool testKVStoreCompressedPages()
+{
+    return testKVStoreMultiPageSST(PageFormat::Slotted, CompressionType::LZ4) &&
+           testKVStoreMultiPageSST(PageFormat::Packed, CompressionType::LZ4);
+}
+
+bool testKVStoreLargeBlocks()
+{
+    // Every SST records its block size; readers honor it regardless of the store setting
+    SST sst(CompressionType::None, 4 * PAGE_SIZE);
+    Page page(PageFormat::Slotted, 4 * PAGE_SIZE);
+    for (int64_t key = 0; page.addEntry(key, key); ++key)
+    {
+    }
+    if (page.numEntries <= 4 * (PAGE_SIZE / 20 - 1))
+        return false;
+    sst.addPage(page);
+    sst.writeToFile("../test_blocks.sst");
+    SSTReader reader("../test_blocks.sst");
+    bool headerOk = reader.blockSize == 4 * PAGE_SIZE && reader.numEntries == page.numEntries;
+    std::remove("../test_blocks.sst");
+    if (!headerOk)
+        return false;
+
+    return testKVStoreMultiPageSST(PageFormat::Slotted, CompressionType::None, 4 * PAGE_SIZE) &&
+           testKVStoreMultiPageSST(PageFormat::Packed, CompressionType::LZ4, MAX_BLOCK_SIZE);
+}
+
+// testing a compaction policy against a reference map
+bool testKVStoreCompactionStyle(CompactionStyle style)
+{
+    std::filesystem::remove_all("../test_db_leveled");
+
+    KVStore kvStore(500, 3);
+    kvStore.SetPageFormat(PageFormat::Slotted); // Larger SSTs, so the data spans several levels
+    kvStore.SetCompactionStyle(style, 8 * PAGE_SIZE);
+    kvStore.SetLevelOptions(1, {2, 4});
+    kvStore.SetMaxSubcompactions(4);
+    kvStore.SetRateLimit(64 << 20, true, 8 << 20);
+    kvStore.Open("test_db_leveled");
+
+    // Random overwrites and deletes spread across many small SSTs
+    std::map<int64_t, int64_t> reference;
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 20000; ++i)
+    {
+        int64_t key = rng() % 8000;
+        if (rng() % 10 == 0)
+        {
+            kvStore.Del(key);
+            reference.erase(key);
+        }
+        else
+        {
+            kvStore.Put(key, i);
+            reference[key] = i;
+        }
+    }
+
+    for (int64_t key = 0; key < 8000; key += 7)
+    {
+        auto it = reference.find(key);
+        assert(kvStore.Get(key) == (it == reference.end() ? -1 : it->second));
+    }
+
+    int result_count = 0;
+    std::pair<int64_t, int64_t> *results = kvStore.Scan(1000, 3000, result_count);
+    auto first = reference.lower_bound(1000), last = reference.upper_bound(3000);
+    assert(result_count == std::distance(first, last));
+    for (int i = 0; first != last; ++first, ++i)
+    {
+        assert(results[i].first == first->first && results[i].second == first->second);
+    }
+    delete[] results;
+
+    // Flush and compaction I/O both went through the rate limiter
+    assert(kvStore.GetRateLimiterStats(IOPriority::High).bytes > 0);
+    assert(kvStore.GetRateLimiterStats(IOPriority::Low).bytes > 0);
+
+    // The levels and the compaction settings survive a reopen by a default-configured store
+    kvStore.Close();
+    ManifestState state;
+    assert(Manifest::replay("../test_db_leveled/MANIFEST", state));
+    assert(state.compactionStyle == style && state.sizeRatio == 3u);
+    assert(state.levelOptions.size() > 1 && state.levelOptions[1].sizeRatio == 2 && state.levelOptions[1].maxRuns == 4);
+
+    KVStore reopened(500);
+    reopened.Open("test_db_leveled");
+    for (int64_t key = 3; key < 8000; key += 11)
+    {
+        auto it = reference.find(key);
+        assert(reopened.Get(key) == (it == reference.end() ? -1 : it->second));
+    }
+
+    // Levels shaped by one policy cannot be read with another
+    bool switched = true;
+    try
+    {
+        reopened.SetCompactionStyle(CompactionStyle::Tiered);
+    }
+    catch (const std::runtime_error &)
+    {
+        switched = false;
+    }
+    assert(!switched);
+
+    reopened.Close();
+    std::filesystem::remove_all("../test_db_leveled");
+
+    return true;
+}
+
+bool testKVStoreLeveledCompaction()
+{
+    return testKVStoreCompactionStyle(CompactionStyle::Leveled);
+}
+
+bool testKVStoreLazyLeveledCompaction()
+{
+    return testKVStoreCompactionStyle(CompactionStyle::LazyLeveled);
+}
+
+// testing manual compaction of a key range and of the whole tree
+bool testKVStoreCompactRange(CompactionStyle style)
+{
+    std::filesystem::remove_all("../test_db_compact_range");
+
+    KVStore kvStore(300, 3);
+    kvStore.SetCompactionStyle(style, 8 * PAGE_SIZE);
+    kvStore.SetMaxSubcompactions(4);
+    kvStore.Open("test_db_compact_range");
+
+    // Mostly ascending keys, so most SSTs cover narrow key ranges, and deletes of older keys
+    std::map<int64_t, int64_t> reference;
+    std::mt19937_64 rng(5);
+    for (int i = 0; i < 12000; ++i)
+    {
+        if (i % 4 == 3)
+        {
+            int64_t key = rng() % (i / 2);
+            kvStore.Del(key);
+            reference.erase(key);
+        }
+        else
+        {
+            int64_t key = i / 2 + rng() % 100;
+            kvStore.Put(key, i);
+            reference[key] = i;
+        }
+    }
+
+    auto matchesReference = [&](KVStore &store)
+    {
+        int count = 0;
+        std::pair<int64_t, int64_t> *results = store.Scan(0, 10000, count);
+        bool matches = count == (int)reference.size();
+        auto it = reference.begin();
+        for (int i = 0; matches && i < count; ++i, ++it)
+        {
+            matches = results[i].first == it->first && results[i].second == it->second;
+        }
+        delete[] results;
+        return matches;
+    };
+
+    CompactRangeStats stats = kvStore.CompactRange(1000, 2000);
+    bool passed = stats.inputFiles > 0 && stats.outputFiles > 0 && stats.bytesRead > 0 &&
+                  stats.bytesWritten > 0 && matchesReference(kvStore);
+
+    // A bulk delete, then a full compaction leaves every SST in the bottom
+    // level and drops the tombstones
+    for (int64_t key = 0; key < 3000; key += 5)
+    {
+        kvStore.Del(key);
+        reference.erase(key);
+    }
+    stats = kvStore.CompactRange();
+    int64_t bottomFiles = 0;
+    for (size_t level = 0; level < stats.levelFiles.size(); ++level)
+    {
+        passed = passed && (level == stats.outputLevel || stats.levelFiles[level] == 0);
+        bottomFiles += stats.levelFiles[level];
+    }
+    passed = passed && stats.outputFiles == (size_t)bottomFiles && stats.droppedTombstones > 0 &&
+             matchesReference(kvStore);
+    if (style == CompactionStyle::Tiered)
+    {
+        passed = passed && bottomFiles == 1; // One new run
+    }
+
+    kvStore.Close();
+    KVStore reopened(300);
+    reopened.Open("test_db_compact_range");
+    passed = passed && matchesReference(reopened);
+    reopened.Close();
+
+    std::filesystem::remove_all("../test_db_compact_range");
+    return passed;
+}
+
+bool testKVStoreCompactRangeTiered()
+{
+    return testKVStoreCompactRange(CompactionStyle::Tiered);
+}
+
+bool testKVStoreCompactRangeLeveled()
+{
+    return testKVStoreCompactRange(CompactionStyle::Leveled);
+}
+
+// testing that the statistics add up to the work flushes and compactions did
+bool testManifestReplay()
+{
+    std::filesystem::remove_all("../test_manifest");
+    std::filesystem::create_directory("../test_manifest");
+    const std::string path = "../test_manifest/MANIFEST";
+
+    VersionEdit snapshot;
+    snapshot.compactionStyle = CompactionStyle::Leveled;
+    snapshot.sizeRatio = 4;
+    snapshot.levelOptions.emplace_back(1, LevelOptions{3, 2});
+    snapshot.addedFiles = {{0, "sst_1.sst"}, {0, "sst_2.sst"}, {1, "sst_3.sst"}};
+    snapshot.fileCounter = 3;
+
+    // An edit survives encoding and decoding
+    std::string buffer;
+    snapshot.encodeTo(buffer);
+    VersionEdit decoded;
+    decoded.decodeFrom(buffer.data(), buffer.size());
+    assert(decoded.compactionStyle == CompactionStyle::Leveled && decoded.sizeRatio == 4u && !decoded.targetFileSize);
+    assert(decoded.addedFiles == snapshot.addedFiles && decoded.fileCounter == 3u);
+    assert(decoded.levelOptions.size() == 1 && decoded.levelOptions[0].second.maxRuns == 2);
+
+    {
+        Manifest manifest(path);
+        manifest.writeSnapshot(snapshot);
+        VersionEdit compaction; // Merge level 0 into level 1
+        compaction.fileCounter = 4;
+        compaction.deletedFiles = {{0, "sst_1.sst"}, {0, "sst_2.sst"}, {1, "sst_3.sst"}};
+        compaction.addedFiles = {{1, "sst_4.sst"}};
+        manifest.append(compaction);
+    }
+
+    // A torn append at the end of the log is ignored
+    std::string good = path + ".good";
+    std::filesystem::copy_file(path, good);
+    {
+        std::ofstream log(path, std::ios::binary | std::ios::app);
+        uint32_t size = 100, checksum = 0;
+        log.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        log.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        log.write("partial", 7);
+    }
+    ManifestState state;
+    assert(Manifest::replay(path, state));
+    assert(state.fileCounter == 4 && state.compactionStyle == CompactionStyle::Leveled);
+    assert(state.levels.size() == 2 && state.levels[0].empty());
+    assert(state.levels[1] == std::vector<std::string>{"sst_4.sst"});
+
+    // A corrupt record followed by more records is an error
+    std::filesystem::copy_file(good, path, std::filesystem::copy_options::overwrite_existing);
+    {
+        Manifest manifest(path);
+        manifest.writeSnapshot(snapshot);
+        VersionEdit flush;
+        flush.addedFiles = {{0, "sst_5.sst"}};
+        manifest.append(flush);
+        manifest.append(flush);
+    }
+    {
+        std::fstream log(path, std::ios::binary | std::ios::in | std::ios::out);
+        log.seekp(12); // Inside the payload of the snapshot
+        log.put('\x7f');
+    }
+    bool threw = false;
+    try
+    {
+        ManifestState corrupt;
+        Manifest::replay(path, corrupt);
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+
+    ManifestState missing;
+    assert(!Manifest::replay("../test_manifest/NONE", missing));
+
+    std::filesystem::remove_all("../test_manifest");
+    return true;
+}
+
+bool testKVStoreCrashRecovery()
+{
+    std::filesystem::remove_all("../test_db_crash");
+
+    {
+        // The store is dropped without Close, as if the process had crashed;
+        // only the memtable is lost. A power loss cannot be simulated here; it
+        // relies on SSTs and their directory being synced before the manifest edit.
+        KVStore kvStore(300);
+        kvStore.SetCompactionStyle(CompactionStyle::Leveled, 8 * PAGE_SIZE);
+        kvStore.Open("test_db_crash");
+        for (int64_t key = 0; key < 3000; ++key)
+        {
+            kvStore.Put(key, key * 2);
+        }
+        for (int64_t key = 0; key < 900; key += 3)
+        {
+            kvStore.Del(key);
+        }
+        for (int64_t key = 3000; key < 3150; ++key)
+        {
+            kvStore.Put(key, key * 2); // Still in the memtable
+        }
+    }
+
+    // An SST whose flush never reached the manifest
+    std::ofstream("../test_db_crash/sst_999999.sst") << "orphan";
+
+    KVStore reopened(300);
+    reopened.Open("test_db_crash");
+    assert(!std::filesystem::exists("../test_db_crash/sst_999999.sst"));
+    for (int64_t key = 0; key < 3150; key += 7)
+    {
+        // Everything flushed before the crash survives it
+        int64_t expected = key >= 3000 ? -1 : key * 2;
+        if (key < 900 && key % 3 == 0)
+        {
+            expected = -1;
+        }
+        assert(reopened.Get(key) == expected);
+    }
+
+    // Every SST left in the directory belongs to the reopened tree
+    size_t sstFiles = 0;
+    for (const auto &entry : std::filesystem::directory_iterator("../test_db_crash"))
+    {
+        sstFiles += entry.path().extension() == ".sst";
+    }
+    std::vector<size_t> levelFiles = reopened.GetStats().levelFiles;
+    assert(sstFiles > 0 && sstFiles == std::accumulate(levelFiles.begin(), levelFiles.end(), size_t(0)));
+
+    reopened.Close();
+    std::filesystem::remove_all("../test_db_crash");
+    return true;
+}
+
+bool testKVStoreStats()
+{
+    std::filesystem::remove_all("../test_db_stats");
+
+    KVStore kvStore(300);
+    kvStore.SetCompactionStyle(CompactionStyle::Leveled, 8 * PAGE_SIZE);
+    kvStore.SetMaxSubcompactions(2);
+    kvStore.Open("test_db_stats");
+
+    std::mt19937_64 rng(3);
+    const int operations = 10000;
+    for (int i = 0; i < operations; ++i)
+    {
+        int64_t key = rng() % 3000;
+        if (i % 5 == 4)
+        {
+            kvStore.Del(key);
+        }
+        else
+        {
+            kvStore.Put(key, i);
+        }
+    }
+
+    KVStoreStats stats = kvStore.GetStats();
+    bool passed = stats.userBytesWritten == operations * 16 && stats.flushes == operations / 300 &&
+                  stats.flushBytesWritten > 0 && stats.levelFiles.size() == stats.compactions.size();
+
+    LevelCompactionStats total;
+    for (const auto &level : stats.compactions)
+    {
+        passed = passed && level.entriesIn >= level.entriesOverwritten + level.tombstonesDropped &&
+                 (level.compactions > 0 || level.bytesWritten == 0);
+        total.compactions += level.compactions;
+        total.bytesWritten += level.bytesWritten;
+        total.bytesRead += level.bytesRead;
+        total.entriesOverwritten += level.entriesOverwritten;
+        total.cpuMicros += level.cpuMicros;
+    }
+    passed = passed && total.compactions > 0 && total.bytesRead > 0 && total.entriesOverwritten > 0 &&
+             total.cpuMicros > 0 && stats.compactions[0].compactions == 0; // Nothing compacts into level 0
+
+    double expected = static_cast<double>(stats.flushBytesWritten + total.bytesWritten) / stats.userBytesWritten;
+    passed = passed && std::abs(stats.writeAmplification - expected) < 1e-9 && stats.spaceAmplification >= 1;
+
+    // After a full compaction every SST is in the last level
+    CompactRangeStats compacted = kvStore.CompactRange();
+    KVStoreStats after = kvStore.GetStats();
+    passed = passed && after.spaceAmplification == 1.0 &&
+             after.compactions[compacted.outputLevel].compactions > stats.compactions[compacted.outputLevel].compactions &&
+             after.writeAmplification > stats.writeAmplification;
+
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_stats");
+    return passed;
+}
+
+bool testTrivialMoveCompaction()
+{
+    std::filesystem::remove_all("../test_db_levels");
+    std::filesystem::create_directory("../test_db_levels");
+
+    LSMTree tree("../test_db_levels", 4);
+    tree.setCompactionStyle(CompactionStyle::Leveled);
+    tree.setTargetFileSize(4 * PAGE_SIZE);
+
+    // Time-ordered keys: every flush covers a key range after all earlier ones
+    for (int64_t flush = 0; flush < 40; ++flush)
+    {
+        SSTWriter writer(tree.newSSTFilename());
+        for (int64_t key = flush * 1000; key < flush * 1000 + 1000; ++key)
+        {
+            writer.add(key, flush);
+        }
+        writer.finish();
+        tree.addSST(writer.filename);
+    }
+
+    // Every compaction was a move, so no SST was written besides the 40 flushes
+    size_t numFiles = 0;
+    for (size_t level = 0; level < tree.getNumLevels(); ++level)
+    {
+        numFiles += tree.getLevelFileCount(level);
+    }
+    bool passed = tree.getNumLevels() > 2 && tree.getFileCounter() == 40 && numFiles == 40;
+    for (size_t level = 1; level < tree.getNumLevels(); ++level)
+    {
+        std::vector<std::string> files = tree.getSSTFilesByLevel(level);
+        for (size_t i = 1; i < files.size(); ++i)
+        {
+            passed = passed && tree.getSSTReader(files[i - 1])->endingKey < tree.getSSTReader(files[i])->startingKey;
+        }
+    }
+
+    tree.clearLevels();
+    std::filesystem::remove_all("../test_db_levels");
+    return passed;
+}
+
+bool testWriteStallLimits()
+{
+    std::filesystem::remove_all("../test_db_levels");
+    std::filesystem::create_directory("../test_db_levels");
+
+    LSMTree tree("../test_db_levels", 4);
+    tree.setCompactionStyle(CompactionStyle::Leveled);
+    tree.setTargetFileSize(4 * PAGE_SIZE);
+
+    // Restored SSTs are not compacted, so level 1 starts far over its limit
+    for (int64_t file = 0; file < 6; ++file)
+    {
+        SSTWriter writer(tree.newSSTFilename(), CompressionType::None, PAGE_SIZE, PageFormat::Slotted);
+        for (int64_t key = file * 2000; key < file * 2000 + 2000; ++key)
+        {
+            writer.add(key, file);
+        }
+        writer.finish();
+        tree.addSSTToLevel(writer.filename, 1);
+    }
+    int64_t pending = tree.getPendingCompactionBytes();
+    bool passed = pending > 0 && tree.getWriteStallCondition() == WriteStallCondition::Normal;
+
+    WriteStallOptions options;
+    options.softPendingCompactionBytes = pending;
+    tree.setWriteStallOptions(options);
+    passed = passed && tree.getWriteStallCondition() == WriteStallCondition::Delayed;
+
+    // Without a background thread a stopped writer compacts the tree itself
+    options.hardPendingCompactionBytes = pending;
+    tree.setWriteStallOptions(options);
+    passed = passed && tree.getWriteStallCondition() == WriteStallCondition::Stopped;
+    tree.throttleWrite(16);
+    passed = passed && tree.getWriteStallCondition() == WriteStallCondition::Normal &&
+             tree.getPendingCompactionBytes() == 0 && tree.getWriteStallStats().stoppedWrites == 1;
+
+    tree.clearLevels();
+    std::filesystem::remove_all("../test_db_levels");
+    return passed;
+}
+
+// testing background compaction with writes held back by the level 0 limits
+bool testKVStoreBackgroundCompaction()
+{
+    std::filesystem::remove_all("../test_db_background");
+
+    KVStore kvStore(200);
+    kvStore.SetCompactionStyle(CompactionStyle::Leveled, 8 * PAGE_SIZE);
+    kvStore.SetRateLimit(4 << 20); // Slow compactions down so that level 0 fills up
+    WriteStallOptions options;
+    options.l0SlowdownFiles = 3;
+    options.l0StopFiles = 5;
+    options.delayedWriteRate = 256 << 10;
+    kvStore.SetWriteStallOptions(options);
+    kvStore.SetBackgroundCompaction(true);
+    kvStore.Open("test_db_background");
+
+    // Lookups and scans run while compactions replace the SSTs they read
+    std::map<int64_t, int64_t> reference;
+    std::mt19937_64 rng(11);
+    for (int i = 0; i < 10000; ++i)
+    {
+        int64_t key = rng() % 4000;
+        kvStore.Put(key, i);
+        reference[key] = i;
+        if (i % 100 == 99)
+        {
+            int64_t probe = rng() % 4000;
+            auto it = reference.find(probe);
+            assert(kvStore.Get(probe) == (it == reference.end() ? -1 : it->second));
+
+            int result_count = 0;
+            std::pair<int64_t, int64_t> *results = kvStore.Scan(probe, probe + 50, result_count);
+            assert(result_count == std::distance(reference.lower_bound(probe), reference.upper_bound(probe + 50)));
+            delete[] results;
+        }
+    }
+    WriteStallStats stats = kvStore.GetWriteStallStats();
+    assert(stats.delayedWrites + stats.stoppedWrites > 0);
+
+    for (int64_t key = 1; key < 4000; key += 17)
+    {
+        auto it = reference.find(key);
+        assert(kvStore.Get(key) == (it == reference.end() ? -1 : it->second));
+    }
+    kvStore.SetBackgroundCompaction(false);
+
+    kvStore.Close();
+    kvStore.Open("test_db_background");
+    for (int64_t key = 0; key < 4000; key += 13)
+    {
+        auto it = reference.find(key);
+        assert(kvStore.Get(key) == (it == reference.end() ? -1 : it->second));
+    }
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_background");
+    return true;
+}
+
+// testing that readers see every acknowledged write while several writers
+// and a background compaction change the store
+bool testKVStoreConcurrentAccess()
+{
+    std::filesystem::remove_all("../test_db_concurrent");
+
+    KVStore kvStore(250);
+    kvStore.SetCompactionStyle(CompactionStyle::Leveled, 8 * PAGE_SIZE);
+    kvStore.SetBackgroundCompaction(true);
+    kvStore.Open("test_db_concurrent");
+
+    const int numWriters = 4, writesPerThread = 2500;
+    std::atomic<int> acknowledged[numWriters];
+    for (auto &count : acknowledged)
+    {
+        count = 0;
+    }
+    std::atomic<bool> writing{true};
+    std::atomic<int> failures{0};
+
+    // Writer t owns the keys t, t + numWriters, ...; the value of its i-th key is i
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numWriters; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            for (int i = 0; i < writesPerThread; ++i)
+            {
+                kvStore.Put(static_cast<int64_t>(i) * numWriters + t, i);
+                acknowledged[t] = i + 1;
+            } });
+    }
+    for (int r = 0; r < 3; ++r)
+    {
+        threads.emplace_back([&, r]
+                             {
+            std::mt19937_64 rng(r);
+            while (writing)
+            {
+                int t = rng() % numWriters;
+                int written = acknowledged[t];
+                if (written == 0)
+                {
+                    continue;
+                }
+                int i = rng() % written;
+                if (kvStore.Get(static_cast<int64_t>(i) * numWriters + t) != i)
+                {
+                    failures++;
+                }
+
+                // A scan sees at least the keys acknowledged before it started
+                int64_t start = static_cast<int64_t>(i) * numWriters;
+                int before = acknowledged[0];
+                int result_count = 0;
+                std::pair<int64_t, int64_t> *results = kvStore.Scan(start, start + 40, result_count);
+                int expected = 0;
+                for (int64_t key = start; key <= start + 40; key += numWriters)
+                {
+                    expected += key / numWriters < before;
+                }
+                int seen = 0;
+                for (int k = 0; k < result_count; ++k)
+                {
+                    seen += results[k].first % numWriters == 0;
+                    if (results[k].second != results[k].first / numWriters)
+                    {
+                        failures++;
+                    }
+                }
+                if (seen < expected)
+                {
+                    failures++;
+                }
+                delete[] results;
+            } });
+    }
+    for (int t = 0; t < numWriters; ++t)
+    {
+        threads[t].join();
+    }
+    writing = false;
+    for (size_t i = numWriters; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+    assert(failures == 0);
+
+    KVStoreStats stats = kvStore.GetStats();
+    assert(stats.writes == numWriters * writesPerThread);
+    assert(stats.writeGroups > 0 && stats.writeGroups <= stats.writes);
+
+    kvStore.Close();
+    kvStore.Open("test_db_concurrent");
+    for (int64_t key = 0; key < numWriters * writesPerThread; key += 7)
+    {
+        assert(kvStore.Get(key) == key / numWriters);
+    }
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_concurrent");
+    return true;
+}
+
+// testing that MultiGet agrees with Get across the memtable, overlapping and sorted levels
+bool testKVStoreMultiGet(CompactionStyle style)
+{
+    std::filesystem::remove_all("../test_db_multiget");
+
+    KVStore kvStore(200);
+    kvStore.SetCompactionStyle(style, 8 * PAGE_SIZE);
+    kvStore.Open("test_db_multiget");
+
+    std::mt19937_64 rng(5);
+    for (int i = 0; i < 6000; ++i)
+    {
+        int64_t key = rng() % 3000;
+        if (i % 6 == 5)
+        {
+            kvStore.Del(key);
+        }
+        else
+        {
+            kvStore.Put(key, i);
+        }
+    }
+
+    // Duplicates, keys never written and keys outside every SST included
+    std::vector<int64_t> keys;
+    for (int i = 0; i < 400; ++i)
+    {
+        keys.push_back(static_cast<int64_t>(rng() % 3200) - 100);
+    }
+    keys.push_back(keys[7]);
+    keys.push_back(keys[0]);
+
+    std::vector<int64_t> values = kvStore.MultiGet(keys);
+    assert(values.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        assert(values[i] == kvStore.Get(keys[i]));
+    }
+    assert(kvStore.MultiGet({}).empty());
+
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_multiget");
+    return true;
+}
+
+bool testKVStoreMultiGetTiered()
+{
+    return testKVStoreMultiGet(CompactionStyle::Tiered);
+}
+
+bool testKVStoreMultiGetLeveled()
+{
+    return testKVStoreMultiGet(CompactionStyle::Leveled);
+}
+
+// testing that an I/O queue reads what pread reads, with and without io_uring
+bool testIOQueueReads()
+{
+    std::string path = "../test_ioqueue.bin";
+    std::vector<char> data(300 * 1000);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<char>(i * 31 + i / 7);
+    }
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(data.data(), data.size());
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    assert(fd != -1);
+
+    IOQueue ring(8); // Fewer entries than requests, so reads are submitted in rounds
+    IOQueue fallback(8, false);
+    assert(!fallback.usesIOUring());
+    for (IOQueue *queue : {&ring, &fallback})
+    {
+        std::vector<std::vector<char>> buffers(50, std::vector<char>(4000));
+        std::vector<ReadRequest> requests;
+        for (size_t i = 0; i < buffers.size(); ++i)
+        {
+            requests.push_back({fd, buffers[i].data(), buffers[i].size(), static_cast<off_t>((i * 7919) % 290000)});
+        }
+        requests.back().offset = data.size() - 1000; // Short read at the end of the file
+        queue->readAll(requests);
+
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            size_t expected = std::min<size_t>(requests[i].size, data.size() - requests[i].offset);
+            assert(requests[i].result == (ssize_t)expected);
+            assert(std::memcmp(buffers[i].data(), data.data() + requests[i].offset, expected) == 0);
+        }
+    }
+
+    close(fd);
+    std::filesystem::remove(path);
+    return true;
+}
+
+// testing that read-ahead grows with sequential reads, stops at its limit and resets on random reads
+bool testReadAhead()
+{
+    const off_t limit = 2 * 1024 * 1024;
+    ReadAhead readAhead(-1, limit, 64 * 1024); // posix_fadvise on a bad descriptor fails harmlessly
+
+    readAhead.onRead(0, 8192);
+    assert(readAhead.getWindow() == 0); // One read is not yet sequential
+
+    readAhead.onRead(8192, 8192);
+    assert(readAhead.getWindow() == 8192);
+    assert(readAhead.getPrefetchedUntil() == 16384 + 8192);
+
+    off_t offset = 16384;
+    size_t windows[] = {16384, 32768, 65536, 65536};
+    for (size_t window : windows)
+    {
+        readAhead.onRead(offset, 8192);
+        offset += 8192;
+        assert(readAhead.getWindow() == window);
+        assert(readAhead.getPrefetchedUntil() == offset + static_cast<off_t>(window));
+    }
+
+    // Reads past the prefetched range keep the window but never prefetch past the limit
+    readAhead.onRead(offset, limit - offset - 4096);
+    assert(readAhead.getPrefetchedUntil() == limit);
+
+    readAhead.onRead(4096, 8192);
+    assert(readAhead.getWindow() == 0);
+    readAhead.onRead(12288, 8192);
+    assert(readAhead.getWindow() == 8192);
+    return true;
+}
+
+// testing that scans and MultiGet return the same with reads issued together or one at a time
+bool testKVStoreAsyncIO()
+{
+    std::filesystem::remove_all("../test_db_asyncio");
+
+    KVStore kvStore(300);
+    kvStore.SetCompression(CompressionType::LZ4);
+    kvStore.Open("test_db_asyncio");
+    for (int64_t key = 0; key < 4000; ++key)
+    {
+        kvStore.Put((key * 37) % 4000, key % 50);
+    }
+    for (int64_t key = 0; key < 4000; key += 9)
+    {
+        kvStore.Del(key);
+    }
+    std::vector<int64_t> keys;
+    for (int64_t key = -10; key < 4010; key += 3)
+    {
+        keys.push_back(key);
+    }
+
+    std::vector<std::vector<std::pair<int64_t, int64_t>>> scans[2];
+    std::vector<int64_t> values[2];
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        // Reopening gives the SSTs new cache keys, so both passes read from disk
+        kvStore.Close();
+        kvStore.Open("test_db_asyncio");
+        kvStore.SetAsyncIO(pass == 0);
+        for (int64_t start : {-100, 0, 1234, 3990})
+        {
+            int count = 0;
+            std::pair<int64_t, int64_t> *results = kvStore.Scan(start, start + 1500, count);
+            scans[pass].emplace_back(results, results + count);
+            delete[] results;
+        }
+        values[pass] = kvStore.MultiGet(keys);
+    }
+    assert(scans[0] == scans[1]);
+    assert(values[0] == values[1]);
+    assert(scans[0][1].size() == 1501 - 167); // Keys 0..1500 less the deleted multiples of 9
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        assert(values[0][i] == kvStore.Get(keys[i]));
+    }
+
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_asyncio");
+    return true;
+}
+
+// testing that GetAsync and ScanAsync agree with Get and Scan on an event loop and a thread pool
+bool testKVStoreAsyncAPI()
+{
+    std::filesystem::remove_all("../test_db_async_api");
+
+    KVStore kvStore(250);
+    kvStore.SetCompression(CompressionType::LZ4, 1);
+    kvStore.Open("test_db_async_api");
+    std::mt19937_64 rng(11);
+    for (int i = 0; i < 5000; ++i)
+    {
+        int64_t key = rng() % 2500;
+        if (i % 5 == 4)
+        {
+            kvStore.Del(key);
+        }
+        else
+        {
+            kvStore.Put(key, i);
+        }
+    }
+
+    // Every lookup starts before the loop runs, so all of them are in flight together
+    EventLoop loop;
+    std::vector<int64_t> values(2600, -2);
+    for (int64_t key = -50; key < 2550; ++key)
+    {
+        kvStore.GetAsync(key, loop, [&values, key](int64_t value, std::exception_ptr error)
+                         {
+                             assert(!error);
+                             values[key + 50] = value; });
+    }
+    std::vector<std::vector<std::pair<int64_t, int64_t>>> scans(3);
+    const int64_t ranges[3][2] = {{-100, 3000}, {100, 900}, {2400, 2400}};
+    for (int i = 0; i < 3; ++i)
+    {
+        kvStore.ScanAsync(ranges[i][0], ranges[i][1], loop, [&scans, i](std::vector<std::pair<int64_t, int64_t>> results, std::exception_ptr error)
+                          {
+                              assert(!error);
+                              scans[i] = std::move(results); });
+    }
+    loop.run();
+
+    for (int64_t key = -50; key < 2550; ++key)
+    {
+        assert(values[key + 50] == kvStore.Get(key));
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        int count = 0;
+        std::pair<int64_t, int64_t> *results = kvStore.Scan(ranges[i][0], ranges[i][1], count);
+        assert((scans[i] == std::vector<std::pair<int64_t, int64_t>>(results, results + count)));
+        delete[] results;
+    }
+
+    // The same lookups with reads on worker threads
+    ThreadPoolExecutor pool(4);
+    std::atomic<int> mismatches{0};
+    std::atomic<int> remaining{200};
+    std::promise<void> finished;
+    for (int64_t key = 0; key < 2000; key += 10)
+    {
+        kvStore.GetAsync(key, pool, [&, key](int64_t value, std::exception_ptr error)
+                         {
+                             if (error || value != values[key + 50])
+                             {
+                                 mismatches++;
+                             }
+                             if (--remaining == 0)
+                             {
+                                 finished.set_value();
+                             } });
+    }
+    finished.get_future().wait();
+    assert(mismatches == 0);
+
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_async_api");
+    return true;
+}
+
+// testing that mapped SSTs serve the same reads as the buffer pool, in place where uncompressed
+bool testKVStoreMmapReads()
+{
+    std::filesystem::remove_all("../test_db_mmap");
+
+    std::vector<int64_t> keys;
+    for (int64_t key = -20; key < 3020; key += 7)
+    {
+        keys.push_back(key);
+    }
+    std::vector<int64_t> values[2];
+    std::vector<std::pair<int64_t, int64_t>> scans[2];
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        KVStore kvStore(200);
+        kvStore.SetCompression(CompressionType::LZ4, 1); // Level 0 raw, deeper levels compressed
+        kvStore.SetMmapReads(pass == 1);
+        kvStore.Open("test_db_mmap");
+        if (pass == 0)
+        {
+            std::mt19937_64 rng(3);
+            for (int i = 0; i < 6000; ++i)
+            {
+                int64_t key = rng() % 3000;
+                if (i % 7 == 6)
+                {
+                    kvStore.Del(key);
+                }
+                else
+                {
+                    kvStore.Put(key, i);
+                }
+            }
+            kvStore.Close();
+            kvStore.Open("test_db_mmap"); // Lookups below come from SSTs only
+        }
+
+        for (int64_t key : keys)
+        {
+            values[pass].push_back(kvStore.Get(key));
+        }
+        assert(kvStore.MultiGet(keys) == values[pass]);
+        int count = 0;
+        std::pair<int64_t, int64_t> *results = kvStore.Scan(-100, 3100, count);
+        scans[pass].assign(results, results + count);
+        delete[] results;
+        kvStore.SetUseBTree(true); // B-tree nodes are read from the mapping too
+        for (size_t i = 0; i < keys.size(); i += 5)
+        {
+            assert(kvStore.Get(keys[i]) == values[pass][i]);
+        }
+        kvStore.Close();
+    }
+    assert(values[0] == values[1]);
+    assert(scans[0] == scans[1]);
+
+    // A mapped handle serves uncompressed blocks in place and reads the same bytes
+    for (const auto &entry : std::filesystem::directory_iterator("../test_db_mmap"))
+    {
+        if (entry.path().extension() != ".sst")
+        {
+            continue;
+        }
+        SSTReader reader(entry.path().string());
+        std::vector<char> expected(reader.blockSize), mapped(reader.blockSize);
+        reader.readBlock(reader.getPageOffset(0), expected.data());
+        reader.mapFile();
+        assert(reader.isMapped());
+        reader.readBlock(reader.getPageOffset(0), mapped.data());
+        assert(expected == mapped);
+        const char *block = reader.getMappedBlock(reader.getPageOffset(0));
+        assert(reader.compression == CompressionType::None ? block != nullptr : true);
+        assert(!block || std::memcmp(block, expected.data(), reader.blockSize) == 0);
+        assert(reader.getMappedRange(reader.fileSize - 1, 2) == nullptr);
+    }
+
+    std::filesystem::remove_all("../test_db_mmap");
+    return true;
+}
+
+// testing that O_DIRECT reads and writes serve the same data as buffered I/O
+bool testKVStoreDirectIO()
+{
+    std::filesystem::remove_all("../test_db_direct");
+    std::filesystem::remove_all("../test_db_buffered");
+
+    std::vector<int64_t> keys;
+    for (int64_t key = -20; key < 3020; key += 7)
+    {
+        keys.push_back(key);
+    }
+    std::vector<int64_t> values[3];
+    std::vector<std::pair<int64_t, int64_t>> scans[3];
+    for (int pass = 0; pass < 3; ++pass)
+    {
+        // Pass 0 writes and reads buffered, pass 1 direct, pass 2 reads the direct SSTs through the I/O queue
+        std::string name = pass == 0 ? "test_db_buffered" : "test_db_direct";
+        KVStore kvStore(200);
+        kvStore.SetCompression(CompressionType::LZ4, 1); // Level 0 raw, deeper levels compressed
+        kvStore.SetDirectIO(pass > 0);
+        kvStore.SetAsyncIO(pass == 2);
+        kvStore.Open(name);
+        if (pass < 2)
+        {
+            std::mt19937_64 rng(5);
+            for (int i = 0; i < 6000; ++i)
+            {
+                int64_t key = rng() % 3000;
+                if (i % 7 == 6)
+                {
+                    kvStore.Del(key);
+                }
+                else
+                {
+                    kvStore.Put(key, i);
+                }
+            }
+            kvStore.Close();
+            kvStore.Open(name); // Lookups below come from SSTs only
+        }
+
+        for (int64_t key : keys)
+        {
+            values[pass].push_back(kvStore.Get(key));
+        }
+        assert(kvStore.MultiGet(keys) == values[pass]);
+        int count = 0;
+        std::pair<int64_t, int64_t> *results = kvStore.Scan(-100, 3100, count);
+        scans[pass].assign(results, results + count);
+        delete[] results;
+        kvStore.SetUseBTree(true); // B-tree nodes are read directly too
+        for (size_t i = 0; i < keys.size(); i += 5)
+        {
+            assert(kvStore.Get(keys[i]) == values[pass][i]);
+        }
+        kvStore.Close();
+    }
+    assert(values[0] == values[1] && values[0] == values[2]);
+    assert(scans[0] == scans[1] && scans[0] == scans[2]);
+
+    // A direct writer stages unaligned pages and writes the same file as a buffered one
+    std::vector<char> files[2];
+    for (int direct = 0; direct < 2; ++direct)
+    {
+        std::string filename = "../test_db_direct/writer_" + std::to_string(direct) + ".sst";
+        SSTWriter writer(filename, CompressionType::LZ4, 4096);
+        writer.setDirectIO(direct == 1);
+        for (int64_t key = 0; key < 5000; ++key)
+        {
+            writer.add(key, key % 3 == 0 ? key : key * 1000003);
+        }
+        writer.finish();
+        std::ifstream in(filename, std::ios::binary);
+        files[direct].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        assert((int64_t)files[direct].size() == writer.getFileSize());
+    }
+    assert(files[0] == files[1]);
+
+    // Aligned reads cover unaligned ranges and stop at the end of the file
+    SSTReader reader("../test_db_direct/writer_1.sst");
+    reader.openDirect();
+    AlignedBuffer buffer;
+    off_t offset = reader.getPageOffset(1);
+    assert(std::memcmp(reader.readAligned(offset, 100, buffer), files[1].data() + offset, 100) == 0);
+    assert(reinterpret_cast<uintptr_t>(buffer.data()) % DIRECT_IO_ALIGNMENT == 0);
+    offset = reader.fileSize - 10;
+    assert(std::memcmp(reader.readAligned(offset, 10, buffer), files[1].data() + offset, 10) == 0);
+    std::vector<char> expected(reader.blockSize), direct(reader.blockSize);
+    SSTReader buffered("../test_db_direct/writer_1.sst");
+    buffered.readBlock(buffered.getPageOffset(3), expected.data());
+    reader.readBlock(reader.getPageOffset(3), direct.data());
+    assert(expected == direct);
+
+    // Uncompressed pages start on aligned offsets and are read in place into
+    // aligned buffers, or through a bounce buffer into unaligned ones
+    std::string raw = "../test_db_direct/writer_raw.sst";
+    {
+        SSTWriter writer(raw);
+        for (int64_t key = 0; key < 5000; ++key)
+        {
+            writer.add(key, key * 7);
+        }
+        writer.finish();
+    }
+    SSTReader rawBuffered(raw), rawDirect(raw);
+    rawDirect.openDirect();
+    assert(rawDirect.dataOffset % DIRECT_IO_ALIGNMENT == 0 && rawDirect.filterSize < rawDirect.dataOffset);
+    int count = std::min(rawDirect.numPages, 4);
+    std::vector<char> pages(count * rawDirect.blockSize), unaligned(count * rawDirect.blockSize + 1);
+    AlignedBuffer alignedPages(count * rawDirect.blockSize);
+    rawBuffered.readPages(0, count, pages.data());
+    rawDirect.readPages(0, count, alignedPages.data());
+    rawDirect.readPages(0, count, unaligned.data() + 1);
+    assert(std::memcmp(alignedPages.data(), pages.data(), pages.size()) == 0);
+    assert(std::memcmp(unaligned.data() + 1, pages.data(), pages.size()) == 0);
+    AlignedBuffer alignedPage(rawDirect.blockSize);
+    rawDirect.readBlock(rawDirect.getPageOffset(1), alignedPage.data());
+    rawDirect.readBlock(rawDirect.getPageOffset(1), unaligned.data() + 1);
+    assert(std::memcmp(alignedPage.data(), pages.data() + rawDirect.blockSize, rawDirect.blockSize) == 0);
+    assert(std::memcmp(unaligned.data() + 1, pages.data() + rawDirect.blockSize, rawDirect.blockSize) == 0);
+
+    std::filesystem::remove_all("../test_db_direct");
+    std::filesystem::remove_all("../test_db_buffered");
+    return true;
+}
+
+// testing that a batch lands in one memtable and that readers see all of it or none of it
+bool testKVStoreWriteBatch()
+{
+    std::filesystem::remove_all("../test_db_batch");
+
+    KVStore kvStore(300);
+    kvStore.Open("test_db_batch");
+
+    // A memtable without room for a batch is flushed before it, and the batch is one SST
+    for (int64_t key = 0; key < 100; ++key)
+    {
+        kvStore.Put(key, -key);
+    }
+    WriteBatch batch;
+    for (int64_t key = 0; key < 1000; ++key)
+    {
+        batch.Put(key, key * 3);
+    }
+    for (int64_t key = 0; key < 1000; key += 10)
+    {
+        batch.Del(key);
+    }
+    assert(batch.Count() == 1100);
+    kvStore.Write(batch);
+    KVStoreStats stats = kvStore.GetStats();
+    assert(stats.flushes == 2 && stats.writes == 1200 && stats.writeGroups == 101);
+    for (int64_t key = 1; key < 1000; key += 7)
+    {
+        assert(kvStore.Get(key) == (key % 10 == 0 ? -1 : key * 3));
+    }
+
+    // Concurrent scans never see a batch half applied
+    std::atomic<bool> writing{true};
+    std::atomic<int> tornReads{0};
+    std::thread reader([&]
+                       {
+        while (writing)
+        {
+            int result_count = 0;
+            std::pair<int64_t, int64_t> *results = kvStore.Scan(5000, 5099, result_count);
+            for (int i = 1; i < result_count; ++i)
+            {
+                if (results[i].second != results[0].second)
+                {
+                    tornReads++;
+                }
+            }
+            if (result_count != 0 && result_count != 100)
+            {
+                tornReads++;
+            }
+            delete[] results;
+        } });
+    for (int64_t round = 1; round <= 60; ++round)
+    {
+        batch.Clear();
+        for (int64_t key = 5000; key < 5100; ++key)
+        {
+            batch.Put(key, round);
+        }
+        kvStore.Write(batch);
+    }
+    writing = false;
+    reader.join();
+    assert(tornReads == 0);
+    assert(kvStore.Get(5050) == 60);
+
+    kvStore.Close();
+    std::filesystem::remove_all("../test_db_batch");
+    return true;
+}
+
+// testing that a queue-like workload, which deletes every key it inserted,
+// leaves few tombstones behind once the tree is compacted
+bool testTombstoneGarbageCollection()
+{
+    std::filesystem::remove_all("../test_db_levels");
+    std::filesystem::create_directory("../test_db_levels");
+
+    LSMTree tree("../test_db_levels", 4);
+    tree.setCompactionStyle(CompactionStyle::Leveled);
+    tree.setTargetFileSize(4 * PAGE_SIZE);
+
+    // Every flush inserts 500 new keys and deletes the keys inserted `lag` flushes earlier
+    const int64_t batch = 500;
+    const int64_t flushes = 80;
+    const int64_t lag = 12;
+    for (int64_t flush = 0; flush < flushes; ++flush)
+    {
+        SSTWriter writer(tree.newSSTFilename(), CompressionType::None, PAGE_SIZE, PageFormat::Slotted);
+        for (int64_t key = (flush - lag) * batch; key < (flush - lag + 1) * batch && key >= 0; ++key)
+        {
+            writer.add(key, TOMBSTONE);
+        }
+        for (int64_t key = flush * batch; key < (flush + 1) * batch; ++key)
+        {
+            writer.add(key, key);
+        }
+        writer.finish();
+        tree.addSST(writer.filename);
+    }
+
+    int64_t entries = 0, tombstones = 0;
+    for (size_t level = 0; level < tree.getNumLevels(); ++level)
+    {
+        for (const auto &file : tree.getSSTFilesByLevel(level))
+        {
+            entries += tree.openSSTReader(file)->numEntries;
+            tombstones += tree.openSSTReader(file)->numTombstones;
+        }
+    }
+    // The keys of the last `lag` flushes are live; without collection over 30000 tombstones remain
+    bool passed = entries - tombstones >= lag * batch && tombstones <= 6 * batch;
+
+    tree.clearLevels();
+    std::filesystem::remove_all("../test_db_levels");
+    return passed;
+}
+
+// testing that SSTs replaced by a compaction stay readable, and on disk,
+// for as long as a version listing them is held
+bool testVersionKeepsObsoleteSSTs()
+{
+    std::filesystem::remove_all("../test_db_levels");
+    std::filesystem::create_directory("../test_db_levels");
+
+    LSMTree tree("../test_db_levels", 2);
+    auto flush = [&tree](int64_t value)
+    {
+        SSTWriter writer(tree.newSSTFilename());
+        for (int64_t key = 0; key < 1000; ++key)
+        {
+            writer.add(key, value);
+        }
+        writer.finish();
+        tree.addSST(writer.filename);
+    };
+
+    flush(1);
+    std::shared_ptr<const Version> old = tree.getCurrentVersion();
+    flush(2); // Level 0 is full and merged into level 1
+    std::shared_ptr<const Version> current = tree.getCurrentVersion();
+
+    bool passed = old->getNumLevels() == 1 && old->getFiles(0).size() == 1;
+    passed = passed && current->getFiles(0).empty() && current->getFiles(1).size() == 1;
+
+    // The replaced SST still answers lookups through the old version
+    std::string replaced = old->getFiles(0)[0]->filename;
+    passed = passed && std::filesystem::exists(replaced);
+    passed = passed && old->getFilesForKey(0, 500).size() == 1 && old->getFilesForKey(0, 1000).empty();
+    passed = passed && old->getFiles(0)[0]->reader->numEntries == 1000;
+
+    // and is deleted with the last version holding it
+    old.reset();
+    passed = passed && !std::filesystem::exists(replaced);
+    passed = passed && std::filesystem::exists(current->getFiles(1)[0]->filename);
+
+    tree.clearLevels();
+    std::filesystem::remove_all("../test_db_levels");
+    return passed;
+}
+
+bool testLazyLeveledLevelShape()
+{
+    std::filesystem::remove_all("../test_db_levels");
+    std::filesystem::create_directory("../test_db_levels");
+
+    LSMTree tree("../test_db_levels", 3);
+    tree.setCompactionStyle(CompactionStyle::LazyLeveled);
+    tree.setTargetFileSize(4 * PAGE_SIZE);
+
+    for (int64_t flush = 0; flush < 60; ++flush)
+    {
+        SSTWriter writer(tree.newSSTFilename());
+        for (int64_t key = flush; key < 30000; key += 60)
+        {
+            writer.add(key, flush);
+        }
+        writer.finish();
+        tree.addSST(writer.filename);
+    }
+
+    // Only the largest level is sorted; every level above it holds fewer runs than its limit
+    size_t largest = 0;
+    for (size_t level = 1; level < tree.getNumLevels(); ++level)
+    {
+        largest = tree.getLevelFileCount(level) > 0 ? level : largest;
+    }
+    bool passed = largest > 1 && tree.isSortedLevel(largest);
+    for (size_t level = 0; level < largest; ++level)
+    {
+        passed = passed && !tree.isSortedLevel(level) && tree.getLevelFileCount(level) < tree.getMaxRuns(level);
+    }
+    std::vector<std::string> files = tree.getSSTFilesByLevel(largest);
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        passed = passed && tree.getSSTReader(files[i - 1])->endingKey < tree.getSSTReader(files[i])->startingKey;
+    }
+
+    tree.clearLevels();
+    std::filesystem::remove_all("../test_db_levels");
+    return passed;
+}
+
+bool testLeveledLevelsAreSorted()
+{
+    std::filesystem::remove_all("../test_db_levels");
+    std::filesystem::create_directory("../test_db_levels");
+
+    LSMTree tree("../test_db_levels", 4);
+    tree.setCompactionStyle(CompactionStyle::Leveled);
+    tree.setTargetFileSize(4 * PAGE_SIZE);
+
+    // Flush-sized SSTs with interleaved key ranges
+    for (int64_t flush = 0; flush < 40; ++flush)
+    {
+        SSTWriter writer(tree.newSSTFilename());
+        for (int64_t key = flush; key < 20000; key += 40)
+        {
+            writer.add(key, flush);
+        }
+        writer.finish();
+        tree.addSST(writer.filename);
+    }
+
+    // Levels 1+ hold SSTs with disjoint, ascending key ranges, so a key maps to at most one SST per level
+    bool passed = tree.getNumLevels() > 2;
+    for (size_t level = 1; level < tree.getNumLevels(); ++level)
+    {
+        std::vector<std::string> files = tree.getSSTFilesByLevel(level);
+        for (size_t i = 1; i < files.size(); ++i)
+        {
+            passed = passed && tree.getSSTReader(files[i - 1])->endingKey < tree.getSSTReader(files[i])->startingKey;
+        }
+        for (int64_t key = 0; key < 20000; key += 123)
+        {
+            passed = passed && tree.getSSTFilesForKey(level, key).size() <= 1;
+        }
+    }
+
+    tree.clearLevels();
+    std::filesystem::remove_all("../test_db_levels");
+    return passed;
+}
+
 // Main function to run all tests
 int main()
 {
@@ -545,7 +2429,15 @@ int main()
 
     // Entity tests
     failedTests += runTest("Page Add Entry", testPageAddEntry);
+    failedTests += runTest("Packed Page Round Trip", testPackedPageRoundTrip);
+    failedTests += runTest("Packed Page Vector Unpacking", testPackedPageVectorUnpacking);
+    failedTests += runTest("Compression Round Trip", testCompressionRoundTrip);
     failedTests += runTest("SST Metadata", testSSTMetadata);
+    failedTests += runTest("SST Fence Pointers", testSSTFencePointers);
+    failedTests += runTest("SST Footer", testSSTFooter);
+    failedTests += runTest("Compaction Job (N-Way Merge)", testCompactionJob);
+    failedTests += runTest("Parallel Subcompactions", testParallelSubcompactions);
+    failedTests += runTest("Rate Limiter (Token Bucket)", testRateLimiter);
 
     // AVLtree tests
     failedTests += runTest("AVLTree Initialization", testAVLTreeInitialization);
@@ -582,6 +2474,34 @@ int main()
 
     // KVStore tests (user facing API)
     failedTests += runTest("KVStore API Tests with Debugging Messages", testKVStore);
+    failedTests += runTest("KVStore Multi-Page SST Lookups (Slotted Pages)", testKVStoreSlottedPages);
+    failedTests += runTest("KVStore Multi-Page SST Lookups (Packed Pages)", testKVStorePackedPages);
+    failedTests += runTest("KVStore Multi-Page SST Lookups (LZ4 Compression)", testKVStoreCompressedPages);
+    failedTests += runTest("KVStore Multi-Page SST Lookups (Large Blocks)", testKVStoreLargeBlocks);
+    failedTests += runTest("Leveled Compaction Level Invariants", testLeveledLevelsAreSorted);
+    failedTests += runTest("KVStore Leveled Compaction", testKVStoreLeveledCompaction);
+    failedTests += runTest("Trivial Move Compaction", testTrivialMoveCompaction);
+    failedTests += runTest("Write Stall Limits", testWriteStallLimits);
+    failedTests += runTest("KVStore Background Compaction", testKVStoreBackgroundCompaction);
+    failedTests += runTest("Tombstone Garbage Collection", testTombstoneGarbageCollection);
+    failedTests += runTest("KVStore Concurrent Access", testKVStoreConcurrentAccess);
+    failedTests += runTest("KVStore Write Batch", testKVStoreWriteBatch);
+    failedTests += runTest("KVStore MultiGet (Tiered)", testKVStoreMultiGetTiered);
+    failedTests += runTest("KVStore MultiGet (Leveled)", testKVStoreMultiGetLeveled);
+    failedTests += runTest("IO Queue Reads", testIOQueueReads);
+    failedTests += runTest("Read Ahead Window", testReadAhead);
+    failedTests += runTest("KVStore Async IO", testKVStoreAsyncIO);
+    failedTests += runTest("KVStore Async API", testKVStoreAsyncAPI);
+    failedTests += runTest("KVStore Mmap Reads", testKVStoreMmapReads);
+    failedTests += runTest("KVStore Direct IO", testKVStoreDirectIO);
+    failedTests += runTest("KVStore Compact Range (Tiered)", testKVStoreCompactRangeTiered);
+    failedTests += runTest("KVStore Compact Range (Leveled)", testKVStoreCompactRangeLeveled);
+    failedTests += runTest("KVStore Stats", testKVStoreStats);
+    failedTests += runTest("Manifest Replay", testManifestReplay);
+    failedTests += runTest("KVStore Crash Recovery", testKVStoreCrashRecovery);
+    failedTests += runTest("Lazy Leveled Compaction Level Shape", testLazyLeveledLevelShape);
+    failedTests += runTest("Versions Keep Obsolete SSTs", testVersionKeepsObsoleteSSTs);
+    failedTests += runTest("KVStore Lazy Leveled Compaction", testKVStoreLazyLeveledCompaction);
 
     std::cout << "\nSummary: " << failedTests << " test(s) failed." << std::endl;
     return failedTests;